@@ -331,6 +331,9 @@ protected:
                 precedence(),
                 group)
         );
+
+	    m_runtime.definitions().printing.add_operator(
+		    m_symbol.get(), operator_name(), precedence(), group);
     }
 
 public:
@@ -61,7 +61,7 @@ protected:
 			return evaluation.definitions.empty_list;
 		}
 		TemporaryRefVector leaves;
-		for (const RuleEntry &entry : *rules) {
+		for (const RuleEntry &entry : rules->sorted(evaluation)) {
 			UnsafeBaseExpressionRef pattern = entry.pattern();
 			const BaseExpressionRef &rhs = entry.rule()->rhs();
 			if (!pattern->has_form(S::HoldPattern, 1)) {
@@ -0,0 +1,1072 @@
+// @formatter:off
+
+#include "files.h"
+#include "../core/import.h"
+#include "../core/export.h"
+
+#include <cstring>
+#include <memory>
+
+namespace {
+
+template<typename U>
+ExpressionRef packed_list(std::vector<U> &&values, const Evaluation &evaluation) {
+	const size_t n = values.size();
+	if (n >= MinPackedSliceSize) {
+		return expression(evaluation.List, PackedSlice<U>(std::move(values)));
+	} else {
+		return expression(evaluation.List, sequential([&values] (auto &store) {
+			for (const U x : values) {
+				store(from_primitive(x));
+			}
+		}, n));
+	}
+}
+
+inline bool is_space(char c) {
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+inline BaseExpressionRef scan_number(const char *begin, const char *end) {
+	machine_integer_t x;
+	if (scan_integer(begin, end, x)) {
+		return MachineInteger::construct(x);
+	}
+	machine_real_t y;
+	if (scan_real(begin, end, y)) {
+		return MachineReal::construct(y);
+	}
+	return BaseExpressionRef();
+}
+
+// StringViews makes strings for consecutive, ascending pieces of a UTF-8 text
+// (e.g. the lines of a file or the fields of a column), which all share one
+// extent for the whole text, instead of allocating one extent per piece. for
+// texts that are not simple (i.e. whose characters are not their code points),
+// each piece still gets an extent of its own.
+
+class StringViews {
+private:
+	const char * const m_data;
+	StringExtentRef m_extent;
+	bool m_ascii;
+
+	size_t m_byte;
+	size_t m_character;
+
+	inline size_t character(size_t byte) {
+		assert(byte >= m_byte);
+		while (m_byte < byte) {
+			if ((m_data[m_byte] & 0xc0) != 0x80) {
+				m_character++;
+			}
+			m_byte++;
+		}
+		return m_character;
+	}
+
+public:
+	StringViews(const char *data, size_t n) : m_data(data), m_ascii(false), m_byte(0), m_character(0) {
+		const StringExtentRef extent = make_string_extent(std::string(data, n));
+
+		switch (extent->type()) {
+			case StringExtent::ascii:
+				m_extent = extent;
+				m_ascii = true;
+				break;
+
+			case StringExtent::simple:
+				// unless normalization changed the text, its code points
+				// are its characters.
+				if (extent->utf8(0, extent->length()) == std::string(data, n)) {
+					m_extent = extent;
+				}
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	inline BaseExpressionRef operator()(size_t begin, size_t end) {
+		if (m_ascii) {
+			return String::construct(m_extent, begin, end - begin);
+		} else if (m_extent) {
+			const size_t character_begin = character(begin);
+			return String::construct(m_extent, character_begin, character(end) - character_begin);
+		} else {
+			std::string piece(m_data + begin, end - begin);
+			return String::construct(piece);
+		}
+	}
+};
+
+template<typename F>
+BaseExpressionRef with_mapped_file(
+	const SymbolRef &symbol,
+	BaseExpressionPtr file,
+	const Evaluation &evaluation,
+	const F &f) {
+
+	if (!file->is_string()) {
+		return BaseExpressionRef();
+	}
+
+	const MappedFile mapped(file->as_string()->utf8());
+	if (!mapped.is_open()) {
+		evaluation.message(symbol, "noopen", BaseExpressionRef(file));
+		return evaluation.StateFailed;
+	}
+
+	return f(mapped);
+}
+
+BaseExpressionRef read_text(const MappedFile &file) {
+	std::string text(file.data(), file.size());
+	return String::construct(text);
+}
+
+BaseExpressionRef read_lines(const MappedFile &file, const Evaluation &evaluation) {
+	const char * const data = file.data();
+	const size_t n = file.size();
+
+	std::vector<std::pair<size_t, size_t>> lines;
+	size_t begin = 0;
+	while (begin < n) {
+		const void * const newline = std::memchr(data + begin, '\n', n - begin);
+		const size_t next = newline ? static_cast<const char*>(newline) - data + 1 : n;
+		size_t end = newline ? next - 1 : n;
+		if (end > begin && data[end - 1] == '\r') {
+			end--;
+		}
+		lines.emplace_back(begin, end);
+		begin = next;
+	}
+
+	StringViews views(data, n);
+	return expression(evaluation.List, sequential([&lines, &views] (auto &store) {
+		for (const auto &line : lines) {
+			store(views(line.first, line.second));
+		}
+	}, lines.size()));
+}
+
+BaseExpressionRef read_words(const MappedFile &file, const Evaluation &evaluation) {
+	const char * const data = file.data();
+	const size_t n = file.size();
+
+	std::vector<std::pair<size_t, size_t>> words;
+	size_t i = 0;
+	while (true) {
+		while (i < n && is_space(data[i])) {
+			i++;
+		}
+		if (i >= n) {
+			break;
+		}
+		const size_t begin = i;
+		while (i < n && !is_space(data[i])) {
+			i++;
+		}
+		words.emplace_back(begin, i);
+	}
+
+	StringViews views(data, n);
+	return expression(evaluation.List, sequential([&words, &views] (auto &store) {
+		for (const auto &word : words) {
+			store(views(word.first, word.second));
+		}
+	}, words.size()));
+}
+
+class NumberChunk {
+public:
+	std::vector<machine_integer_t> integers;
+	std::vector<machine_real_t> reals;
+	std::vector<bool> is_real;
+	bool valid = true;
+
+	void scan(const char *p, const char *end, bool reals_only) {
+		while (true) {
+			while (p < end && is_space(*p)) {
+				p++;
+			}
+			if (p >= end) {
+				break;
+			}
+
+			const char * const token = p;
+			while (p < end && !is_space(*p)) {
+				p++;
+			}
+
+			machine_integer_t x;
+			machine_real_t y;
+			if (!reals_only && scan_integer(token, p, x)) {
+				integers.push_back(x);
+				is_real.push_back(false);
+			} else if (scan_real(token, p, y)) {
+				reals.push_back(y);
+				is_real.push_back(true);
+			} else {
+				valid = false;
+				break;
+			}
+		}
+	}
+};
+
+// the numbers in a file, separated by whitespace. integers and reals that do
+// not mix become packed lists; mixed ones give a list of both, like the file.
+BaseExpressionRef read_numbers(
+	const SymbolRef &symbol,
+	const MappedFile &file,
+	bool reals_only,
+	const Evaluation &evaluation) {
+
+	const char * const data = file.data();
+	const std::vector<size_t> bounds = split_chunks(
+		data, file.size(), import_chunk_size(file.size()), " \t\r\n");
+	const size_t n_chunks = bounds.size() - 1;
+
+	std::vector<NumberChunk> chunks(n_chunks);
+	parallelize([data, &bounds, &chunks, reals_only] (size_t i) {
+		chunks[i].scan(data + bounds[i], data + bounds[i + 1], reals_only);
+	}, n_chunks, evaluation);
+
+	size_t n_integers = 0;
+	size_t n_reals = 0;
+	for (const NumberChunk &chunk : chunks) {
+		if (!chunk.valid) {
+			evaluation.message(symbol, "readn");
+			return evaluation.StateFailed;
+		}
+		n_integers += chunk.integers.size();
+		n_reals += chunk.reals.size();
+	}
+
+	if (n_reals == 0) {
+		std::vector<machine_integer_t> integers;
+		integers.reserve(n_integers);
+		for (NumberChunk &chunk : chunks) {
+			integers.insert(integers.end(), chunk.integers.begin(), chunk.integers.end());
+			std::vector<machine_integer_t>().swap(chunk.integers);
+		}
+		return packed_list(std::move(integers), evaluation);
+	} else if (n_integers == 0) {
+		std::vector<machine_real_t> reals;
+		reals.reserve(n_reals);
+		for (NumberChunk &chunk : chunks) {
+			reals.insert(reals.end(), chunk.reals.begin(), chunk.reals.end());
+			std::vector<machine_real_t>().swap(chunk.reals);
+		}
+		return packed_list(std::move(reals), evaluation);
+	} else {
+		return expression(evaluation.List, sequential([&chunks] (auto &store) {
+			for (const NumberChunk &chunk : chunks) {
+				size_t i = 0;
+				size_t j = 0;
+				for (const bool is_real : chunk.is_real) {
+					if (is_real) {
+						store(from_primitive(chunk.reals[j++]));
+					} else {
+						store(from_primitive(chunk.integers[i++]));
+					}
+				}
+			}
+		}, n_integers + n_reals));
+	}
+}
+
+template<typename T, typename U>
+BaseExpressionRef read_binary(const MappedFile &file, const Evaluation &evaluation) {
+	// a partial element at the end of the file is ignored.
+	const size_t n = file.size() / sizeof(T);
+	const char * const data = file.data();
+
+	std::vector<U> values(n);
+
+	const size_t chunk_size = import_chunk_size(file.size()) / sizeof(T);
+	parallelize([data, n, chunk_size, &values] (size_t k) {
+		const size_t end = std::min(n, (k + 1) * chunk_size);
+		for (size_t i = k * chunk_size; i < end; i++) {
+			T x;
+			std::memcpy(&x, data + i * sizeof(T), sizeof(T));
+			values[i] = U(x);
+		}
+	}, (n + chunk_size - 1) / chunk_size, evaluation);
+
+	return packed_list(std::move(values), evaluation);
+}
+
+// the elements of a binary file as type, e.g. "Integer32", in the byte order
+// of the machine; or an empty reference for unknown types.
+BaseExpressionRef read_binary(const MappedFile &file, const std::string &type, const Evaluation &evaluation) {
+	if (type == "Byte" || type == "UnsignedInteger8") {
+		return read_binary<uint8_t, machine_integer_t>(file, evaluation);
+	} else if (type == "Integer8") {
+		return read_binary<int8_t, machine_integer_t>(file, evaluation);
+	} else if (type == "Integer16") {
+		return read_binary<int16_t, machine_integer_t>(file, evaluation);
+	} else if (type == "UnsignedInteger16") {
+		return read_binary<uint16_t, machine_integer_t>(file, evaluation);
+	} else if (type == "Integer32") {
+		return read_binary<int32_t, machine_integer_t>(file, evaluation);
+	} else if (type == "UnsignedInteger32") {
+		return read_binary<uint32_t, machine_integer_t>(file, evaluation);
+	} else if (type == "Integer64") {
+		return read_binary<int64_t, machine_integer_t>(file, evaluation);
+	} else if (type == "Real32") {
+		return read_binary<float, machine_real_t>(file, evaluation);
+	} else if (type == "Real64") {
+		return read_binary<double, machine_real_t>(file, evaluation);
+	} else {
+		return BaseExpressionRef();
+	}
+}
+
+// the fields of a General column, which are numbers where they look like
+// numbers (as in a CSV file, where a column may mix numbers and text).
+class GeneralColumnReader {
+private:
+	const TableColumn &m_column;
+	StringViews m_views;
+	size_t m_begin;
+
+public:
+	inline GeneralColumnReader(const TableColumn &column) :
+		m_column(column), m_views(column.text.data(), column.text.size()), m_begin(0) {
+	}
+
+	inline BaseExpressionRef operator()(size_t row) {
+		const size_t begin = m_begin;
+		const size_t end = m_column.ends[row];
+		m_begin = end;
+
+		const char * const text = m_column.text.data();
+		const BaseExpressionRef number = scan_number(text + begin, text + end);
+		if (number) {
+			return number;
+		} else {
+			return m_views(begin, end);
+		}
+	}
+
+	inline void skip(size_t row) {
+		m_begin = m_column.ends[row];
+	}
+};
+
+BaseExpressionRef table_columns(Table &table, const Evaluation &evaluation) {
+	const size_t rows = table.rows();
+
+	return expression(evaluation.List, sequential([&table, rows, &evaluation] (auto &store) {
+		for (TableColumn &column : table.columns) {
+			switch (column.type) {
+				case TableColumn::Integer:
+					store(packed_list(std::move(column.integers), evaluation));
+					break;
+
+				case TableColumn::Real:
+					store(packed_list(std::move(column.reals), evaluation));
+					break;
+
+				default: {
+					GeneralColumnReader reader(column);
+					store(expression(evaluation.List, sequential([&reader, rows] (auto &store) {
+						for (size_t i = 0; i < rows; i++) {
+							store(reader(i));
+						}
+					}, rows)));
+					break;
+				}
+			}
+		}
+	}, table.columns.size()));
+}
+
+BaseExpressionRef table_rows(const Table &table, const Evaluation &evaluation) {
+	const size_t n_columns = table.columns.size();
+
+	std::vector<std::unique_ptr<GeneralColumnReader>> readers(n_columns);
+	for (size_t j = 0; j < n_columns; j++) {
+		if (table.columns[j].type == TableColumn::General) {
+			readers[j] = std::make_unique<GeneralColumnReader>(table.columns[j]);
+		}
+	}
+
+	return expression(evaluation.List, sequential([&table, &readers, n_columns, &evaluation] (auto &store) {
+		const size_t rows = table.rows();
+
+		for (size_t i = 0; i < rows; i++) {
+			const size_t width = table.widths[i];
+
+			store(expression(evaluation.List, sequential([&table, &readers, n_columns, i, width] (auto &store) {
+				for (size_t j = 0; j < n_columns; j++) {
+					const TableColumn &column = table.columns[j];
+
+					switch (column.type) {
+						case TableColumn::Integer:
+							if (j < width) {
+								store(from_primitive(column.integers[i]));
+							}
+							break;
+
+						case TableColumn::Real:
+							if (j < width) {
+								store(from_primitive(column.reals[i]));
+							}
+							break;
+
+						default:
+							if (j < width) {
+								store((*readers[j])(i));
+							} else {
+								readers[j]->skip(i);
+							}
+							break;
+					}
+				}
+			}, width)));
+		}
+	}, table.rows()));
+}
+
+// opens file for writing, lets f write to it, and closes it. if the file cannot
+// be opened or written, gives $Failed instead of what f gives.
+template<typename F>
+BaseExpressionRef with_file_writer(
+	const SymbolRef &symbol,
+	BaseExpressionPtr file,
+	bool append,
+	const Evaluation &evaluation,
+	const F &f) {
+
+	FileWriter writer(file->as_string()->utf8(), append);
+	if (!writer.is_open()) {
+		evaluation.message(symbol, "noopen", BaseExpressionRef(file));
+		return evaluation.StateFailed;
+	}
+
+	const BaseExpressionRef result = f(writer);
+
+	if (!writer.close()) {
+		evaluation.message(symbol, "write", BaseExpressionRef(file));
+		return evaluation.StateFailed;
+	}
+
+	return result;
+}
+
+bool is_binary_type(const std::string &type) {
+	static const char * const types[] = {
+		"Byte", "Integer8", "Integer16", "Integer32", "Integer64", "UnsignedInteger8",
+		"UnsignedInteger16", "UnsignedInteger32", "Real32", "Real64"};
+
+	for (const char *t : types) {
+		if (type == t) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// strings as they are, other expressions in OutputForm.
+void write_text(FileWriter &out, BaseExpressionPtr item, const Evaluation &evaluation) {
+	if (item->is_string()) {
+		out.write(item->as_string()->utf8());
+	} else {
+		std::string text;
+		Printer printer(text, evaluation, &out);
+		printer.output(item);
+	}
+}
+
+// the format that Import and Export use for a file, given its extension, or
+// nullptr if there is none for the extension.
+const char *format_from_extension(const std::string &path) {
+	const size_t dot = path.rfind('.');
+	const size_t slash = path.rfind('/');
+
+	std::string extension;
+	if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) {
+		extension = path.substr(dot + 1);
+		for (char &c : extension) {
+			c = tolower(c);
+		}
+	}
+
+	if (extension == "csv") {
+		return "CSV";
+	} else if (extension == "tsv" || extension == "tab") {
+		return "TSV";
+	} else if (extension == "txt") {
+		return "Text";
+	} else if (extension == "dat") {
+		return "Table";
+	} else if (extension == "bin") {
+		return "Binary";
+	} else if (extension == "m") {
+		return "Package";
+	} else {
+		return nullptr;
+	}
+}
+
+} // namespace
+
+class ReadString : public Builtin {
+public:
+	static constexpr const char *name = "ReadString";
+
+	static constexpr const char *docs = R"(
+    <dl>
+    <dt>'ReadString["$file$"]'
+        <dd>reads all of $file$ into a string.
+    </dl>
+
+    >> ReadString["/no/such/file"]
+     : Cannot open /no/such/file.
+     = $Failed
+	)";
+
+public:
+	using Builtin::Builtin;
+
+	void build(Runtime &runtime) {
+		message("noopen", "Cannot open `1`.");
+
+		builtin(&ReadString::apply);
+	}
+
+	inline BaseExpressionRef apply(
+		BaseExpressionPtr file,
+		const Evaluation &evaluation) {
+
+		return with_mapped_file(m_symbol, file, evaluation, [] (const MappedFile &mapped) {
+			return read_text(mapped);
+		});
+	}
+};
+
+class ReadList : public Builtin {
+public:
+	static constexpr const char *name = "ReadList";
+
+	static constexpr const char *docs = R"(
+    <dl>
+    <dt>'ReadList["$file$", Number]'
+        <dd>reads the numbers in $file$, which are separated by whitespace.
+    <dt>'ReadList["$file$", Real]'
+        <dd>reads the numbers in $file$ as reals.
+    <dt>'ReadList["$file$", String]'
+        <dd>reads the lines of $file$.
+    <dt>'ReadList["$file$", Word]'
+        <dd>reads the words of $file$, which are separated by whitespace.
+    </dl>
+
+    Numbers are read into packed lists, unless integers and reals mix. The file
+    is read in parallel chunks.
+	)";
+
+public:
+	using Builtin::Builtin;
+
+	void build(Runtime &runtime) {
+		message("noopen", "Cannot open `1`.");
+		message("readn", "Invalid number found when reading numbers.");
+
+		builtin(&ReadList::apply);
+	}
+
+	inline BaseExpressionRef apply(
+		BaseExpressionPtr file,
+		BaseExpressionPtr type,
+		const Evaluation &evaluation) {
+
+		const SymbolName type_name = type->symbol();
+
+		switch (type_name) {
+			case S::Number:
+			case S::Real:
+			case S::String:
+			case S::Word:
+				break;
+			default:
+				return BaseExpressionRef();
+		}
+
+		return with_mapped_file(m_symbol, file, evaluation, [this, type_name, &evaluation] (const MappedFile &mapped) {
+			switch (type_name) {
+				case S::Number:
+					return read_numbers(m_symbol, mapped, false, evaluation);
+				case S::Real:
+					return read_numbers(m_symbol, mapped, true, evaluation);
+				case S::String:
+					return read_lines(mapped, evaluation);
+				default:
+					return read_words(mapped, evaluation);
+			}
+		});
+	}
+};
+
+class BinaryReadList : public Builtin {
+public:
+	static constexpr const char *name = "BinaryReadList";
+
+	static constexpr const char *docs = R"(
+    <dl>
+    <dt>'BinaryReadList["$file$"]'
+        <dd>reads the bytes of $file$.
+    <dt>'BinaryReadList["$file$", "$type$"]'
+        <dd>reads $file$ as a sequence of elements of $type$, which is one of "Byte",
+        "Integer8", "Integer16", "Integer32", "Integer64", "UnsignedInteger8",
+        "UnsignedInteger16", "UnsignedInteger32", "Real32" and "Real64".
+    </dl>
+
+    Elements are read in the byte order of the machine, and into packed lists.
+	)";
+
+public:
+	using Builtin::Builtin;
+
+	void build(Runtime &runtime) {
+		message("noopen", "Cannot open `1`.");
+		message("format", "`1` is not a recognized binary format.");
+
+		builtin("BinaryReadList[file_]", "BinaryReadList[file, \"Byte\"]");
+
+		builtin(&BinaryReadList::apply);
+	}
+
+	inline BaseExpressionRef apply(
+		BaseExpressionPtr file,
+		BaseExpressionPtr type,
+		const Evaluation &evaluation) {
+
+		if (!type->is_string()) {
+			return BaseExpressionRef();
+		}
+
+		const std::string type_name = type->as_string()->utf8();
+
+		return with_mapped_file(m_symbol, file, evaluation, [this, type, &type_name, &evaluation] (const MappedFile &mapped) {
+			const BaseExpressionRef result = read_binary(mapped, type_name, evaluation);
+			if (!result) {
+				evaluation.message(m_symbol, "format", BaseExpressionRef(type));
+				return BaseExpressionRef(evaluation.StateFailed);
+			}
+			return result;
+		});
+	}
+};
+
+class Import : public Builtin {
+public:
+	static constexpr const char *name = "Import";
+
+	static constexpr const char *docs = R"(
+    <dl>
+    <dt>'Import["$file$"]'
+        <dd>imports $file$ in the format given by its extension.
+    <dt>'Import["$file$", "$format$"]'
+        <dd>imports $file$ as $format$, which is one of "Text", "Lines", "CSV", "TSV",
+        "Table" (fields separated by blanks) and "Binary".
+    <dt>'Import["$file$", {"$format$", "$element$"}]'
+        <dd>imports an element of $file$. for tables, "Data" gives the rows and
+        "Columns" the columns. for "Binary", the element is the type of the data,
+        as in 'BinaryReadList'.
+    </dl>
+
+    Tables are read in parallel chunks. Columns of integers or reals are imported
+    as packed lists, columns with text as strings that share one buffer; in
+    numeric columns, integers turn into reals if there are reals.
+
+    >> Import["/no/such/file.csv"]
+     : Cannot open /no/such/file.csv.
+     = $Failed
+    >> Import["/no/such/file.xyz"]
+     : Cannot infer format of file /no/such/file.xyz.
+     = $Failed
+    >> Import["/no/such/file", "PDF"]
+     : PDF is not a supported Import format.
+     = $Failed
+	)";
+
+public:
+	using Builtin::Builtin;
+
+	void build(Runtime &runtime) {
+		message("noopen", "Cannot open `1`.");
+		message("infer", "Cannot infer format of file `1`.");
+		message("fmtnosup", "`1` is not a supported Import format.");
+		message("noelem", "The Import element `1` is not present when importing as `2`.");
+
+		builtin(&Import::apply1);
+
+		builtin(&Import::apply2);
+	}
+
+	inline BaseExpressionRef apply1(
+		BaseExpressionPtr file,
+		const Evaluation &evaluation) {
+
+		if (!file->is_string()) {
+			return BaseExpressionRef();
+		}
+
+		const char * const format = format_from_extension(file->as_string()->utf8());
+		if (!format) {
+			evaluation.message(m_symbol, "infer", BaseExpressionRef(file));
+			return evaluation.StateFailed;
+		}
+
+		return import_file(file, format, "", evaluation);
+	}
+
+	inline BaseExpressionRef apply2(
+		BaseExpressionPtr file,
+		BaseExpressionPtr what,
+		const Evaluation &evaluation) {
+
+		if (!file->is_string()) {
+			return BaseExpressionRef();
+		}
+
+		if (what->is_string()) {
+			return import_file(file, what->as_string()->utf8(), "", evaluation);
+		} else if (what->is_list() && what->as_expression()->size() == 2) {
+			const auto * const leaves = what->as_expression()->n_leaves<2>();
+			if (leaves[0]->is_string() && leaves[1]->is_string()) {
+				return import_file(file, leaves[0]->as_string()->utf8(), leaves[1]->as_string()->utf8(), evaluation);
+			}
+		}
+
+		return BaseExpressionRef();
+	}
+
+private:
+	BaseExpressionRef import_file(
+		BaseExpressionPtr file,
+		const std::string &format,
+		const std::string &element,
+		const Evaluation &evaluation) {
+
+		char separator = 0;
+		if (format == "CSV") {
+			separator = ',';
+		} else if (format == "TSV") {
+			separator = '\t';
+		} else if (format == "Table") {
+			separator = ' ';
+		} else if (format != "Text" && format != "Lines" && format != "Binary") {
+			evaluation.message(m_symbol, "fmtnosup", String::construct(format));
+			return evaluation.StateFailed;
+		}
+
+		const auto no_element = [this, &format, &element, &evaluation] () {
+			evaluation.message(m_symbol, "noelem", String::construct(element), String::construct(format));
+			return BaseExpressionRef(evaluation.StateFailed);
+		};
+
+		return with_mapped_file(m_symbol, file, evaluation, [&] (const MappedFile &mapped) {
+			if (format == "Binary") {
+				const BaseExpressionRef result = read_binary(mapped, element.empty() ? "Byte" : element, evaluation);
+				return result ? result : no_element();
+			} else if (separator) {
+				if (element.empty() || element == "Data") {
+					const Table table = parse_table(mapped.data(), mapped.size(), separator, evaluation);
+					return table_rows(table, evaluation);
+				} else if (element == "Columns") {
+					Table table = parse_table(mapped.data(), mapped.size(), separator, evaluation);
+					return table_columns(table, evaluation);
+				} else {
+					return no_element();
+				}
+			} else if (!element.empty()) {
+				return no_element();
+			} else if (format == "Text") {
+				return read_text(mapped);
+			} else {
+				return read_lines(mapped, evaluation);
+			}
+		});
+	}
+};
+
+class Export : public Builtin {
+public:
+	static constexpr const char *name = "Export";
+
+	static constexpr const char *docs = R"(
+    <dl>
+    <dt>'Export["$file$", $expr$]'
+        <dd>exports $expr$ to $file$ in the format given by its extension.
+    <dt>'Export["$file$", $expr$, "$format$"]'
+        <dd>exports $expr$ as $format$, which is one of "Text", "Lines", "CSV", "TSV",
+        "Table" (fields separated by blanks), "FullForm", "InputForm", "Package" (as
+        "InputForm"), "Binary" (as bytes) or any type of 'BinaryReadList'.
+    </dl>
+
+    Expressions are written to $file$ as they are traversed, without turning them into
+    one string first. Packed lists in the byte layout of a binary type are written
+    from their buffers.
+
+    >> Export["/tmp/cmathics_export.csv", {{1, 2.5}, {"a,b", x}}]
+     = /tmp/cmathics_export.csv
+    >> Import["/tmp/cmathics_export.csv"]
+     = {{1, 2.5}, {a,b, x}}
+
+    >> Export["/tmp/cmathics_export.bin", Range[20], "Integer16"]
+     = /tmp/cmathics_export.bin
+    >> BinaryReadList["/tmp/cmathics_export.bin", "Integer16"]
+     = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20}
+
+    >> Export["/tmp/cmathics_export.m", f[x, {1, "a"}]]
+     = /tmp/cmathics_export.m
+    >> ReadList["/tmp/cmathics_export.m", String]
+     = {f[x, {1, "a"}]}
+
+    #> Export["/tmp/cmathics_export.bin", {1, 256}, "Byte"]
+     : 256 cannot be coerced to the specified format.
+     = $Failed
+    #> Export["/no/such/dir/file.csv", {{1, 2}}]
+     : Cannot open /no/such/dir/file.csv.
+     = $Failed
+	)";
+
+public:
+	using Builtin::Builtin;
+
+	void build(Runtime &runtime) {
+		message("noopen", "Cannot open `1`.");
+		message("infer", "Cannot infer format of file `1`.");
+		message("fmtnosup", "`1` is not a supported Export format.");
+		message("nocoerce", "`1` cannot be coerced to the specified format.");
+		message("write", "Cannot write to `1`.");
+
+		builtin(&Export::apply2);
+
+		builtin(&Export::apply3);
+	}
+
+	inline BaseExpressionRef apply2(
+		BaseExpressionPtr file,
+		BaseExpressionPtr expr,
+		const Evaluation &evaluation) {
+
+		if (!file->is_string()) {
+			return BaseExpressionRef();
+		}
+
+		const char * const format = format_from_extension(file->as_string()->utf8());
+		if (!format) {
+			evaluation.message(m_symbol, "infer", BaseExpressionRef(file));
+			return evaluation.StateFailed;
+		}
+
+		return export_file(file, expr, format, evaluation);
+	}
+
+	inline BaseExpressionRef apply3(
+		BaseExpressionPtr file,
+		BaseExpressionPtr expr,
+		BaseExpressionPtr format,
+		const Evaluation &evaluation) {
+
+		if (!file->is_string() || !format->is_string()) {
+			return BaseExpressionRef();
+		}
+
+		return export_file(file, expr, format->as_string()->utf8(), evaluation);
+	}
+
+private:
+	BaseExpressionRef export_file(
+		BaseExpressionPtr file,
+		BaseExpressionPtr expr,
+		const std::string &format,
+		const Evaluation &evaluation) {
+
+		char separator = 0;
+		std::string type;
+		optional<PrintForm> form;
+
+		if (format == "CSV") {
+			separator = ',';
+		} else if (format == "TSV") {
+			separator = '\t';
+		} else if (format == "Table") {
+			separator = ' ';
+		} else if (format == "Binary") {
+			type = "Byte";
+		} else if (is_binary_type(format)) {
+			type = format;
+		} else if (format == "FullForm") {
+			form = PrintForm::FullForm;
+		} else if (format == "InputForm" || format == "Package") {
+			form = PrintForm::InputForm;
+		} else if (format != "Text" && format != "Lines") {
+			evaluation.message(m_symbol, "fmtnosup", String::construct(format));
+			return evaluation.StateFailed;
+		}
+
+		if (!type.empty() && !expr->is_list()) {
+			evaluation.message(m_symbol, "nocoerce", BaseExpressionRef(expr));
+			return evaluation.StateFailed;
+		}
+
+		return with_file_writer(m_symbol, file, false, evaluation, [&] (FileWriter &out) {
+			if (!type.empty()) {
+				BaseExpressionRef failed;
+				if (!write_binary(out, expr->as_expression(), type, failed)) {
+					evaluation.message(m_symbol, "nocoerce", failed);
+					return BaseExpressionRef(evaluation.StateFailed);
+				}
+			} else if (separator) {
+				write_table(out, expr, separator, evaluation);
+			} else if (form) {
+				std::string text;
+				Printer printer(text, evaluation, &out);
+				printer(expr, *form, StringCharacters::Escaped);
+				out.put('\n');
+			} else if (format == "Lines" && expr->is_list()) {
+				const Expression * const lines = expr->as_expression();
+				const size_t n = lines->size();
+				for (size_t i = 0; i < n; i++) {
+					write_text(out, lines->leaf(i).get(), evaluation);
+					out.put('\n');
+				}
+			} else {
+				write_text(out, expr, evaluation);
+			}
+
+			return BaseExpressionRef(file);
+		});
+	}
+};
+
+class WriteString : public Builtin {
+public:
+	static constexpr const char *name = "WriteString";
+
+	static constexpr const char *docs = R"(
+    <dl>
+    <dt>'WriteString["$file$", $expr1$, $expr2$, ...]'
+        <dd>appends the strings $expr1$, $expr2$, ... to $file$, without separators or
+        a newline at the end. other expressions are written in OutputForm.
+    </dl>
+
+    >> WriteString["/no/such/dir/file", "text"]
+     : Cannot open /no/such/dir/file.
+     = $Failed
+	)";
+
+public:
+	using Builtin::Builtin;
+
+	void build(Runtime &runtime) {
+		message("noopen", "Cannot open `1`.");
+		message("write", "Cannot write to `1`.");
+
+		builtin(&WriteString::apply);
+	}
+
+	inline BaseExpressionRef apply(
+		const ExpressionPtr expr,
+		const Evaluation &evaluation) {
+
+		const size_t n = expr->size();
+		if (n < 1) {
+			return BaseExpressionRef();
+		}
+
+		const BaseExpressionRef file = expr->leaf(0);
+		if (!file->is_string()) {
+			return BaseExpressionRef();
+		}
+
+		return with_file_writer(m_symbol, file.get(), true, evaluation, [expr, n, &evaluation] (FileWriter &out) {
+			for (size_t i = 1; i < n; i++) {
+				write_text(out, expr->leaf(i).get(), evaluation);
+			}
+			return BaseExpressionRef(evaluation.Null);
+		});
+	}
+};
+
+class BinaryWrite : public Builtin {
+public:
+	static constexpr const char *name = "BinaryWrite";
+
+	static constexpr const char *docs = R"(
+    <dl>
+    <dt>'BinaryWrite["$file$", $data$]'
+        <dd>appends $data$, which is a list of bytes or a string, to $file$.
+    <dt>'BinaryWrite["$file$", $data$, "$type$"]'
+        <dd>appends the numbers in $data$ to $file$ as elements of $type$, which is one
+        of the types of 'BinaryReadList'.
+    </dl>
+
+    Elements are written in the byte order of the machine. Packed lists of integers
+    as "Integer64" or of reals as "Real64" are written from their buffers.
+	)";
+
+public:
+	using Builtin::Builtin;
+
+	void build(Runtime &runtime) {
+		message("noopen", "Cannot open `1`.");
+		message("format", "`1` is not a recognized binary format.");
+		message("nocoerce", "`1` cannot be coerced to the specified format.");
+		message("write", "Cannot write to `1`.");
+
+		builtin("BinaryWrite[file_, data_]", "BinaryWrite[file, data, \"Byte\"]");
+
+		builtin(&BinaryWrite::apply);
+	}
+
+	inline BaseExpressionRef apply(
+		BaseExpressionPtr file,
+		BaseExpressionPtr data,
+		BaseExpressionPtr type,
+		const Evaluation &evaluation) {
+
+		if (!file->is_string() || !type->is_string()) {
+			return BaseExpressionRef();
+		}
+
+		const std::string type_name = type->as_string()->utf8();
+		if (!is_binary_type(type_name)) {
+			evaluation.message(m_symbol, "format", BaseExpressionRef(type));
+			return evaluation.StateFailed;
+		}
+
+		const BaseExpressionRef list = data->is_list() ? BaseExpressionRef(data) :
+			BaseExpressionRef(expression(evaluation.List, BaseExpressionRef(data)));
+
+		return with_file_writer(m_symbol, file, true, evaluation, [this, file, data, &list, &type_name, &evaluation] (FileWriter &out) {
+			if (data->is_string()) {
+				out.write(data->as_string()->utf8());
+			} else {
+				BaseExpressionRef failed;
+				if (!write_binary(out, list->as_expression(), type_name, failed)) {
+					evaluation.message(m_symbol, "nocoerce", failed);
+					return BaseExpressionRef(evaluation.StateFailed);
+				}
+			}
+			return BaseExpressionRef(file);
+		});
+	}
+};
+
+void Builtins::Files::initialize() {
+	add<ReadString>();
+	add<ReadList>();
+	add<BinaryReadList>();
+	add<Import>();
+	add<Export>();
+	add<WriteString>();
+	add<BinaryWrite>();
+}
@@ -0,0 +1,18 @@
+#ifndef CMATHICS_FILES_H
+#define CMATHICS_FILES_H
+
+#include "../core/runtime.h"
+
+namespace Builtins {
+
+	class Files : public Unit {
+	public:
+		Files(Runtime &runtime) : Unit(runtime) {
+		}
+
+		void initialize();
+	};
+
+} // end namespace Builtins
+
+#endif //CMATHICS_FILES_H
@@ -3,6 +3,7 @@
 #include "lists.h"
 #include "levelspec.tcc"
 #include "../core/definitions.h"
+#include "../core/pattern/predicate.h"
 
 class ListBoxes {
 private:
@@ -326,6 +327,68 @@ public:
     }
 };
 
+// select_packed() returns head[...] with those leaves of a packed slice for
+// which predicate is true, working on the unboxed values. if the predicate is
+// undecided for some leaf (or if slice is not packed), it returns an empty
+// reference and the caller needs to take the usual way.
+
+template<typename Slice, typename Predicate>
+inline BaseExpressionRef select_packed(
+    const BaseExpressionRef &head,
+    const Slice &slice,
+    const Predicate &predicate) {
+
+    return BaseExpressionRef();
+}
+
+template<typename U, typename Predicate>
+BaseExpressionRef select_packed(
+    const BaseExpressionRef &head,
+    const PackedSlice<U> &slice,
+    const Predicate &predicate) {
+
+    std::vector<U> selected;
+    selected.reserve(slice.size());
+
+    for (const U x : slice.template primitives<U>()) {
+        switch (predicate(x)) {
+            case true:
+                selected.push_back(x);
+                break;
+            case false:
+                break;
+            default:
+                return BaseExpressionRef();
+        }
+    }
+
+    const size_t n = selected.size();
+    if (n >= MinPackedSliceSize) {
+        return expression(head, PackedSlice<U>(std::move(selected)));
+    } else {
+        return expression(head, sequential([&selected] (auto &store) {
+            for (const U x : selected) {
+                store(from_primitive(x));
+            }
+        }, n));
+    }
+}
+
+template<typename Predicate>
+inline BaseExpressionRef select_packed(
+    const BaseExpressionRef &head,
+    const Expression *list,
+    const Predicate &predicate) {
+
+    if (!is_packed_slice(list->slice_code())) {
+        return BaseExpressionRef();
+    }
+
+    return list->with_slice([&head, &predicate] (const auto &slice) {
+        return select_packed(head, slice, predicate);
+    });
+}
+
 class Select : public Builtin {
 public:
     static constexpr const char *name = "Select";
@@ -346,6 +409,11 @@ public:
     >> Select[f[a, 2, 3], NumberQ]
      = f[2, 3]
 
+    >> Select[Range[20], # > 15 &]
+     = {16, 17, 18, 19, 20}
+    >> Select[Range[20], EvenQ]
+     = {2, 4, 6, 8, 10, 12, 14, 16, 18, 20}
+
     >> Select[a, True]
      : Nonatomic expression expected.
      = Select[a, True]
@@ -372,6 +440,18 @@ public:
         if (!list->is_expression()) {
             evaluation.message(m_symbol, "normal");
         } else {
+	        const NativePredicate predicate = cond->is_symbol() ?
+		        NativePredicate::function(cond->symbol()) :
+		        NativePredicate::pure_function(cond);
+
+	        if (predicate.defined()) {
+		        const BaseExpressionRef result = select_packed(
+			        list->as_expression()->head(), list->as_expression(), predicate);
+		        if (result) {
+			        return result;
+		        }
+	        }
+
 	        return list->as_expression()->with_slice(
 			    [list, &cond, &evaluation] (const auto &slice) {
 
@@ -433,6 +513,24 @@ public:
         try {
             const Levelspec levelspec(ls);
 
+            // the leaves of a packed list are atoms at level 1 and the list
+            // itself has depth 1, so for the usual levelspecs we only need to
+            // look at the leaves, which we can often do without boxing them.
+
+            if (!options.Heads->is_true() &&
+                levelspec.is_in_level(1, 0) && !levelspec.is_in_level(0, 1) &&
+                is_packed_slice(list->as_expression()->slice_code())) {
+
+                const NativePattern native(patt);
+                if (native.defined()) {
+                    const BaseExpressionRef result = select_packed(
+                        evaluation.List, list->as_expression(), native);
+                    if (result) {
+                        return result;
+                    }
+                }
+            }
+
 	        const auto generate = [&list, &evaluation, &options, &levelspec] (const auto &match) {
 		        return expression(
 			        evaluation.List, sequential([&list, &evaluation, &options, &levelspec, &match] (auto &store) {
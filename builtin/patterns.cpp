@@ -2,6 +2,7 @@
 #include "levelspec.tcc"
 #include "arithmetic/binary.h"
 #include "arithmetic/unary.h"
+#include "../core/pattern/predicate.h"
 
 template<bool Repeated, typename Match>
 class DoReplaceAll {
@@ -609,6 +610,31 @@ public:
     }
 };
 
+// match_packed() tells whether predicate is true for all leaves of a packed
+// slice, working on the unboxed values.
+
+template<typename Slice, typename Predicate>
+inline tribool match_packed(const Slice &slice, const Predicate &predicate) {
+    return undecided;
+}
+
+template<typename U, typename Predicate>
+tribool match_packed(const PackedSlice<U> &slice, const Predicate &predicate) {
+    tribool result = true;
+    for (const U x : slice.template primitives<U>()) {
+        switch (predicate(x)) {
+            case true:
+                break;
+            case false:
+                return false;
+            default:
+                result = undecided;
+                break;
+        }
+    }
+    return result;
+}
+
 class MatchQ : public Builtin {
 public:
     static constexpr const char *name = "MatchQ";
@@ -625,6 +651,10 @@ public:
      = False
     >> MatchQ[_Integer][123]
      = True
+    >> MatchQ[Range[20], {__Integer}]
+     = True
+    >> MatchQ[Range[20], {x__Real}]
+     = False
 	)";
 
 public:
@@ -640,6 +670,21 @@ public:
         const BaseExpressionPtr pattern,
         const Evaluation &evaluation) {
 
+        // {__Integer}, {x___Real} and the like on a packed list.
+        if (expr->is_list() && pattern->has_form(S::List, 1) &&
+            is_packed_slice(expr->as_expression()->slice_code())) {
+
+            const NativePattern native(pattern->as_expression()->n_leaves<1>()[0].get(), true);
+            if (native.defined()) {
+                const tribool result = expr->as_expression()->with_slice([&native] (const auto &slice) {
+                    return match_packed(slice, native);
+                });
+                if (result != undecided) {
+                    return evaluation.Boolean(result == true);
+                }
+            }
+        }
+
         return match(pattern, [expr, &evaluation] (const auto &match) {
             return evaluation.Boolean(match(expr));
         }, evaluation);
@@ -110,6 +110,18 @@ public:
     >> StringReplace["abcdabcdaabcabcd", {"abc" -> "Y", "d" -> "XXX"}]
      = YXXXYXXXaYYXXX
 
+    Of several rules matching at the same position, the first one is used:
+    >> StringReplace["abcabc", {"bc" -> "X", "ab" -> "Y", "abc" -> "Z"}]
+     = YcYc
+    >> StringReplace["abcd", {"bc" -> "X", "abcd" -> "Y"}]
+     = Y
+    >> StringReplace["aBxAb", {"ab" -> "1", "xa" -> "2"}, IgnoreCase -> True]
+     = 12b
+
+    A match that overlaps a replaced one does not hide later matches of its rule:
+    >> StringReplace["xaaa", {"xa" -> "1", "a" ~~ "a" -> "2"}]
+     = 12
+
 
     >> StringReplace["  Have a nice day.  ", (StartOfString ~~ Whitespace) | (Whitespace ~~ EndOfString) -> ""] // FullForm
      = "Have a nice day."
@@ -118,6 +130,8 @@ public:
      = 01XY
     >> StringReplace["xyXY", "xy" -> "01", IgnoreCase -> True]
      = 0101
+    >> StringReplace["Grüße aus KÖLN", "köln" -> "Bonn", IgnoreCase -> True]
+     = Grüße aus Bonn
 
     StringReplace also can be used as an operator:
     >> StringReplace["y" -> "ies"]["city"]
@@ -153,6 +167,14 @@ private:
 
         const StringPtr string = text->as_string();
 
+        if (string->ascii() && patt->is_expression()) {
+            const LiteralAutomatonRef automaton = patt->as_expression()->ensure_cache()->literal_automaton(
+                patt, options.IgnoreCase->is_true());
+            if (automaton->is_applicable()) {
+                return automaton->replace(string, n_to_replace);
+            }
+        }
+
         TemporaryRefVector chunks;
         size_t last_index = 0;
 
@@ -211,11 +233,18 @@ private:
                 const auto &rule = rules.back();
                 const auto &iterator = std::get<1>(rule);
 
-                if (!push(iterator, std::get<2>(rule))) {
+                bool found;
+                if (iterator->begin() < index_t(last_index)) {
+                    // this match overlaps one that has already been replaced,
+                    // but the rule might match again right after that one.
+                    found = iterator->next(last_index);
+                } else if (!push(iterator, std::get<2>(rule))) {
                     break;
+                } else {
+                    found = iterator->next();
                 }
 
-                if (iterator->next()) {
+                if (found) {
                     std::push_heap(rules.begin(), rules.end(), compare);
                 } else {
                     rules.pop_back();
@@ -389,6 +418,256 @@ public:
 	}
 };
 
+// the following builtins return substrings as views on the extent of the
+// original string, so that e.g. splitting a large file into lines does not
+// copy any characters.
+
+template<typename F>
+inline BaseExpressionRef map_strings(
+	const SymbolRef &symbol,
+	BaseExpressionPtr text,
+	const F &f,
+	const Evaluation &evaluation) {
+
+	if (text->is_string()) {
+		return f(text->as_string());
+	} else if (text->is_list()) {
+		const Expression * const list = text->as_expression();
+		const bool all_strings = list->with_slice([] (const auto &slice) {
+			const size_t n = slice.size();
+			for (size_t i = 0; i < n; i++) {
+				if (!slice[i]->is_string()) {
+					return false;
+				}
+			}
+			return true;
+		});
+		if (all_strings) {
+			return list->map(evaluation.List, [&f] (const auto &leaf) -> BaseExpressionRef {
+				return f(leaf->as_string());
+			});
+		}
+	}
+
+	evaluation.message(symbol, "string");
+	return BaseExpressionRef();
+}
+
+struct StringSplitOptions {
+	BaseExpressionPtr IgnoreCase;
+};
+
+class StringSplit : public Builtin {
+public:
+	static constexpr const char *name = "StringSplit";
+
+	static constexpr const char *docs = R"(
+    <dl>
+    <dt>'StringSplit["$s$"]'
+        <dd>splits the string $s$ at whitespace.
+    <dt>'StringSplit["$s$", $patt$]'
+        <dd>splits $s$ into substrings separated by matches of $patt$.
+    <dt>'StringSplit["$s$", $patt$ -> $rhs$]'
+        <dd>inserts $rhs$ in place of each separator.
+    <dt>'StringSplit[{"$s1$", "$s2$", ...}, $patt$]'
+        <dd>splits each string in a list.
+    </dl>
+
+    >> StringSplit["  a bc  d "]
+     = {a, bc, d}
+
+    Empty substrings are dropped only at the start and the end:
+    >> StringSplit[":a::b:", ":"]
+     = {a, , b}
+
+    >> StringSplit["a1b22c", DigitCharacter..]
+     = {a, b, c}
+
+    >> StringSplit["a,b", "," -> ";"]
+     = {a, ;, b}
+
+    >> StringSplit["aXbxc", "x", IgnoreCase -> True]
+     = {a, b, c}
+
+    >> StringSplit[{"a b", "c d"}, " "]
+     = {{a, b}, {c, d}}
+	)";
+
+public:
+	using Builtin::Builtin;
+
+	void build(Runtime &runtime) {
+		static const OptionsInitializerList options = {
+			{"IgnoreCase", offsetof(StringSplitOptions, IgnoreCase), "False"}
+		};
+
+		builtin("StringSplit[text_]", "StringSplit[text, Whitespace]");
+
+		builtin(options, &StringSplit::apply);
+	}
+
+	inline BaseExpressionRef apply(
+		BaseExpressionPtr text,
+		BaseExpressionPtr patt,
+		const StringSplitOptions &options,
+		const Evaluation &evaluation) {
+
+		const OptionalRuleForm rule_form(patt);
+		const StringCases cases(rule_form.is_rule() ? rule_form.left_side().get() : patt, evaluation);
+		const bool ignore_case = options.IgnoreCase->is_true();
+
+		return map_strings(m_symbol, text, [&cases, &rule_form, ignore_case, &evaluation] (const String *string) {
+			return expression(evaluation.List, sequential([string, &cases, &rule_form, ignore_case, &evaluation] (auto &store) {
+				const auto iterator = cases(string, ignore_case);
+
+				index_t last = 0;
+				bool leading = true;
+
+				while (iterator->next()) {
+					const index_t begin = iterator->begin();
+					if (!leading || begin > last) {
+						store(string->substr(last, begin));
+					}
+					if (rule_form.is_rule()) {
+						store(rule_form.right_side()->replace_all_or_copy(iterator->match(), evaluation));
+					}
+					last = iterator->end();
+					leading = false;
+				}
+
+				if (last < index_t(string->length())) {
+					store(string->substr(last));
+				}
+			}));
+		}, evaluation);
+	}
+};
+
+struct StringPositionOptions {
+	BaseExpressionPtr Overlaps;
+	BaseExpressionPtr IgnoreCase;
+};
+
+class StringPosition : public Builtin {
+public:
+	static constexpr const char *name = "StringPosition";
+
+	static constexpr const char *docs = R"(
+    <dl>
+    <dt>'StringPosition["$s$", $patt$]'
+        <dd>gives a list of the start and end positions of the substrings
+        of $s$ that match $patt$.
+    </dl>
+
+    >> StringPosition["abcabc", "bc"]
+     = {{2, 3}, {5, 6}}
+
+    Matches may overlap unless Overlaps is False:
+    >> StringPosition["aaa", "aa"]
+     = {{1, 2}, {2, 3}}
+    >> StringPosition["aaa", "aa", Overlaps -> False]
+     = {{1, 2}}
+
+    >> StringPosition["a1b22", DigitCharacter..]
+     = {{2, 2}, {4, 5}, {5, 5}}
+	)";
+
+public:
+	using Builtin::Builtin;
+
+	void build(Runtime &runtime) {
+		static const OptionsInitializerList options = {
+			{"Overlaps", offsetof(StringPositionOptions, Overlaps), "True"},
+			{"IgnoreCase", offsetof(StringPositionOptions, IgnoreCase), "False"}
+		};
+
+		builtin(options, &StringPosition::apply);
+	}
+
+	inline BaseExpressionRef apply(
+		BaseExpressionPtr text,
+		BaseExpressionPtr patt,
+		const StringPositionOptions &options,
+		const Evaluation &evaluation) {
+
+		const StringCases cases(patt, evaluation);
+		const bool overlap = options.Overlaps->is_true();
+		const bool ignore_case = options.IgnoreCase->is_true();
+
+		return map_strings(m_symbol, text, [&cases, overlap, ignore_case, &evaluation] (const String *string) {
+			return expression(evaluation.List, sequential([string, &cases, overlap, ignore_case, &evaluation] (auto &store) {
+				const auto iterator = cases(string, ignore_case);
+				iterator->set_overlap(overlap);
+				while (iterator->next()) {
+					store(expression(
+						evaluation.List,
+						MachineInteger::construct(iterator->begin() + 1),
+						MachineInteger::construct(iterator->end())));
+				}
+			}));
+		}, evaluation);
+	}
+};
+
+struct StringCountOptions {
+	BaseExpressionPtr Overlaps;
+	BaseExpressionPtr IgnoreCase;
+};
+
+class StringCount : public Builtin {
+public:
+	static constexpr const char *name = "StringCount";
+
+	static constexpr const char *docs = R"(
+    <dl>
+    <dt>'StringCount["$s$", $patt$]'
+        <dd>counts the substrings of $s$ that match $patt$.
+    </dl>
+
+    >> StringCount["abcabc", "bc"]
+     = 2
+    >> StringCount["aaa", "aa"]
+     = 1
+    >> StringCount["aaa", "aa", Overlaps -> True]
+     = 2
+    >> StringCount[{"a b", "a b c"}, Whitespace]
+     = {1, 2}
+	)";
+
+public:
+	using Builtin::Builtin;
+
+	void build(Runtime &runtime) {
+		static const OptionsInitializerList options = {
+			{"Overlaps", offsetof(StringCountOptions, Overlaps), "False"},
+			{"IgnoreCase", offsetof(StringCountOptions, IgnoreCase), "False"}
+		};
+
+		builtin(options, &StringCount::apply);
+	}
+
+	inline BaseExpressionRef apply(
+		BaseExpressionPtr text,
+		BaseExpressionPtr patt,
+		const StringCountOptions &options,
+		const Evaluation &evaluation) {
+
+		const StringCases cases(patt, evaluation);
+		const bool overlap = options.Overlaps->is_true();
+		const bool ignore_case = options.IgnoreCase->is_true();
+
+		return map_strings(m_symbol, text, [&cases, overlap, ignore_case] (const String *string) {
+			const auto iterator = cases(string, ignore_case);
+			iterator->set_overlap(overlap);
+			machine_integer_t count = 0;
+			while (iterator->next()) {
+				count++;
+			}
+			return MachineInteger::construct(count);
+		}, evaluation);
+	}
+};
+
 class StringJoin : public BinaryOperatorBuiltin {
 public:
     static constexpr const char *name = "StringJoin";
@@ -666,6 +945,9 @@ void Builtins::Strings::initialize() {
 	add<StringMatchQ>();
     add<StringReplace>();
 	add<StringCasesBuiltin>();
+	add<StringSplit>();
+	add<StringPosition>();
+	add<StringCount>();
     add<StringJoin>();
     add<StringRepeat>();
     add<StringLength>();
@@ -7,6 +7,8 @@ Parallel *Parallel::s_instance = nullptr;
 
 thread_local ParallelContext Parallel::t_context;
 
+std::atomic<size_t> Parallel::s_running(0);
+
 constexpr int queue_size = 32;
 
 // FORCE_SEQUENTIAL_EXECUTION makes all parallelize calls
@@ -267,6 +269,10 @@ void Parallel::parallelize(const ParallelTask::Lambda &lambda, size_t n, const E
 	ParallelContext &context = t_context;
 	ParallelContext parent = context;
 
+	// from now on, other threads might share objects with us; this needs to
+	// happen before the task gets published to other threads in enqueue().
+	s_running.fetch_add(1);
+
 	ParallelTask task(lambda, n, evaluation.definitions.version(), evaluation);
 	bool enqueued = false;
 
@@ -303,6 +309,9 @@ void Parallel::parallelize(const ParallelTask::Lambda &lambda, size_t n, const E
 
 	assert(!task.enqueued);
 	assert(task.busy == 0);
+
+	// all workers are done with our task at this point (see release()).
+	s_running.fetch_sub(1);
 }
 
 Parallel::Thread::Thread(Parallel *parallel, ThreadNumber thread_number) :
@@ -201,6 +201,11 @@ private:
 
 	static thread_local ParallelContext t_context;
 
+	// the number of parallelize() calls currently running. as long as it's 0,
+	// the main thread is the only thread that touches any object, and the
+	// reference counts of Shared objects can be updated without atomic RMW.
+	static std::atomic<size_t> s_running;
+
 	enum ThreadState {
 		run,
 		block,
@@ -273,6 +278,10 @@ public:
 		return t_context;
 	}
 
+	static inline bool is_sequential() {
+		return s_running.load(std::memory_order_relaxed) == 0;
+	}
+
 	void parallelize(const ParallelTask::Lambda &lambda, size_t n, const Evaluation &evaluation);
 };
 
@@ -2,6 +2,7 @@
 #include "core/expression/implementation.h"
 #include "integer.h"
 #include "core/evaluation.h"
+#include "core/digits.h"
 
 std::string MachineInteger::debugform() const {
 	return std::to_string(value);
@@ -11,11 +12,13 @@ BaseExpressionRef MachineInteger::make_boxes(
     BaseExpressionPtr form,
     const Evaluation &evaluation) const {
 
-    return String::construct(std::to_string(value));
+    char buffer[MaxIntegerDigits + 1];
+    return String::construct(std::string(buffer, integer_text(buffer, value)));
 }
 
 std::string MachineInteger::boxes_to_text(const StyleBoxOptions &options, const Evaluation &evaluation) const {
-	return std::to_string(value);
+	char buffer[MaxIntegerDigits + 1];
+	return std::string(buffer, integer_text(buffer, value));
 }
 
 BaseExpressionPtr MachineInteger::head(const Symbols &symbols) const {
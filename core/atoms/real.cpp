@@ -5,6 +5,7 @@
 #include "core/types.h"
 #include "real.h"
 #include "core/expression/implementation.h"
+#include "core/digits.h"
 
 const std::hash<machine_real_t> MachineReal::hash_function = std::hash<machine_real_t>();
 
@@ -141,6 +142,18 @@ inline SExp real_to_s_exp(
 }
 
 optional<SExp> MachineReal::to_s_exp(optional<machine_integer_t> &n) const {
+	// the same digits as printf below, computed from the shortest ones.
+	if (!n || *n >= 1) {
+		RealDigits d;
+		const int precision = n ? int(std::min(*n - 1, machine_integer_t(15))) : -1;
+		if (printf_digits(value, precision, d)) {
+			if (!n) {
+				n = 6;
+			}
+			return SExp(String::construct(std::string(d.digits, d.length)), d.exp, d.negative ? 0 : 1, false);
+		}
+	}
+
 	std::string s;
 	if (n) {
         const std::string format(
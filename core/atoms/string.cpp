@@ -5,6 +5,174 @@
 #include "unicode/brkiter.h"
 #include "unicode/normalizer2.h"
 #include "unicode/errorcode.h"
+#include "unicode/uchar.h"
+
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// the length of the longest ASCII prefix of s.
+inline size_t ascii_prefix(const char *s, size_t n) {
+	size_t i = 0;
+
+#if defined(__SSE2__)
+	for (; i + 16 <= n; i += 16) {
+		const int mask = _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i)));
+		if (mask) {
+			return i + __builtin_ctz(mask);
+		}
+	}
+#endif
+
+	for (; i + 8 <= n; i += 8) {
+		uint64_t word;
+		std::memcpy(&word, s + i, 8);
+		if (word & 0x8080808080808080ull) {
+			break;
+		}
+	}
+
+	for (; i < n; i++) {
+		if (s[i] & 0x80) {
+			break;
+		}
+	}
+
+	return i;
+}
+
+// writes the n ASCII characters of s as UTF-16 to out.
+inline void widen_ascii(const char *s, size_t n, UChar *out) {
+	size_t i = 0;
+
+#if defined(__SSE2__)
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 16 <= n; i += 16) {
+		const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_unpacklo_epi8(bytes, zero));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8), _mm_unpackhi_epi8(bytes, zero));
+	}
+#endif
+
+	for (; i < n; i++) {
+		out[i] = UChar(static_cast<unsigned char>(s[i]));
+	}
+}
+
+// SimpleCodePoints tells which BMP code points can be taken over as they are
+// into a SimpleStringExtent: a text consisting only of such code points is in
+// NFC (no code point can change or combine with a neighbour under NFC) and
+// each code point is a character (grapheme cluster) of its own, except for
+// CR LF, which callers need to check for.
+
+class SimpleCodePoints {
+private:
+	std::vector<bool> m_simple;
+
+public:
+	SimpleCodePoints() : m_simple(0x10000, false) {
+		for (UChar32 c = 0; c < 0x10000; c++) {
+			if (U_IS_SURROGATE(c)) {
+				continue;
+			}
+
+			switch (u_getIntPropertyValue(c, UCHAR_GRAPHEME_CLUSTER_BREAK)) {
+				case U_GCB_OTHER:
+				case U_GCB_CONTROL:
+				case U_GCB_CR:
+				case U_GCB_LF:
+				case U_GCB_LV:
+				case U_GCB_LVT:
+					break;
+				default:
+					continue;
+			}
+
+			m_simple[c] = u_getCombiningClass(c) == 0 &&
+				u_getIntPropertyValue(c, UCHAR_NFC_QUICK_CHECK) == UNORM_YES;
+		}
+	}
+
+	static const SimpleCodePoints &instance() {
+		static const SimpleCodePoints simple;
+		return simple;
+	}
+
+	inline bool operator()(UChar32 c) const {
+		return m_simple[c];
+	}
+};
+
+// transcodes utf8 into UTF-16 without going through ICU's normalization and
+// break iteration, which is only possible if utf8 is valid, contains no
+// code points outside the BMP and consists only of SimpleCodePoints. returns
+// false if this is not the case.
+
+bool transcode_simple(const std::string &utf8, UnicodeString &text) {
+	const size_t n = utf8.size();
+	const char * const s = utf8.data();
+
+	for (const char *cr = static_cast<const char*>(std::memchr(s, '\r', n));
+		cr; cr = static_cast<const char*>(std::memchr(cr + 1, '\r', s + n - (cr + 1)))) {
+		if (cr + 1 < s + n && cr[1] == '\n') {
+			return false; // one character, as opposed to ASCII strings.
+		}
+	}
+
+	const SimpleCodePoints &simple = SimpleCodePoints::instance();
+
+	UChar * const out = text.getBuffer(int32_t(n) + 1); // UTF-16 never needs more units than UTF-8 bytes
+	if (!out) {
+		return false;
+	}
+
+	size_t i = 0;
+	size_t j = 0;
+	bool valid = true;
+
+	while (true) {
+		const size_t k = ascii_prefix(s + i, n - i);
+		widen_ascii(s + i, k, out + j);
+		i += k;
+		j += k;
+
+		if (i >= n) {
+			break;
+		}
+
+		const unsigned char c0 = s[i];
+		UChar32 c;
+
+		if ((c0 & 0xe0) == 0xc0 && i + 1 < n && (s[i + 1] & 0xc0) == 0x80) {
+			c = ((c0 & 0x1f) << 6) | (s[i + 1] & 0x3f);
+			valid = c >= 0x80;
+			i += 2;
+		} else if ((c0 & 0xf0) == 0xe0 && i + 2 < n &&
+			(s[i + 1] & 0xc0) == 0x80 && (s[i + 2] & 0xc0) == 0x80) {
+			c = ((c0 & 0x0f) << 12) | ((s[i + 1] & 0x3f) << 6) | (s[i + 2] & 0x3f);
+			valid = c >= 0x800 && !U_IS_SURROGATE(c);
+			i += 3;
+		} else {
+			valid = false; // invalid, or outside the BMP
+		}
+
+		if (!valid || !simple(c)) {
+			valid = false;
+			break;
+		}
+
+		out[j++] = UChar(c);
+	}
+
+	text.releaseBuffer(valid ? int32_t(j) : 0);
+	return valid;
+}
+
+} // namespace
 
 std::string String::debugform() const {
 	return std::string("\"") + utf8() + std::string("\"");
@@ -92,11 +260,11 @@ StringExtentRef string_extent_from_normalized(UnicodeString &&normalized, uint8_
 		}
 
 		if (is_ascii) {
-			std::string ascii;
-			ascii.reserve(size);
+			std::string ascii(size, '\0');
+			char * const data = &ascii[0];
 
 			for (size_t i = 0; i < size; i++) {
-				ascii.append(1, char(buffer[i]));
+				data[i] = char(buffer[i]);
 			}
 
 			return AsciiStringExtent::construct(std::move(ascii));
@@ -124,18 +292,13 @@ StringExtentRef string_extent_from_normalized(UnicodeString &&normalized, uint8_
 }
 
 StringExtentRef make_string_extent(std::string &&utf8) {
-    bool is_ascii = true;
-	const size_t size = utf8.size();
-
-    for (size_t i = 0; i < size; i++) {
-        if (utf8[i] >> 7) {
-			is_ascii = false;
-            break;
-        }
+    if (ascii_prefix(utf8.data(), utf8.size()) == utf8.size()) {
+        return AsciiStringExtent::construct(std::move(utf8));
     }
 
-    if (is_ascii) {
-        return AsciiStringExtent::construct(std::move(utf8));
+    UnicodeString simple;
+    if (transcode_simple(utf8, simple)) {
+        return SimpleStringExtent::construct(simple);
     }
 
     UErrorCode status = U_ZERO_ERROR;
@@ -165,111 +328,103 @@ std::vector<int32_t> make_character_offsets(const UnicodeString &normalized) {
 
 hash_t StringExtent::hash(size_t offset, size_t length) const {
     const std::string s(utf8(offset, length));
-    return djb2(s.c_str());
+    return hash_bytes(s.data(), s.size());
 }
 
-struct eq_ascii_ascii {
-    template<typename Eq>
-    static inline bool equals(
-        const Eq &eq,
-        const char *x,
-        const char *y,
-        size_t n) {
+namespace {
 
-        for (size_t i = 0; i < n; i++) {
-            if (!eq(x[i], y[i])) {
-                return false;
-            }
-        }
+// the case folded shadows of extents are built once, on the first comparison
+// under IgnoreCase, and then never replaced, so references to them stay valid
+// for the lifetime of the extent.
 
-        return true;
+template<typename T, typename F>
+inline const T &folded_shadow(std::shared_ptr<const T> &cache, const F &fold) { // concurrent
+    std::shared_ptr<const T> shadow = std::atomic_load(&cache);
+    if (!shadow) {
+        const std::shared_ptr<const T> new_shadow = std::make_shared<const T>(fold());
+        std::shared_ptr<const T> expected;
+        if (std::atomic_compare_exchange_strong(&cache, &expected, new_shadow)) {
+            shadow = new_shadow;
+        } else {
+            shadow = expected;
+        }
     }
-};
+    return *shadow;
+}
+
+// simple case folding maps each code point to one code point, and none of
+// these cross between the BMP and the supplementary planes (e.g. Deseret
+// U+10400 folds to U+10428). so unlike full case folding (e.g. "ß" to "ss")
+// the folded text keeps all offsets.
+
+UnicodeString fold_code_units(const UnicodeString &s) {
+    const int32_t n = s.length();
+    const UChar * const text = s.getBuffer();
+
+    UnicodeString folded(n, 0, 0);
+    if (n > 0) {
+        UChar * const out = folded.getBuffer(n);
+        for (int32_t i = 0; i < n; ) {
+            const UChar c = text[i];
+            if (c < 128) {
+                out[i++] = (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+                continue;
+            }
+
+            // unpaired surrogates come out of U16_NEXT as they are.
+            int32_t j = i;
+            UChar32 code_point;
+            U16_NEXT(text, i, n, code_point);
 
-struct eq_ascii_simple {
-    template<typename Eq>
-    static inline bool equals(
-        const Eq &eq,
-        const AsciiStringExtent *y,
-        size_t iy,
-        const SimpleStringExtent *x,
-        size_t ix,
-        size_t n) {
-
-        const char *const ascii = y->data() + iy;
-        const auto simple = x->unicode();
-
-        for (size_t i = 0; i < n; i++) {
-            if (!eq(simple.charAt(ix + i), ascii[i])) {
-                return false;
+            UChar32 f = u_foldCase(code_point, U_FOLD_CASE_DEFAULT);
+            if (U16_LENGTH(f) != i - j) {
+                f = code_point; // never move offsets
             }
+            U16_APPEND_UNSAFE(out, j, f);
         }
-
-        return true;
+        folded.releaseBuffer(n);
     }
-};
-
-struct eq_ascii_complex {
-    template<typename Eq>
-    static inline bool equals(
-        const Eq &eq,
-        const AsciiStringExtent *y,
-        size_t iy,
-        const ComplexStringExtent *x,
-        size_t ix,
-        size_t n) {
-
-        const char *const ascii = y->data() + iy;
-        const auto complex = x->unicode();
 
-        const size_t cp_ix = x->offsets()[ix];
-        const size_t cp_n = x->offsets()[ix + n] - cp_ix;
+    return folded;
+}
 
-        if (cp_n != n) {
+inline bool same_ascii_units(const char *ascii, const UChar *units, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (units[i] != UChar(ascii[i])) {
             return false;
         }
-
-        for (size_t i = 0; i < n; i++) {
-            if (!eq(complex.charAt(cp_ix + i), ascii[i])) {
-                return false;
-            }
-        }
-        return true;
     }
-};
+    return true;
+}
 
-template<typename Func, typename... Args>
-bool eq_string(bool ignore_case, Args... args) {
-    if (!ignore_case) {
-        const auto eq = [] (auto c1, auto c2) {
-            return c1 == c2;
-        };
-        return Func::equals(eq, args...);
-    } else {
-        const auto eq = [] (UChar c1, UChar c2) {
-            UErrorCode error;
-            return u_strCaseCompare(&c1, 1, &c2, 1, 0, &error) == 0;
-        };
-        return Func::equals(eq, args...);
-    }
+inline bool same_ascii_simple(
+    const char *ascii,
+    const UnicodeString &simple,
+    size_t ix,
+    size_t n) {
+
+    return same_ascii_units(ascii, simple.getBuffer() + ix, n);
 }
 
-inline int compare_unicode(
-    const UnicodeString &a,
-    int32_t a_start,
-    int32_t a_length,
-    const UnicodeString& b,
-    int32_t b_start,
-    int32_t b_length,
-    bool ignore_case) {
+inline bool same_ascii_complex(
+    const char *ascii,
+    const UnicodeString &complex,
+    const std::vector<int32_t> &offsets,
+    size_t ix,
+    size_t n) {
 
-    if (!ignore_case) {
-        return a.compare(a_start, a_length, b, b_start, b_length);
-    } else {
-        return a.caseCompare(a_start, a_length, b, b_start, b_length, 0);
+    const size_t cp_ix = offsets[ix];
+    const size_t cp_n = offsets[ix + n] - cp_ix;
+
+    if (cp_n != n) {
+        return false;
     }
+
+    return same_ascii_units(ascii, complex.getBuffer() + cp_ix, n);
 }
 
+} // namespace
+
 AsciiStringExtent::~AsciiStringExtent() {
 }
 
@@ -278,14 +433,30 @@ UnicodeString AsciiStringExtent::unicode() const { // concurrent
     if (string) {
         return *string;
     } else {
-        const UnicodeStringRef new_string = std::make_shared<UnicodeString>(
-            UnicodeString::fromUTF8(StringPiece(m_ascii)));
+        const int32_t n = int32_t(m_ascii.size());
+        const UnicodeStringRef new_string = std::make_shared<UnicodeString>(n, 0, 0);
+        if (n > 0) {
+            widen_ascii(m_ascii.data(), n, new_string->getBuffer(n));
+            new_string->releaseBuffer(n);
+        }
 
         std::atomic_store(&m_string, new_string);
         return *new_string;
     }
 }
 
+const std::string &AsciiStringExtent::folded() const { // concurrent
+    return folded_shadow(m_folded, [this] () {
+        std::string folded(m_ascii);
+        for (char &c : folded) {
+            if (c >= 'A' && c <= 'Z') {
+                c += 'a' - 'A';
+            }
+        }
+        return folded;
+    });
+}
+
 size_t AsciiStringExtent::length() const {
     return m_ascii.size();
 }
@@ -302,6 +473,11 @@ std::string AsciiStringExtent::utf8(size_t offset, size_t length) const {
     return std::string(m_ascii.data() + offset, length);
 }
 
+hash_t AsciiStringExtent::hash(size_t offset, size_t length) const {
+    // same as StringExtent::hash(), as our ascii is also valid utf8.
+    return hash_bytes(m_ascii.data() + offset, length);
+}
+
 UnicodeString AsciiStringExtent::unicode(size_t offset, size_t length) const {
 	return UnicodeString(unicode(), offset, length);
 }
@@ -310,19 +486,36 @@ bool AsciiStringExtent::same_n(const StringExtent *extent, size_t offset, size_t
     switch (extent->type()) {
         case StringExtent::ascii: {
             const AsciiStringExtent *ascii_extent = static_cast<const AsciiStringExtent*>(extent);
-            return eq_string<eq_ascii_ascii>(ignore_case, m_ascii.data() + offset, ascii_extent->m_ascii.data() + extent_offset, n);
+            if (ignore_case) {
+                return std::memcmp(folded().data() + offset, ascii_extent->folded().data() + extent_offset, n) == 0;
+            } else {
+                return std::memcmp(m_ascii.data() + offset, ascii_extent->m_ascii.data() + extent_offset, n) == 0;
+            }
         }
 
         case StringExtent::simple: {
             const SimpleStringExtent *simple_extent = static_cast<const SimpleStringExtent*>(extent);
-            return eq_string<eq_ascii_simple>(ignore_case, this, offset, simple_extent, extent_offset, n);
+            if (ignore_case) {
+                return same_ascii_simple(folded().data() + offset, simple_extent->folded(), extent_offset, n);
+            } else {
+                return same_ascii_simple(m_ascii.data() + offset, simple_extent->unicode(), extent_offset, n);
+            }
         }
 
 	    case StringExtent::complex: {
 		    const ComplexStringExtent *complex_extent = static_cast<const ComplexStringExtent*>(extent);
-		    return eq_string<eq_ascii_complex>(ignore_case, this, offset, complex_extent, extent_offset, n);
+		    if (ignore_case) {
+			    return same_ascii_complex(folded().data() + offset,
+			        complex_extent->folded(), complex_extent->offsets(), extent_offset, n);
+		    } else {
+			    return same_ascii_complex(m_ascii.data() + offset,
+			        complex_extent->unicode(), complex_extent->offsets(), extent_offset, n);
+		    }
 	    }
 
+	    case StringExtent::rope:
+	        return extent->same_n(this, extent_offset, offset, n, ignore_case);
+
 	    default:
             throw std::runtime_error("unsupported string extent type");
     }
@@ -353,6 +546,12 @@ UnicodeString SimpleStringExtent::unicode(size_t offset, size_t length) const {
 	return UnicodeString(m_string, offset, length);
 }
 
+const UnicodeString &SimpleStringExtent::folded() const { // concurrent
+    return folded_shadow(m_folded, [this] () {
+        return fold_code_units(m_string);
+    });
+}
+
 size_t SimpleStringExtent::length() const {
     return m_string.length();
 }
@@ -370,12 +569,20 @@ bool SimpleStringExtent::same_n(const StringExtent *extent, size_t offset, size_
     switch (extent->type()) {
         case StringExtent::ascii: {
             const AsciiStringExtent *ascii_extent = static_cast<const AsciiStringExtent*>(extent);
-            return eq_string<eq_ascii_simple>(ignore_case, ascii_extent, extent_offset, this, offset, n);
+            if (ignore_case) {
+                return same_ascii_simple(ascii_extent->folded().data() + extent_offset, folded(), offset, n);
+            } else {
+                return same_ascii_simple(ascii_extent->data() + extent_offset, m_string, offset, n);
+            }
         }
 
         case StringExtent::simple: {
             const SimpleStringExtent *simple_extent = static_cast<const SimpleStringExtent*>(extent);
-            return compare_unicode(m_string, offset, n, simple_extent->unicode(), extent_offset, n, ignore_case) == 0;
+            if (ignore_case) {
+                return folded().compare(offset, n, simple_extent->folded(), extent_offset, n) == 0;
+            } else {
+                return m_string.compare(offset, n, simple_extent->m_string, extent_offset, n) == 0;
+            }
         }
 
 	    case StringExtent::complex: {
@@ -385,9 +592,16 @@ bool SimpleStringExtent::same_n(const StringExtent *extent, size_t offset, size_
 		    if (cp_size != n) {
 			    return false;
 		    }
-            return compare_unicode(m_string, offset, n, complex_extent->unicode(), cp_offset, cp_size, ignore_case) == 0;
+		    if (ignore_case) {
+			    return folded().compare(offset, n, complex_extent->folded(), cp_offset, cp_size) == 0;
+		    } else {
+			    return m_string.compare(offset, n, complex_extent->unicode(), cp_offset, cp_size) == 0;
+		    }
 	    }
 
+        case StringExtent::rope:
+            return extent->same_n(this, extent_offset, offset, n, ignore_case);
+
         default:
             throw std::runtime_error("unsupported string extent type");
     }
@@ -421,6 +635,12 @@ UnicodeString ComplexStringExtent::unicode(size_t offset, size_t length) const {
 	return UnicodeString(m_string, cp_offset, m_offsets[offset + length] - cp_offset);
 }
 
+const UnicodeString &ComplexStringExtent::folded() const { // concurrent
+	return folded_shadow(m_folded, [this] () {
+		return fold_code_units(m_string);
+	});
+}
+
 size_t ComplexStringExtent::length() const {
 	return m_offsets.size() - 1;
 }
@@ -443,7 +663,11 @@ bool ComplexStringExtent::same_n(const StringExtent *extent, size_t offset, size
 	switch (extent->type()) {
 		case StringExtent::ascii: {
 			const AsciiStringExtent *ascii_extent = static_cast<const AsciiStringExtent*>(extent);
-			return eq_string<eq_ascii_complex>(ignore_case, ascii_extent, extent_offset, this, offset, n);
+			if (ignore_case) {
+				return same_ascii_complex(ascii_extent->folded().data() + extent_offset, folded(), m_offsets, offset, n);
+			} else {
+				return same_ascii_complex(ascii_extent->data() + extent_offset, m_string, m_offsets, offset, n);
+			}
 		}
 
 		case StringExtent::simple: {
@@ -453,8 +677,11 @@ bool ComplexStringExtent::same_n(const StringExtent *extent, size_t offset, size
 				return false;
 			}
 			const SimpleStringExtent *simple_extent = static_cast<const SimpleStringExtent*>(extent);
-			return compare_unicode(
-                m_string, cp_offset, cp_size, simple_extent->unicode(), extent_offset, n, ignore_case) == 0;
+			if (ignore_case) {
+				return folded().compare(cp_offset, cp_size, simple_extent->folded(), extent_offset, n) == 0;
+			} else {
+				return m_string.compare(cp_offset, cp_size, simple_extent->unicode(), extent_offset, n) == 0;
+			}
 		}
 
 		case StringExtent::complex: {
@@ -466,10 +693,18 @@ bool ComplexStringExtent::same_n(const StringExtent *extent, size_t offset, size
 			if (cp_size != extent_cp_size) {
 				return false;
 			}
-			return compare_unicode(
-				m_string, cp_offset, cp_size, complex_extent->unicode(), extent_cp_offset, extent_cp_size, ignore_case) == 0;
+			if (ignore_case) {
+				return folded().compare(
+					cp_offset, cp_size, complex_extent->folded(), extent_cp_offset, extent_cp_size) == 0;
+			} else {
+				return m_string.compare(
+					cp_offset, cp_size, complex_extent->m_string, extent_cp_offset, extent_cp_size) == 0;
+			}
 		}
 
+		case StringExtent::rope:
+		    return extent->same_n(this, extent_offset, offset, n, ignore_case);
+
 		default:
 			throw std::runtime_error("unsupported string extent type");
 	}
@@ -491,3 +726,186 @@ StringExtentRef ComplexStringExtent::repeat(size_t offset, size_t length, size_t
 size_t ComplexStringExtent::walk_code_points(size_t offset, index_t cp_offset) const {
     throw std::runtime_error("not implemented");
 }
+
+RopeStringExtent::RopeStringExtent(const Segment &left, const Segment &right) :
+	StringExtent(StringExtent::rope),
+	m_left(left),
+	m_right(right),
+	m_content_type(std::max(content_type(left), content_type(right))),
+	m_depth(1 + std::max(depth(left), depth(right))) {
+
+	assert(m_content_type != StringExtent::complex);
+}
+
+StringExtent::Type RopeStringExtent::content_type(const Segment &segment) {
+	const StringExtent * const extent = segment.extent.get();
+	if (extent->type() == StringExtent::rope) {
+		return static_cast<const RopeStringExtent*>(extent)->m_content_type;
+	} else {
+		return extent->type();
+	}
+}
+
+size_t RopeStringExtent::depth(const Segment &segment) {
+	const StringExtent * const extent = segment.extent.get();
+	if (extent->type() == StringExtent::rope) {
+		return static_cast<const RopeStringExtent*>(extent)->m_depth;
+	} else {
+		return 0;
+	}
+}
+
+const RopeStringExtent *RopeStringExtent::whole_rope(const Segment &segment) {
+	const StringExtent * const extent = segment.extent.get();
+	if (extent->type() == StringExtent::rope && segment.offset == 0 && segment.length == extent->length()) {
+		return static_cast<const RopeStringExtent*>(extent);
+	} else {
+		return nullptr;
+	}
+}
+
+RopeStringExtent::Segment RopeStringExtent::join(const Segment &x, const Segment &y) {
+	const size_t length = x.length + y.length;
+
+	if (std::max(content_type(x), content_type(y)) == StringExtent::ascii) {
+		std::string text;
+		text.reserve(length);
+		text.append(x.extent->utf8(x.offset, x.length));
+		text.append(y.extent->utf8(y.offset, y.length));
+		return Segment{AsciiStringExtent::construct(std::move(text)), 0, length};
+	} else {
+		UnicodeString text(x.extent->unicode(x.offset, x.length));
+		text.append(y.extent->unicode(y.offset, y.length));
+		return Segment{SimpleStringExtent::construct(text), 0, length};
+	}
+}
+
+RopeStringExtent::Segment RopeStringExtent::node(const Segment &x, const Segment &y) {
+	const ConstSharedPtr<RopeStringExtent> rope = RopeStringExtent::construct(x, y);
+	if (rope->m_depth > MaxDepth) {
+		return Segment{rope->flatten(), 0, x.length + y.length};
+	} else {
+		return Segment{rope, 0, x.length + y.length};
+	}
+}
+
+RopeStringExtent::Segment RopeStringExtent::concat(const Segment &x, const Segment &y) {
+	if (x.length == 0) {
+		return y;
+	} else if (y.length == 0) {
+		return x;
+	} else if (x.length + y.length < LeafLength) {
+		return join(x, y);
+	}
+
+	// appending to (or prepending to) a rope goes into its smaller side, as long
+	// as that side stays at most half as long as the other one. this keeps the
+	// depth logarithmic for loops like s = s <> "chunk".
+
+	const RopeStringExtent * const left = whole_rope(x);
+	if (left && left->m_left.length >= 2 * (left->m_right.length + y.length)) {
+		return node(left->m_left, concat(left->m_right, y));
+	}
+
+	const RopeStringExtent * const right = whole_rope(y);
+	if (right && right->m_right.length >= 2 * (x.length + right->m_left.length)) {
+		return node(concat(x, right->m_left), right->m_right);
+	}
+
+	return node(x, y);
+}
+
+StringExtentRef RopeStringExtent::flatten() const {
+	const size_t n = length();
+
+	if (m_content_type == StringExtent::ascii) {
+		std::string text;
+		text.reserve(n);
+		segments(0, n, [&text] (const StringExtent *extent, size_t offset, size_t length) {
+			text.append(static_cast<const AsciiStringExtent*>(extent)->data() + offset, length);
+		});
+		return AsciiStringExtent::construct(std::move(text));
+	} else {
+		UnicodeString text(int32_t(n), 0, 0);
+		segments(0, n, [&text] (const StringExtent *extent, size_t offset, size_t length) {
+			text.append(extent->unicode(offset, length));
+		});
+		return SimpleStringExtent::construct(text);
+	}
+}
+
+UnicodeString RopeStringExtent::unicode() const {
+	return flat()->unicode();
+}
+
+size_t RopeStringExtent::length() const {
+	return m_left.length + m_right.length;
+}
+
+char RopeStringExtent::ascii_char_at(size_t offset) const {
+	char c = -1;
+	segments(offset, 1, [&c] (const StringExtent *extent, size_t offset, size_t length) {
+		c = extent->ascii_char_at(offset);
+	});
+	return c;
+}
+
+size_t RopeStringExtent::number_of_code_points(size_t offset, size_t length) const {
+	return length; // only ascii and simple extents are joined into ropes.
+}
+
+std::string RopeStringExtent::utf8(size_t offset, size_t length) const {
+	std::string s;
+	if (m_content_type == StringExtent::ascii) {
+		s.reserve(length);
+	}
+	segments(offset, length, [&s] (const StringExtent *extent, size_t offset, size_t length) {
+		if (extent->type() == StringExtent::ascii) {
+			s.append(static_cast<const AsciiStringExtent*>(extent)->data() + offset, length);
+		} else {
+			s.append(extent->utf8(offset, length));
+		}
+	});
+	return s;
+}
+
+UnicodeString RopeStringExtent::unicode(size_t offset, size_t length) const {
+	UnicodeString text(int32_t(length), 0, 0);
+	segments(offset, length, [&text] (const StringExtent *extent, size_t offset, size_t length) {
+		text.append(extent->unicode(offset, length));
+	});
+	return text;
+}
+
+hash_t RopeStringExtent::hash(size_t offset, size_t length) const {
+	if (m_content_type != StringExtent::ascii) {
+		return StringExtent::hash(offset, length);
+	}
+
+	// same as AsciiStringExtent::hash() on the flattened rope.
+	HashStream stream(length);
+	segments(offset, length, [&stream] (const StringExtent *extent, size_t offset, size_t length) {
+		stream.add(static_cast<const AsciiStringExtent*>(extent)->data() + offset, length);
+	});
+	return stream.get();
+}
+
+bool RopeStringExtent::same_n(const StringExtent *extent, size_t offset, size_t extent_offset, size_t n, bool ignore_case) const {
+	bool same = true;
+	size_t position = extent_offset;
+	segments(offset, n, [extent, ignore_case, &same, &position] (const StringExtent *segment, size_t offset, size_t length) {
+		if (same) {
+			same = segment->same_n(extent, offset, position, length, ignore_case);
+			position += length;
+		}
+	});
+	return same;
+}
+
+StringExtentRef RopeStringExtent::repeat(size_t offset, size_t length, size_t n) const {
+	return flat()->repeat(offset, length, n);
+}
+
+size_t RopeStringExtent::walk_code_points(size_t offset, index_t cp_offset) const {
+	return std::abs(cp_offset);
+}
@@ -12,7 +12,8 @@ public:
     enum Type {
         ascii,
         simple,
-        complex
+        complex,
+        rope // see RopeStringExtent
     };
 
 private:
@@ -56,6 +57,7 @@ private:
 
     const std::string m_ascii;
 	mutable UnicodeStringRef m_string;
+	mutable std::shared_ptr<const std::string> m_folded; // see folded()
 
 public:
     inline AsciiStringExtent(std::string &&ascii) : StringExtent(StringExtent::ascii), m_ascii(ascii) {
@@ -75,6 +77,10 @@ public:
 
 	virtual UnicodeString unicode() const final;
 
+	// m_ascii in lower case, built on first use and then kept, so that
+	// comparisons under IgnoreCase are plain comparisons of folded text.
+	const std::string &folded() const;
+
     virtual std::string utf8(size_t offset, size_t length) const final;
 
 	virtual UnicodeString unicode(size_t offset, size_t length) const final;
@@ -85,6 +91,8 @@ public:
 
 	virtual size_t number_of_code_points(size_t offset, size_t length) const final;
 
+    virtual hash_t hash(size_t offset, size_t length) const final;
+
     virtual bool same_n(const StringExtent *x, size_t offset, size_t x_offset, size_t n, bool ignore_case) const final;
 
 	virtual StringExtentRef repeat(size_t offset, size_t length, size_t n) const final;
@@ -113,6 +121,7 @@ class SimpleStringExtent : public StringExtent, public ExtendedHeapObject<Simple
 private:
     UnicodeString m_string;
 	std::vector<bool> m_word_boundaries;
+	mutable std::shared_ptr<const UnicodeString> m_folded; // see folded()
 
 public:
     inline SimpleStringExtent(UnicodeString &string) : StringExtent(StringExtent::simple) {
@@ -125,6 +134,10 @@ public:
         return m_string;
     }
 
+	// m_string with each code unit case folded, built on first use. it has
+	// the same length and offsets as m_string.
+	const UnicodeString &folded() const;
+
     virtual std::string utf8(size_t offset, size_t length) const final;
 
 	virtual UnicodeString unicode(size_t offset, size_t length) const final;
@@ -161,6 +174,7 @@ private:
     UnicodeString m_string;
 	std::vector<int32_t> m_offsets;
 	std::vector<bool> m_word_boundaries;
+	mutable std::shared_ptr<const UnicodeString> m_folded; // see folded()
 
 public:
     inline ComplexStringExtent(UnicodeString &normalized_string) :
@@ -185,6 +199,9 @@ public:
 		return m_offsets;
 	}
 
+	// like SimpleStringExtent::folded(), so m_offsets apply to it as well.
+	const UnicodeString &folded() const;
+
 	virtual std::string utf8(size_t offset, size_t length) const final;
 
 	virtual UnicodeString unicode(size_t offset, size_t length) const final;
@@ -218,6 +235,114 @@ public:
 	}
 };
 
+// RopeStringExtent is the concatenation of two segments of other extents, as
+// produced by StringJoin for long strings, so that building a string through
+// repeated joins (e.g. s = s <> "chunk") takes O(log n) per join instead of
+// copying all of s every time. only ascii and simple extents get joined into
+// ropes, as the length of a rope is the sum of its segments' lengths.
+
+// hashing, comparing and utf8() walk the segments; everything that needs
+// random access to the characters (e.g. pattern matching) goes through flat(),
+// which flattens the rope once and caches the result.
+
+class RopeStringExtent : public StringExtent, public ExtendedHeapObject<RopeStringExtent> {
+public:
+	enum {
+		MinLength = 1024, // StringJoin returns shorter strings as flat extents
+		LeafLength = 128, // shorter pieces of a rope get joined into one leaf
+		MaxDepth = 48 // deeper ropes get flattened
+	};
+
+	struct Segment {
+		StringExtentRef extent;
+		size_t offset;
+		size_t length;
+	};
+
+private:
+	const Segment m_left;
+	const Segment m_right;
+	const Type m_content_type;
+	const size_t m_depth;
+
+	mutable QuasiConstSharedPtr<StringExtent> m_flat;
+
+	StringExtentRef flatten() const;
+
+	static size_t depth(const Segment &segment);
+
+	static const RopeStringExtent *whole_rope(const Segment &segment);
+
+	static Segment join(const Segment &x, const Segment &y);
+
+	static Segment node(const Segment &x, const Segment &y);
+
+public:
+	RopeStringExtent(const Segment &left, const Segment &right);
+
+	static Type content_type(const Segment &segment);
+
+	// concatenates two segments of ascii or simple extents. keeps ropes
+	// balanced by descending into the smaller side of a rope first.
+	static Segment concat(const Segment &x, const Segment &y);
+
+	inline Type content_type() const {
+		return m_content_type;
+	}
+
+	inline StringExtent *flat() const { // concurrent.
+		return m_flat.ensure([this] () {
+			return flatten();
+		});
+	}
+
+	// calls f(extent, offset, length) for the flat extents making up the
+	// characters [offset, offset + length) of this rope, in order.
+	template<typename F>
+	void segments(size_t offset, size_t length, const F &f) const;
+
+	virtual UnicodeString unicode() const final;
+
+	virtual size_t length() const final;
+
+	virtual char ascii_char_at(size_t offset) const final;
+
+	virtual size_t number_of_code_points(size_t offset, size_t length) const final;
+
+	virtual std::string utf8(size_t offset, size_t length) const final;
+
+	virtual UnicodeString unicode(size_t offset, size_t length) const final;
+
+	virtual hash_t hash(size_t offset, size_t length) const final;
+
+	virtual bool same_n(const StringExtent *x, size_t offset, size_t x_offset, size_t n, bool ignore_case) const final;
+
+	virtual StringExtentRef repeat(size_t offset, size_t length, size_t n) const final;
+
+	virtual size_t walk_code_points(size_t offset, index_t cp_offset) const final;
+};
+
+template<typename F>
+void RopeStringExtent::segments(size_t offset, size_t length, const F &f) const {
+	const auto visit = [offset, length, &f] (const Segment &segment, size_t position) {
+		const size_t begin = std::max(offset, position);
+		const size_t end = std::min(offset + length, position + segment.length);
+		if (begin >= end) {
+			return;
+		}
+		const size_t extent_offset = segment.offset + (begin - position);
+		if (segment.extent->type() == rope) {
+			static_cast<const RopeStringExtent*>(segment.extent.get())->segments(
+				extent_offset, end - begin, f);
+		} else {
+			f(segment.extent.get(), extent_offset, end - begin);
+		}
+	};
+
+	visit(m_left, 0);
+	visit(m_right, m_left.length);
+}
+
 StringExtentRef make_string_extent(std::string &&utf8);
 
 StringExtentRef string_extent_from_normalized(UnicodeString &&normalized, uint8_t possible_types = 0xff);
@@ -238,8 +363,15 @@ protected:
     template<typename Extent>
     friend class CharacterSequence;
 
-    const StringExtentRef &extent() const {
-        return m_extent;
+    friend class StringAutomaton;
+
+    // the extent to access characters through, i.e. the flattened form of a rope.
+    inline StringExtent *extent() const {
+        if (m_extent->type() == StringExtent::rope) {
+            return static_cast<const RopeStringExtent*>(m_extent.get())->flat();
+        } else {
+            return m_extent.get();
+        }
     }
 
     inline size_t to_extent_offset(size_t offset) const {
@@ -286,7 +418,15 @@ public:
     virtual BaseExpressionPtr head(const Symbols &symbols) const final;
 
     inline StringExtent::Type extent_type() const {
-		return m_extent->type();
+	    if (m_extent->type() == StringExtent::rope) {
+		    return static_cast<const RopeStringExtent*>(m_extent.get())->content_type();
+	    } else {
+		    return m_extent->type();
+	    }
+	}
+
+	inline RopeStringExtent::Segment segment() const {
+		return RopeStringExtent::Segment{m_extent, size_t(m_offset), size_t(m_length)};
 	}
 
     inline bool same_n(const String *s, size_t offset, size_t n, bool ignore_case) const {
@@ -297,7 +437,7 @@ public:
         }
 
         return m_extent->same_n(
-            s->extent().get(), m_offset, s->to_extent_offset(offset), n, ignore_case);
+            s->m_extent.get(), m_offset, s->to_extent_offset(offset), n, ignore_case);
     }
 
     inline bool same_indeed(const String *s) const {
@@ -346,8 +486,9 @@ public:
     }
 
 	inline const char *ascii() const {
-		if (m_extent->type() == StringExtent::ascii) {
-			return static_cast<AsciiStringExtent*>(m_extent.get())->data() + m_offset;
+		const StringExtent * const extent = this->extent();
+		if (extent->type() == StringExtent::ascii) {
+			return static_cast<const AsciiStringExtent*>(extent)->data() + m_offset;
 		} else {
 			return nullptr;
 		}
@@ -491,7 +632,7 @@ public:
 
     inline CharacterSequence(MatchContext &context, const String *string) :
 	    m_context(context),
-        m_extent(static_cast<Extent*>(string->extent().get())),
+        m_extent(static_cast<Extent*>(string->extent())),
         m_offset(string->to_extent_offset(0)),
         m_length(string->length()) {
 
@@ -502,6 +643,11 @@ public:
 		return m_context;
 	}
 
+    // the subject string, and thus its extent, lives as long as the match.
+    inline std::tuple<const void*, index_t, BaseExpressionPtr> identity() const {
+        return std::make_tuple(static_cast<const void*>(m_extent), m_offset, BaseExpressionPtr(nullptr));
+    }
+
     inline Element element(index_t begin) const {
         return Element(this, begin);
     }
@@ -519,7 +665,7 @@ public:
             return -1;
         }
         if (m_extent->same_n(
-            other_string->extent().get(),
+            other_string->m_extent.get(),
             m_offset + begin,
             other_string->to_extent_offset(0),
             n,
@@ -568,6 +714,7 @@ StringRef string_array_join(const StringArray &array) {
 
     StringExtent::Type extent_type = StringExtent::ascii;
     size_t number_of_code_points = 0;
+    size_t length = 0;
 
     for (const auto &leaf : array) {
         if (!leaf->is_string()) {
@@ -577,6 +724,16 @@ StringRef string_array_join(const StringArray &array) {
             leaf->as_string()->extent_type());
         number_of_code_points +=
             leaf->as_string()->number_of_code_points();
+        length += leaf->as_string()->length();
+    }
+
+    if (extent_type != StringExtent::complex && length >= RopeStringExtent::MinLength) {
+        optional<RopeStringExtent::Segment> rope;
+        for (const auto &leaf : array) {
+            const RopeStringExtent::Segment segment = leaf->as_string()->segment();
+            rope = rope ? RopeStringExtent::concat(*rope, segment) : segment;
+        }
+        return String::construct(rope->extent, rope->offset, rope->length);
     }
 
     if (extent_type == StringExtent::ascii) {
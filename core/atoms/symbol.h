@@ -138,9 +138,7 @@ public:
 		return m_rules ? &m_rules->down_rules : nullptr;
 	}
 
-    inline void add_up_rule(const RuleRef &rule, const Evaluation &evaluation) {
-        mutable_rules()->up_rules.add(rule, evaluation);
-    }
+    void add_up_rule(const RuleRef &rule, const Evaluation &evaluation);
 
 	inline const Rules *up_rules() const {
 		return m_rules ? &m_rules->up_rules : nullptr;
@@ -236,6 +234,11 @@ public:
 
     void reset_user_definitions() const;
 
+	// whether this symbol's rules are still the ones it got as a builtin.
+	inline bool has_builtin_rules() const {
+		return m_builtin_state && state().rules() == m_builtin_state->rules();
+	}
+
     virtual BaseExpressionPtr head(const Symbols &symbols) const final;
 
 	virtual inline bool same_indeed(const BaseExpression &expr) const final {
@@ -4,6 +4,8 @@
 #include <unordered_set>
 #include "pattern/rewrite.h"
 #include "core/matcher/matcher.h"
+#include "core/matcher/pattern_cache.h"
+#include "core/pattern/literals.h"
 
 class Cache : public PoolObject<Cache> {
 private:
@@ -12,19 +14,29 @@ private:
 	CachedPatternMatcherRef m_expression_matcher;
 	CachedPatternMatcherRef m_string_matcher;
 
+	CachedLiteralAutomatonRef m_literal_automaton;
+
 public:
 	CachedSlotFunctionRef slot_function;
 	CachedRewriteExpressionRef vars_function;
 
+	inline LiteralAutomatonRef literal_automaton(BaseExpressionPtr rules, bool ignore_case) { // concurrent.
+		return LiteralAutomatonRef(m_literal_automaton.ensure([rules, ignore_case] () {
+			return LiteralAutomaton::construct(rules, ignore_case);
+		}, [ignore_case] (LiteralAutomaton *automaton) {
+			return automaton->ignore_case() == ignore_case;
+		}));
+	}
+
 	inline PatternMatcherRef expression_matcher(BaseExpressionPtr expr) { // concurrent.
         return PatternMatcherRef(m_expression_matcher.ensure([expr] () {
-            return compile_expression_pattern(BaseExpressionRef(expr));
+            return PatternCache::instance().expression_matcher(BaseExpressionRef(expr));
         }));
 	}
 
 	inline PatternMatcherRef string_matcher(BaseExpressionPtr expr) { // concurrent.
         return PatternMatcherRef(m_string_matcher.ensure([expr] () {
-            return compile_string_pattern(BaseExpressionRef(expr));
+            return PatternCache::instance().string_matcher(BaseExpressionRef(expr));
         }));
 	}
 
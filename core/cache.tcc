@@ -6,7 +6,6 @@ inline RewriteRef Cache::rewrite(
     const Evaluation &evaluation) { // concurrent.
 
     return RewriteRef(m_rewrite.ensure([&matcher, &rhs, &evaluation] () {
-        CompiledArguments arguments(matcher->variables());
-        return Rewrite::from_arguments(arguments, rhs, evaluation);
+        return PatternCache::instance().rewrite(matcher, rhs, evaluation);
     }));
 }
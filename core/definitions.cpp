@@ -120,6 +120,15 @@ void SymbolState::remove_attributes(Attributes attributes, const Evaluation &eva
     }
 }
 
+void SymbolState::add_up_rule(const RuleRef &rule, const Evaluation &evaluation) {
+	Rules &up_rules = mutable_rules()->up_rules;
+	const bool first = up_rules.empty();
+	up_rules.add(rule, evaluation);
+	if (first) {
+		evaluation.definitions.added_up_rules();
+	}
+}
+
 void SymbolState::add_rule(
 	BaseExpressionPtr lhs,
 	BaseExpressionPtr rhs,
@@ -196,6 +205,7 @@ bool SymbolState::has_format(
 
 Definitions::Definitions() :
     m_version(Version::construct()), // needed first
+    m_up_rules_generation(0),
     m_symbols(*this),
     number_form(m_symbols),
     zero(MachineInteger::construct(0)),
@@ -3,6 +3,7 @@
 
 #include "core/atoms/symbol.h"
 #include "numberform.h"
+#include "print.h"
 #include <unordered_map>
 
 class Definitions;
@@ -35,7 +36,19 @@ class Definitions {
 private:
     TaskLocalStorage<UnsafeSharedPtr<Version>> m_version;
 
+	// incremented whenever some symbol gets its first up rule, i.e. 0 as long
+	// as no symbol ever had up rules. see evaluate_intermediate_form().
+	std::atomic<uint32_t> m_up_rules_generation;
+
 public:
+	inline uint32_t up_rules_generation() const {
+		return m_up_rules_generation.load(std::memory_order_acquire);
+	}
+
+	inline void added_up_rules() {
+		m_up_rules_generation.fetch_add(1, std::memory_order_acq_rel);
+	}
+
 	void update_master_version();
 
 	VersionRef master_version() const;
@@ -86,12 +99,21 @@ public:
 		return m_symbols;
 	}
 
+	template<typename F>
+	inline void for_each_symbol(const F &f) const {
+		for (const auto &definition : m_definitions) {
+			f(SymbolRef(definition.second));
+		}
+	}
+
 	void freeze_as_builtin();
 
     void reset_user_definitions();
 
 	const NumberFormatter number_form;
 
+	PrintDefinitions printing;
+
     const BaseExpressionRef zero;
     const BaseExpressionRef one;
     const BaseExpressionRef minus_one;
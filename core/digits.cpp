@@ -0,0 +1,395 @@
+#include "digits.h"
+
+#include <gmpxx.h>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+const char digit_pairs[201] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+constexpr int MantissaBits = 52;
+constexpr int ExponentBits = 11;
+constexpr int ExponentBias = 1023;
+
+// the bits kept of powers of 5 and of their inverses.
+constexpr int Pow5Bits = 125;
+
+constexpr int Pow5InverseTableSize = 342;
+constexpr int Pow5TableSize = 326;
+
+// the number of bits of 5^e, for 0 <= e <= 3528.
+inline int32_t pow5_bits(int32_t e) {
+	return int32_t(((uint32_t(e) * 1217359) >> 19) + 1);
+}
+
+// floor(log10(2^e)), for 0 <= e <= 1650.
+inline uint32_t log10_pow2(int32_t e) {
+	return (uint32_t(e) * 78913) >> 18;
+}
+
+// floor(log10(5^e)), for 0 <= e <= 2620.
+inline uint32_t log10_pow5(int32_t e) {
+	return (uint32_t(e) * 732923) >> 20;
+}
+
+// the 128 bit multipliers by which Ryu scales, as low and high halves:
+// inverse[i] is 2^(pow5_bits(i) - 1 + Pow5Bits) / 5^i + 1, and power[i]
+// holds the top Pow5Bits bits of 5^i. they are computed once, instead of
+// being spelled out as in Ryu's sources.
+
+class Pow5Table {
+private:
+	static void split(const mpz_class &x, uint64_t *halves) {
+		const mpz_class high = x >> 64;
+		const mpz_class low = x - (high << 64);
+		halves[0] = low.get_ui();
+		halves[1] = high.get_ui();
+	}
+
+public:
+	uint64_t inverse[Pow5InverseTableSize][2];
+	uint64_t power[Pow5TableSize][2];
+
+	Pow5Table() {
+		mpz_class pow5(1);
+
+		for (int i = 0; i < Pow5InverseTableSize; i++) {
+			const int32_t bits = pow5_bits(i);
+			assert(mpz_sizeinbase(pow5.get_mpz_t(), 2) == size_t(bits) || i == 0);
+
+			const mpz_class inverse_i = ((mpz_class(1) << (bits - 1 + Pow5Bits)) / pow5) + 1;
+			split(inverse_i, inverse[i]);
+
+			if (i < Pow5TableSize) {
+				const mpz_class power_i = bits >= Pow5Bits ?
+					mpz_class(pow5 >> (bits - Pow5Bits)) : mpz_class(pow5 << (Pow5Bits - bits));
+				split(power_i, power[i]);
+			}
+
+			pow5 *= 5;
+		}
+	}
+};
+
+inline const Pow5Table &pow5_table() {
+	static const Pow5Table table;
+	return table;
+}
+
+inline uint64_t mul_shift(const uint64_t m, const uint64_t *multiplier, const int32_t j) {
+	const __uint128_t low = __uint128_t(m) * multiplier[0];
+	const __uint128_t high = __uint128_t(m) * multiplier[1];
+	return uint64_t(((low >> 64) + high) >> (j - 64));
+}
+
+inline uint32_t pow5_factor(uint64_t value) {
+	uint32_t count = 0;
+	while (value % 5 == 0) {
+		value /= 5;
+		count++;
+	}
+	return count;
+}
+
+inline bool is_multiple_of_pow5(const uint64_t value, const uint32_t p) {
+	return pow5_factor(value) >= p;
+}
+
+inline bool is_multiple_of_pow2(const uint64_t value, const uint32_t p) {
+	return (value & ((uint64_t(1) << p) - 1)) == 0;
+}
+
+// rounds d to end at place last (i.e. 10^last), as printf rounds x, which
+// d holds the shortest digits of. returns false if the digits that are
+// cut off are exactly 5, in which case only x itself can tell.
+bool round_digits(RealDigits &d, const int64_t last) {
+	const int64_t kept = d.exp - last + 1;
+
+	if (kept >= int64_t(d.length)) {
+		return true;
+	}
+
+	bool up;
+	if (kept >= 0) {
+		const char cut = d.digits[kept];
+		if (cut == '5' && kept + 1 == int64_t(d.length)) {
+			return false;
+		}
+		up = cut >= '5';
+		d.length = kept;
+	} else {
+		up = false;
+		d.length = 0;
+	}
+
+	if (up) {
+		size_t i = d.length;
+		while (i > 0 && d.digits[i - 1] == '9') {
+			d.digits[--i] = '0';
+		}
+		if (i > 0) {
+			d.digits[i - 1]++;
+		} else {
+			// all 9s (or no digits at all) carry into a new first digit.
+			d.digits[0] = '1';
+			d.length = 1;
+			d.exp += 1;
+		}
+	}
+
+	return true;
+}
+
+} // namespace
+
+char *integer_digits(char *end, uint64_t x) {
+	char *p = end;
+
+	while (x >= 100) {
+		const size_t i = size_t(x % 100) * 2;
+		x /= 100;
+		p -= 2;
+		std::memcpy(p, digit_pairs + i, 2);
+	}
+
+	if (x >= 10) {
+		p -= 2;
+		std::memcpy(p, digit_pairs + size_t(x) * 2, 2);
+	} else {
+		*--p = char('0' + x);
+	}
+
+	return p;
+}
+
+size_t integer_text(char *buffer, const int64_t x) {
+	char digits[MaxIntegerDigits];
+	char * const end = digits + MaxIntegerDigits;
+	const char * const begin = integer_digits(end, x < 0 ? uint64_t(0) - uint64_t(x) : uint64_t(x));
+
+	size_t n = 0;
+	if (x < 0) {
+		buffer[n++] = '-';
+	}
+	std::memcpy(buffer + n, begin, end - begin);
+	return n + (end - begin);
+}
+
+void shortest_digits(const double x, RealDigits &d) {
+	uint64_t bits;
+	std::memcpy(&bits, &x, sizeof(bits));
+
+	const uint64_t ieee_mantissa = bits & ((uint64_t(1) << MantissaBits) - 1);
+	const uint32_t ieee_exponent = uint32_t((bits >> MantissaBits) & ((1u << ExponentBits) - 1));
+
+	d.negative = (bits >> (MantissaBits + ExponentBits)) != 0;
+
+	// x is m2 * 2^e2, where e2 includes 2 more bits, so that the bounds of
+	// the interval below are integers too.
+	int32_t e2;
+	uint64_t m2;
+	if (ieee_exponent == 0) {
+		e2 = 1 - ExponentBias - MantissaBits - 2;
+		m2 = ieee_mantissa;
+	} else {
+		e2 = int32_t(ieee_exponent) - ExponentBias - MantissaBits - 2;
+		m2 = (uint64_t(1) << MantissaBits) | ieee_mantissa;
+	}
+	const bool accept_bounds = (m2 & 1) == 0; // as reading rounds ties to even
+
+	// the interval [mm, mp] of decimals that read back as x, around mv = x.
+	const uint64_t mv = 4 * m2;
+	const uint32_t mm_shift = ieee_mantissa != 0 || ieee_exponent <= 1;
+
+	const Pow5Table &table = pow5_table();
+
+	// scale by 10^-e10, i.e. compute vr = mv * 2^e2 / 10^e10 and the bounds.
+	uint64_t vr, vp, vm;
+	int32_t e10;
+	bool vm_is_trailing_zeros = false;
+	bool vr_is_trailing_zeros = false;
+
+	if (e2 >= 0) {
+		const uint32_t q = log10_pow2(e2) - (e2 > 3);
+		e10 = int32_t(q);
+		const int32_t k = Pow5Bits + pow5_bits(int32_t(q)) - 1;
+		const int32_t i = -e2 + int32_t(q) + k;
+		const uint64_t * const multiplier = table.inverse[q];
+
+		vr = mul_shift(4 * m2, multiplier, i);
+		vp = mul_shift(4 * m2 + 2, multiplier, i);
+		vm = mul_shift(4 * m2 - 1 - mm_shift, multiplier, i);
+
+		if (q <= 21) {
+			// only one of mp, mv and mm can be a multiple of 5, if any.
+			if (mv % 5 == 0) {
+				vr_is_trailing_zeros = is_multiple_of_pow5(mv, q);
+			} else if (accept_bounds) {
+				vm_is_trailing_zeros = is_multiple_of_pow5(mv - 1 - mm_shift, q);
+			} else {
+				vp -= is_multiple_of_pow5(mv + 2, q);
+			}
+		}
+	} else {
+		const uint32_t q = log10_pow5(-e2) - (-e2 > 1);
+		e10 = int32_t(q) + e2;
+		const int32_t i = -e2 - int32_t(q);
+		const int32_t k = pow5_bits(i) - Pow5Bits;
+		const int32_t j = int32_t(q) - k;
+		const uint64_t * const multiplier = table.power[i];
+
+		vr = mul_shift(4 * m2, multiplier, j);
+		vp = mul_shift(4 * m2 + 2, multiplier, j);
+		vm = mul_shift(4 * m2 - 1 - mm_shift, multiplier, j);
+
+		if (q <= 1) {
+			// mv has at least q trailing 0 bits, mp = mv + 2 has one.
+			vr_is_trailing_zeros = true;
+			if (accept_bounds) {
+				vm_is_trailing_zeros = mm_shift == 1;
+			} else {
+				--vp;
+			}
+		} else if (q < 63) {
+			vr_is_trailing_zeros = is_multiple_of_pow2(mv, q);
+		}
+	}
+
+	// remove digits while the interval still holds a shorter decimal.
+	int32_t removed = 0;
+	uint64_t output;
+
+	if (vm_is_trailing_zeros || vr_is_trailing_zeros) {
+		// the rare general case, where the removed digits might be exactly 0s.
+		uint32_t last_removed_digit = 0;
+
+		while (vp / 10 > vm / 10) {
+			vm_is_trailing_zeros &= vm % 10 == 0;
+			vr_is_trailing_zeros &= last_removed_digit == 0;
+			last_removed_digit = uint32_t(vr % 10);
+			vr /= 10;
+			vp /= 10;
+			vm /= 10;
+			removed++;
+		}
+
+		if (vm_is_trailing_zeros) {
+			while (vm % 10 == 0) {
+				vr_is_trailing_zeros &= last_removed_digit == 0;
+				last_removed_digit = uint32_t(vr % 10);
+				vr /= 10;
+				vp /= 10;
+				vm /= 10;
+				removed++;
+			}
+		}
+
+		if (vr_is_trailing_zeros && last_removed_digit == 5 && vr % 2 == 0) {
+			// x is exactly halfway, so round to even.
+			last_removed_digit = 4;
+		}
+
+		output = vr + ((vr == vm && (!accept_bounds || !vm_is_trailing_zeros)) || last_removed_digit >= 5);
+	} else {
+		bool round_up = false;
+
+		if (vp / 100 > vm / 100) {
+			round_up = vr % 100 >= 50;
+			vr /= 100;
+			vp /= 100;
+			vm /= 100;
+			removed += 2;
+		}
+
+		while (vp / 10 > vm / 10) {
+			round_up = vr % 10 >= 5;
+			vr /= 10;
+			vp /= 10;
+			vm /= 10;
+			removed++;
+		}
+
+		output = vr + (vr == vm || round_up);
+	}
+
+	char * const end = d.digits + MaxRealDigits;
+	const char * const begin = integer_digits(end, output);
+	d.length = end - begin;
+	std::memmove(d.digits, begin, d.length);
+	d.exp = int64_t(e10) + removed + int64_t(d.length) - 1;
+}
+
+bool printf_digits(const double x, const int precision, RealDigits &d) {
+	if (!std::isfinite(x) || precision > 14) {
+		return false;
+	}
+
+	if (x == 0) {
+		d.negative = std::signbit(x);
+		if (precision >= 0) { // "0.00000e+00"
+			d.digits[0] = '0';
+			d.length = 1;
+			d.exp = 0;
+		} else { // "0.000000", which has only leading 0s
+			d.length = 0;
+			d.exp = -1;
+		}
+		return true;
+	}
+
+	if (std::fabs(x) < std::numeric_limits<double>::min()) {
+		return false; // subnormals have fewer bits than digits
+	}
+
+	if (precision < 0 && !(std::fabs(x) < 8589934592.0)) {
+		return false; // printf writes all digits before the point exactly
+	}
+
+	shortest_digits(x, d);
+
+	if (precision >= 0) {
+		if (!round_digits(d, d.exp - precision)) {
+			return false;
+		}
+
+		// "%e" always has a first digit, and 0s after the point are removed.
+		while (d.length > 1 && d.digits[d.length - 1] == '0') {
+			d.length--;
+		}
+	} else {
+		if (!round_digits(d, -6)) {
+			return false;
+		}
+
+		if (d.length == 0) {
+			d.exp = -1; // as for 0
+			return true;
+		}
+
+		// "%f" keeps the 0s before the point, but not the ones after it.
+		int64_t last = d.exp - int64_t(d.length) + 1;
+		while (last < 0 && d.digits[d.length - 1] == '0') {
+			d.length--;
+			last++;
+		}
+		while (last > 0) {
+			d.digits[d.length++] = '0';
+			last--;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,50 @@
+#ifndef DIGITS_H
+#define DIGITS_H
+
+#include <cstdint>
+#include <cstddef>
+
+// decimal digits of machine integers and reals without going through printf
+// and parsing its output again.
+
+// the shortest digits of reals follow Ryu (https://github.com/ulfjack/ryu,
+// Ulf Adams, "Ryu: fast float-to-string conversion", PLDI 2018): the
+// interval of decimals that read back as the real is scaled by a power of
+// 10 via 128 bit multiplications with precomputed powers of 5, and digits
+// are removed until the interval gets too small.
+
+constexpr size_t MaxIntegerDigits = 20; // as in 18446744073709551615
+constexpr size_t MaxRealDigits = 24;
+
+// writes the digits of x so that they end at end, and returns where they
+// start. digits are produced two at a time from a table.
+char *integer_digits(char *end, uint64_t x);
+
+// writes x, with a '-' if it is negative, to buffer, which needs to hold
+// MaxIntegerDigits + 1 chars, and returns the number of chars written.
+size_t integer_text(char *buffer, int64_t x);
+
+struct RealDigits {
+	char digits[MaxRealDigits]; // '0' to '9', without trailing '\0'
+	size_t length;
+	int64_t exp; // the power of 10 of the first digit
+	bool negative;
+};
+
+// the shortest digits that read back as x, which must be finite and not 0.
+// if several are equally short, the one closest to x.
+void shortest_digits(double x, RealDigits &d);
+
+// the digits that real_to_s_exp gets from printf("%.<precision>e", x) or, if
+// precision is negative, from printf("%f", x) (i.e. std::to_string): rounded
+// to precision + 1 digits or 6 decimals respectively, trailing 0s after the
+// point removed and leading 0s consumed into exp.
+
+// the rounding is done on the shortest digits, which gives printf's exact
+// rounding of x as long as x is closer to them than to where rounding
+// changes, i.e. for up to 15 digits and for 6 decimals of reals below 2^33.
+// in all other cases, i.e. for exact ties, very large or subnormal reals,
+// infinities and NaNs, printf_digits gives up and returns false.
+bool printf_digits(double x, int precision, RealDigits &d);
+
+#endif // DIGITS_H
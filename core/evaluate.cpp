@@ -27,18 +27,30 @@ BaseExpressionRef evaluate_intermediate_form(
     // Step 3
     // Apply UpValues for leaves
 
-    if ((attributes & Attributes::HoldAllComplete) == 0 &&
-        slice.type_mask() & make_type_mask(SymbolType, ExpressionType)) {
+    // almost no symbol has up rules, so we skip the scan if no symbol ever had
+    // some, or if we already know that none of our leaves has any.
+
+    const uint32_t up_rules_generation =
+        evaluation.definitions.up_rules_generation();
+
+    if (up_rules_generation != 0 &&
+        (attributes & Attributes::HoldAllComplete) == 0 &&
+        slice.type_mask() & make_type_mask(SymbolType, ExpressionType) &&
+        !expr->known_without_up_rules(up_rules_generation)) {
+
+        bool has_up_rules = false;
+        const Symbol *last_up_name = nullptr;
 
         const size_t n = slice.size();
         for (size_t i = 0; i < n; i++) {
-            // FIXME do not check symbols twice
             const Symbol * const up_name = slice[i]->lookup_name();
-            if (up_name == nullptr) {
+            if (up_name == nullptr || up_name == last_up_name) {
                 continue;
             }
+            last_up_name = up_name;
             const SymbolRules *const up_rules = up_name->state().rules();
-            if (up_rules) {
+            if (up_rules && !up_rules->up_rules.empty()) {
+                has_up_rules = true;
                 const optional<BaseExpressionRef> up_form = up_rules->up_rules.apply(
                     expr, evaluation);
                 if (up_form) {
@@ -49,6 +61,10 @@ BaseExpressionRef evaluate_intermediate_form(
                 }
             }
         }
+
+        if (!has_up_rules) {
+            expr->set_without_up_rules(up_rules_generation);
+        }
     }
 
     assert(expr->head()->is_symbol());
@@ -69,14 +69,14 @@ void Evaluation::sym_engine_exception(const SymEngine::SymEngineException &e) co
 }
 
 std::string Evaluation::format_output(const BaseExpressionRef &expr) const {
-    StyleBoxOptions options;
-    return expr->make_boxes(OutputForm, *this)->boxes_to_text(options, *this);
+    std::string text;
+    Printer printer(text, *this);
+    printer.output(expr.get());
+    return text;
 }
 
 void Evaluation::print_out(const ExpressionRef &expr) const {
-    StyleBoxOptions options;
-    std::string text =  expr->make_boxes(OutputForm, *this)->boxes_to_text(options, *this);
-    std::cout << text << std::endl;
+    std::cout << format_output(expr) << std::endl;
 }
 
 bool TestOutput::test_empty() {
@@ -0,0 +1,292 @@
+#include "types.h"
+#include "core/expression/implementation.h"
+#include "export.h"
+#include "print.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+FileWriter::FileWriter(const std::string &path, bool append) :
+	m_buffer(new char[capacity]), m_used(0), m_failed(false) {
+
+	m_fd = open(path.c_str(), O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC), 0644);
+}
+
+FileWriter::~FileWriter() {
+	close();
+}
+
+void FileWriter::write_through(const char *data, size_t n) {
+	flush();
+
+	if (n < capacity) {
+		std::memcpy(m_buffer.get(), data, n);
+		m_used = n;
+		return;
+	}
+
+	while (n > 0 && !m_failed) {
+		const ssize_t written = ::write(m_fd, data, n);
+		if (written < 0) {
+			if (errno != EINTR) {
+				m_failed = true;
+			}
+		} else {
+			data += written;
+			n -= written;
+		}
+	}
+}
+
+void FileWriter::flush() {
+	const size_t n = m_used;
+	m_used = 0;
+
+	if (n > 0 && m_fd >= 0) {
+		const char *data = m_buffer.get();
+		size_t left = n;
+		while (left > 0 && !m_failed) {
+			const ssize_t written = ::write(m_fd, data, left);
+			if (written < 0) {
+				if (errno != EINTR) {
+					m_failed = true;
+				}
+			} else {
+				data += written;
+				left -= written;
+			}
+		}
+	}
+}
+
+bool FileWriter::close() {
+	if (m_fd >= 0) {
+		flush();
+		if (::close(m_fd) != 0) {
+			m_failed = true;
+		}
+		m_fd = -1;
+	}
+	return !m_failed;
+}
+
+namespace {
+
+template<typename U>
+inline const PackedSlice<U> &packed_slice(const Expression *expr) {
+	return static_cast<const PackedExpression<U>*>(expr)->slice();
+}
+
+inline bool needs_quotes(const std::string &s, char separator) {
+	for (const char c : s) {
+		if (c == separator || c == '"' || c == '\n' || c == '\r') {
+			return true;
+		}
+	}
+	return false;
+}
+
+class TableWriter {
+private:
+	FileWriter &m_out;
+	const char m_separator;
+	std::string m_text;
+	Printer m_printer;
+
+public:
+	inline TableWriter(FileWriter &out, char separator, const Evaluation &evaluation) :
+		m_out(out), m_separator(separator), m_printer(m_text, evaluation) {
+	}
+
+	inline void field(const BaseExpression *item) {
+		if (item->is_string()) {
+			const std::string text = item->as_string()->utf8();
+
+			if (m_separator != ' ' && needs_quotes(text, m_separator)) {
+				m_text.push_back('"');
+				for (const char c : text) {
+					if (c == '"') {
+						m_text.push_back('"');
+					}
+					m_text.push_back(c);
+				}
+				m_text.push_back('"');
+			} else {
+				m_text.append(text);
+			}
+		} else {
+			m_printer(item, PrintForm::FullForm, StringCharacters::Escaped);
+		}
+	}
+
+	void row(const BaseExpression *item) {
+		if (!item->is_list()) {
+			field(item);
+		} else {
+			const Expression * const list = item->as_expression();
+			const size_t n = list->size();
+
+			switch (list->slice_code()) {
+				case PackedSliceMachineIntegerCode: {
+					const machine_integer_t * const values = packed_slice<machine_integer_t>(list).address();
+					for (size_t i = 0; i < n; i++) {
+						if (i > 0) {
+							m_text.push_back(m_separator);
+						}
+						m_printer.integer(values[i]);
+					}
+					break;
+				}
+
+				case PackedSliceMachineRealCode: {
+					const char separator[2] = {m_separator, '\0'};
+					m_printer.reals(packed_slice<machine_real_t>(list).address(), n, separator);
+					break;
+				}
+
+				default:
+					for (size_t i = 0; i < n; i++) {
+						if (i > 0) {
+							m_text.push_back(m_separator);
+						}
+						field(list->leaf(i).get());
+					}
+					break;
+			}
+		}
+
+		m_text.push_back('\n');
+		flush(1 << 16);
+	}
+
+	// moves the text to the file once there is at least size of it.
+	inline void flush(size_t size) {
+		if (m_text.size() >= size) {
+			m_out.write(m_text);
+			m_text.clear();
+		}
+	}
+};
+
+template<typename T>
+inline bool binary_value(const BaseExpression *item, T &value) {
+	switch (item->type()) {
+		case MachineIntegerType: {
+			const machine_integer_t x = static_cast<const MachineInteger*>(item)->value;
+			if (std::numeric_limits<T>::is_integer) {
+				if (x < machine_integer_t(std::numeric_limits<T>::min()) ||
+					(x > 0 && uint64_t(x) > uint64_t(std::numeric_limits<T>::max()))) {
+					return false;
+				}
+			}
+			value = T(x);
+			return true;
+		}
+
+		case MachineRealType:
+			if (std::numeric_limits<T>::is_integer) {
+				return false;
+			}
+			value = T(static_cast<const MachineReal*>(item)->value);
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+template<typename T>
+bool write_binary(FileWriter &out, const Expression *list, BaseExpressionRef &failed) {
+	const size_t n = list->size();
+
+	// packed integers and reals that already have the type's layout are
+	// written from their buffer.
+
+	if (list->slice_code() == PackedSliceMachineIntegerCode &&
+		std::is_same<T, machine_integer_t>::value) {
+		out.write(reinterpret_cast<const char*>(
+			packed_slice<machine_integer_t>(list).address()), n * sizeof(T));
+		return true;
+	}
+
+	if (list->slice_code() == PackedSliceMachineRealCode &&
+		std::is_same<T, machine_real_t>::value) {
+		out.write(reinterpret_cast<const char*>(
+			packed_slice<machine_real_t>(list).address()), n * sizeof(T));
+		return true;
+	}
+
+	// all other lists are converted in blocks.
+
+	constexpr size_t block_size = 4096;
+	T block[block_size];
+	size_t k = 0;
+
+	for (size_t i = 0; i < n; i++) {
+		const BaseExpressionRef item = list->leaf(i);
+		if (!binary_value(item.get(), block[k])) {
+			out.write(reinterpret_cast<const char*>(block), k * sizeof(T));
+			failed = item;
+			return false;
+		}
+		if (++k == block_size) {
+			out.write(reinterpret_cast<const char*>(block), k * sizeof(T));
+			k = 0;
+		}
+	}
+
+	out.write(reinterpret_cast<const char*>(block), k * sizeof(T));
+	return true;
+}
+
+} // namespace
+
+void write_table(FileWriter &out, const BaseExpression *table, char separator, const Evaluation &evaluation) {
+	TableWriter writer(out, separator, evaluation);
+
+	if (!table->is_list()) {
+		writer.row(table);
+	} else {
+		const Expression * const rows = table->as_expression();
+		const size_t n = rows->size();
+		for (size_t i = 0; i < n; i++) {
+			writer.row(rows->leaf(i).get());
+		}
+	}
+
+	writer.flush(0);
+}
+
+bool write_binary(
+	FileWriter &out,
+	const Expression *list,
+	const std::string &type,
+	BaseExpressionRef &failed) {
+
+	if (type == "Byte" || type == "UnsignedInteger8") {
+		return write_binary<uint8_t>(out, list, failed);
+	} else if (type == "Integer8") {
+		return write_binary<int8_t>(out, list, failed);
+	} else if (type == "Integer16") {
+		return write_binary<int16_t>(out, list, failed);
+	} else if (type == "UnsignedInteger16") {
+		return write_binary<uint16_t>(out, list, failed);
+	} else if (type == "Integer32") {
+		return write_binary<int32_t>(out, list, failed);
+	} else if (type == "UnsignedInteger32") {
+		return write_binary<uint32_t>(out, list, failed);
+	} else if (type == "Integer64") {
+		return write_binary<int64_t>(out, list, failed);
+	} else if (type == "Real32") {
+		return write_binary<float>(out, list, failed);
+	} else if (type == "Real64") {
+		return write_binary<double>(out, list, failed);
+	} else {
+		return false;
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstring>
+#include <memory>
+#include <string>
+
+// the writing side of Export, WriteString and BinaryWrite. expressions are
+// written to a file through a fixed size buffer as Printer produces their
+// text; packed arrays are written directly from their buffers where their
+// layout is that of the file.
+
+class FileWriter {
+private:
+	static constexpr size_t capacity = 1 << 16;
+
+	int m_fd;
+	std::unique_ptr<char[]> m_buffer;
+	size_t m_used;
+	bool m_failed;
+
+	void write_through(const char *data, size_t n);
+
+public:
+	// opens path for writing, truncating it, or appending to it if append is set.
+	FileWriter(const std::string &path, bool append = false);
+
+	~FileWriter();
+
+	FileWriter(const FileWriter&) = delete;
+
+	FileWriter &operator=(const FileWriter&) = delete;
+
+	inline bool is_open() const {
+		return m_fd >= 0;
+	}
+
+	// blocks that do not fit into the buffer go to the file directly.
+	inline void write(const char *data, size_t n) {
+		if (n <= capacity - m_used) {
+			std::memcpy(m_buffer.get() + m_used, data, n);
+			m_used += n;
+		} else {
+			write_through(data, n);
+		}
+	}
+
+	inline void write(const std::string &s) {
+		write(s.data(), s.size());
+	}
+
+	inline void put(char c) {
+		if (m_used == capacity) {
+			flush();
+		}
+		m_buffer[m_used++] = c;
+	}
+
+	void flush();
+
+	// flushes and closes the file; false if any write failed.
+	bool close();
+};
+
+// writes a list of rows (or a list of atoms, as one column) as a table, with
+// fields separated by separator, which is ',' for CSV, '\t' for TSV or ' '.
+// strings are written as they are; in CSV and TSV, they are quoted if they
+// contain a separator, quote or line break. other fields are written in
+// FullForm by Printer.
+void write_table(FileWriter &out, const BaseExpression *table, char separator, const Evaluation &evaluation);
+
+// writes the leaves of list as elements of a binary type as in BinaryReadList,
+// e.g. "Integer32", in the byte order of the machine. fails with the first leaf
+// that does not fit the type, which is then returned, or an empty reference for
+// unknown types (in that case, nothing gets written).
+bool write_binary(
+	FileWriter &out,
+	const Expression *list,
+	const std::string &type,
+	BaseExpressionRef &failed);
@@ -45,7 +45,7 @@ SymbolicFormRef Expression::instantiate_symbolic_form(const Evaluation &evaluati
     return evaluation.definitions.no_symbolic_form;
 }
 
-optional<hash_t> Expression::compute_match_hash() const {
+bool Expression::has_match_hash() const {
 	switch (_head->symbol()) {
 		case S::Blank:
 		case S::BlankSequence:
@@ -55,32 +55,43 @@ optional<hash_t> Expression::compute_match_hash() const {
 		case S::Repeated:
 		case S::Except:
 		case S::OptionsPattern:
-			return optional<hash_t>();
+			return false;
 
 		default: {
-			// note that this must yield the same value as hash()
-			// defined above if this Expression is not a pattern.
-
-			const auto head_hash = _head->match_hash();
-			if (!head_hash) {
-				return optional<hash_t>();
+			if (!_head->match_hash()) {
+				return false;
 			}
 
-			return with_slice([&head_hash] (const auto &slice) -> optional<hash_t> {
-				hash_t result = hash_combine(slice.size(), *head_hash);
+			return with_slice([] (const auto &slice) {
 				for (auto leaf : slice) {
-					const auto leaf_hash = leaf->match_hash();
-					if (!leaf_hash) {
-						return optional<hash_t>();
+					if (!leaf->match_hash()) {
+						return false;
 					}
-					result = hash_combine(result, *leaf_hash);
 				}
-				return result;
+				return true;
 			});
 		}
 	}
 }
 
+optional<hash_t> Expression::compute_match_hash() const {
+	// if this Expression is not a pattern, its match hash is the same
+	// as its hash(), so all we need to remember is whether it is one.
+
+	uint8_t state = m_hash_state.load(std::memory_order_acquire);
+
+	if ((state & MatchHashComputed) == 0) {
+		const uint8_t bits = MatchHashComputed | (has_match_hash() ? MatchHashDefined : 0);
+		state = m_hash_state.fetch_or(bits, std::memory_order_acq_rel) | bits;
+	}
+
+	if (state & MatchHashDefined) {
+		return hash();
+	} else {
+		return optional<hash_t>();
+	}
+}
+
 inline tribool Expression::equals(const BaseExpression &item) const {
 	if (this == &item) {
 		return true;
@@ -409,7 +420,7 @@ std::string Expression::debugform() const {
 	return s.str();
 }
 
-hash_t Expression::hash() const {
+hash_t Expression::compute_hash() const {
 	return with_slice([this] (const auto &slice) {
 		hash_t result = hash_combine(slice.size(), _head->hash());
 		for (auto leaf : slice) {
@@ -419,6 +430,20 @@ hash_t Expression::hash() const {
 	});
 }
 
+hash_t Expression::hash() const {
+	// computing the hash is idempotent, so concurrent threads
+	// might both compute it, but will always agree on its value.
+
+	if (m_hash_state.load(std::memory_order_acquire) & HashComputed) {
+		return m_hash.load(std::memory_order_relaxed);
+	}
+
+	const hash_t result = compute_hash();
+	m_hash.store(result, std::memory_order_relaxed);
+	m_hash_state.fetch_or(HashComputed, std::memory_order_release);
+	return result;
+}
+
 BaseExpressionRef Expression::negate(const Evaluation &evaluation) const {
 	if (head()->symbol() == S::Times && size() >= 1) {
 		return with_slice([this, &evaluation] (const auto &slice) -> BaseExpressionRef {
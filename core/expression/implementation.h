@@ -487,16 +487,32 @@ inline PatternMatcherRef Expression::string_matcher() const { // concurrent.
 	return ensure_cache()->string_matcher(this);
 }
 
+// if no parallelize() is running, we're the only thread around and can use plain
+// loads and stores instead of atomic RMW for updating reference counts. try
+// Timing[Length[Table[x, {x, 0, 10000000}]]] to see the difference.
+
 template<typename T>
 inline void intrusive_ptr_add_ref(const T *obj) {
     auto * p = static_cast<const Shared*>(obj);
-    p->m_ref_count.fetch_add(1, std::memory_order_relaxed);
+    if (Parallel::is_sequential()) {
+        p->m_ref_count.store(
+            p->m_ref_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    } else {
+        p->m_ref_count.fetch_add(1, std::memory_order_relaxed);
+    }
 };
 
 template<typename T>
 inline void intrusive_ptr_release(const T *obj) {
     auto * p = static_cast<const Shared*>(obj);
-    if (p->m_ref_count.fetch_add(-1, std::memory_order_relaxed) == 1) {
+    size_t count;
+    if (Parallel::is_sequential()) {
+        count = p->m_ref_count.load(std::memory_order_relaxed);
+        p->m_ref_count.store(count - 1, std::memory_order_relaxed);
+    } else {
+        count = p->m_ref_count.fetch_add(-1, std::memory_order_relaxed);
+    }
+    if (count == 1) {
         const_cast<T*>(obj)->destroy();
     }
 };
@@ -14,6 +14,25 @@ private:
     mutable TaskLocalStorage<UnsafeVersionRef> m_last_evaluated;
     const Symbol * const m_lookup_name;
 
+	enum {
+		HashComputed = 1,
+		MatchHashComputed = 2, // match_hash() is known; it's either hash() or undefined
+		MatchHashDefined = 4
+	};
+
+	// structural hash, lazily computed once (see hash()); m_hash is only
+	// valid if m_hash_state contains HashComputed.
+	mutable std::atomic<hash_t> m_hash;
+	mutable std::atomic<uint8_t> m_hash_state;
+
+	// if not 0, none of our leaves had up rules at this up rules generation
+	// (see Definitions::up_rules_generation()).
+	mutable std::atomic<uint32_t> m_no_up_rules;
+
+	hash_t compute_hash() const;
+
+	bool has_match_hash() const;
+
 protected:
 	template<SliceMethodOptimizeTarget Optimize, typename R, typename F>
 	friend class SliceMethod;
@@ -42,6 +61,8 @@ protected:
 	inline Expression(const BaseExpressionRef &head, SliceCode slice_id, const Slice *slice_ptr) :
 		BaseExpression(build_extended_type(ExpressionType, slice_id)),
         m_lookup_name(head->lookup_name()),
+		m_hash_state(0),
+		m_no_up_rules(0),
 		_head(head),
 		_slice_ptr(slice_ptr) {
 	}
@@ -246,6 +267,14 @@ protected:
     inline void set_last_evaluated(const VersionRef &version) const {
         m_last_evaluated.set(version);
     }
+
+	inline bool known_without_up_rules(uint32_t generation) const {
+		return m_no_up_rules.load(std::memory_order_relaxed) == generation;
+	}
+
+	inline void set_without_up_rules(uint32_t generation) const {
+		m_no_up_rules.store(generation, std::memory_order_relaxed);
+	}
 };
 
 #include "../slice/method.tcc"
@@ -0,0 +1,12 @@
+#include "hash.h"
+
+#include <random>
+#include <chrono>
+
+hash_t make_hash_seed() {
+	std::random_device device;
+	const uint64_t entropy = (uint64_t(device()) << 32) ^ device();
+	// random_device might be deterministic on some platforms.
+	const uint64_t time = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+	return hash_mum(entropy ^ hash_p0, time ^ hash_p1);
+}
@@ -2,40 +2,218 @@
 #define HASH_H
 
 #include <gmpxx.h>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
 
 typedef size_t hash_t;
 
-inline hash_t djb2(const char* str) {
-	hash_t result = 5381;
+static_assert(sizeof(hash_t) == sizeof(uint64_t), "hash_t must be 64 bits");
 
-	int c;
-    while ((c = *str++)) {
-        result = ((result << 5) + result) + c;
-    }
+// the hash functions below follow wyhash (https://github.com/wangyi-fudan/wyhash):
+// all mixing is done via 64x64->128 bit multiplications (hash_mum), which are fast
+// on modern CPUs and give much better avalanche than shift-add schemes like djb2.
 
-    return result;
+// all hash values derived from user data (strings, integers, ...) depend on
+// hash_seed(), which is randomized once per process, so that collisions for our
+// hash tables cannot be prepared in advance. hash values are never persisted and
+// never influence evaluation order.
+
+hash_t make_hash_seed();
+
+// the seed is made on first use, so that hashes computed during the static
+// initialization of any translation unit already use it.
+inline hash_t hash_seed() {
+	static const hash_t seed = make_hash_seed();
+	return seed;
+}
+
+constexpr uint64_t hash_p0 = 0xa0761d6478bd642full;
+constexpr uint64_t hash_p1 = 0xe7037ed1a0b428dbull;
+constexpr uint64_t hash_p2 = 0x8ebc6af09c88c6e3ull;
+constexpr uint64_t hash_p3 = 0x589965cc75374cc3ull;
+
+inline uint64_t hash_mum(const uint64_t a, const uint64_t b) {
+	const __uint128_t r = __uint128_t(a) * b;
+	return uint64_t(r) ^ uint64_t(r >> 64);
+}
+
+inline uint64_t hash_read64(const uint8_t *p) {
+	uint64_t v;
+	std::memcpy(&v, p, 8);
+	return v;
+}
+
+inline uint64_t hash_read32(const uint8_t *p) {
+	uint32_t v;
+	std::memcpy(&v, p, 4);
+	return v;
+}
+
+inline hash_t hash_bytes(const void *data, const size_t n, const hash_t seed = hash_seed()) {
+	const uint8_t *p = static_cast<const uint8_t*>(data);
+	uint64_t state = seed ^ hash_p0;
+	uint64_t a;
+	uint64_t b;
+
+	if (n <= 16) {
+		if (n >= 4) {
+			const size_t k = (n >> 3) << 2;
+			a = (hash_read32(p) << 32) | hash_read32(p + k);
+			b = (hash_read32(p + n - 4) << 32) | hash_read32(p + n - 4 - k);
+		} else if (n > 0) {
+			a = (uint64_t(p[0]) << 16) | (uint64_t(p[n >> 1]) << 8) | p[n - 1];
+			b = 0;
+		} else {
+			a = 0;
+			b = 0;
+		}
+	} else {
+		size_t i = n;
+
+		if (i > 48) {
+			// three independent lanes, so that the multiplications can overlap.
+			uint64_t state1 = state;
+			uint64_t state2 = state;
+			do {
+				state = hash_mum(hash_read64(p) ^ hash_p1, hash_read64(p + 8) ^ state);
+				state1 = hash_mum(hash_read64(p + 16) ^ hash_p2, hash_read64(p + 24) ^ state1);
+				state2 = hash_mum(hash_read64(p + 32) ^ hash_p3, hash_read64(p + 40) ^ state2);
+				p += 48;
+				i -= 48;
+			} while (i > 48);
+			state ^= state1 ^ state2;
+		}
+
+		while (i > 16) {
+			state = hash_mum(hash_read64(p) ^ hash_p1, hash_read64(p + 8) ^ state);
+			p += 16;
+			i -= 16;
+		}
+
+		a = hash_read64(p + i - 16);
+		b = hash_read64(p + i - 8);
+	}
+
+	return hash_mum(hash_p1 ^ n, hash_mum(a ^ hash_p1, b ^ state));
 }
 
+// HashStream computes hash_bytes(data, n) for data that arrives in pieces
+// (e.g. the segments of a rope), given the total size n in advance.
+
+class HashStream {
+private:
+	const size_t m_n;
+	const hash_t m_seed;
+	size_t m_remaining; // bytes not consumed by any block yet
+	uint64_t m_state;
+	uint64_t m_state1;
+	uint64_t m_state2;
+	bool m_lanes;
+	uint8_t m_buffer[64];
+	size_t m_size;
+	uint8_t m_last[16]; // the last 16 bytes added
+
+	inline void consume() {
+		size_t i = 0;
+
+		while (true) {
+			if (m_lanes) {
+				if (m_remaining > 48) {
+					if (m_size - i < 48) {
+						break;
+					}
+					const uint8_t *p = m_buffer + i;
+					m_state = hash_mum(hash_read64(p) ^ hash_p1, hash_read64(p + 8) ^ m_state);
+					m_state1 = hash_mum(hash_read64(p + 16) ^ hash_p2, hash_read64(p + 24) ^ m_state1);
+					m_state2 = hash_mum(hash_read64(p + 32) ^ hash_p3, hash_read64(p + 40) ^ m_state2);
+					i += 48;
+					m_remaining -= 48;
+					continue;
+				}
+				m_state ^= m_state1 ^ m_state2;
+				m_lanes = false;
+			}
+
+			if (m_remaining > 16 && m_size - i >= 16) {
+				const uint8_t *p = m_buffer + i;
+				m_state = hash_mum(hash_read64(p) ^ hash_p1, hash_read64(p + 8) ^ m_state);
+				i += 16;
+				m_remaining -= 16;
+				continue;
+			}
+
+			break;
+		}
+
+		std::memmove(m_buffer, m_buffer + i, m_size - i);
+		m_size -= i;
+	}
+
+public:
+	inline HashStream(size_t n, const hash_t seed = hash_seed()) :
+		m_n(n),
+		m_seed(seed),
+		m_remaining(n),
+		m_state(seed ^ hash_p0),
+		m_state1(m_state),
+		m_state2(m_state),
+		m_lanes(n > 48),
+		m_size(0) {
+	}
+
+	inline void add(const void *data, size_t k) {
+		const uint8_t *p = static_cast<const uint8_t*>(data);
+
+		if (k >= 16) {
+			std::memcpy(m_last, p + k - 16, 16);
+		} else {
+			std::memmove(m_last, m_last + k, 16 - k);
+			std::memcpy(m_last + 16 - k, p, k);
+		}
+
+		if (m_n <= sizeof(m_buffer)) {
+			std::memcpy(m_buffer + m_size, p, k);
+			m_size += k;
+			return;
+		}
+
+		while (k > 0) {
+			const size_t n = std::min(k, sizeof(m_buffer) - m_size);
+			std::memcpy(m_buffer + m_size, p, n);
+			m_size += n;
+			p += n;
+			k -= n;
+			consume();
+		}
+	}
+
+	inline hash_t get() const {
+		if (m_n <= sizeof(m_buffer)) {
+			return hash_bytes(m_buffer, m_n, m_seed);
+		}
+
+		const uint64_t a = hash_read64(m_last);
+		const uint64_t b = hash_read64(m_last + 8);
+		return hash_mum(hash_p1 ^ m_n, hash_mum(a ^ hash_p1, b ^ m_state));
+	}
+};
+
 inline hash_t hash_combine(hash_t seed, const hash_t x) {
-    // see boost::hash_combine
-    seed ^= x + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-    return seed;
+	// order dependent, i.e. hash_combine(hash_combine(s, x), y) is
+	// not hash_combine(hash_combine(s, y), x) in general.
+	return hash_mum(hash_mum(seed ^ hash_p0, x ^ hash_p1), hash_p2 ^ seed);
 }
 
 inline hash_t hash_pair(const hash_t x, const hash_t y) {
     // combines 2 hash values
-	return hash_combine(hash_combine(0, x), y);
+	return hash_combine(hash_combine(hash_seed(), x), y);
 }
 
 inline hash_t hash_mpz(const mpz_class &value) {
-    std::hash<mp_limb_t> limb_hash;
     const mpz_srcptr x = value.get_mpz_t();
     const size_t n = std::abs(x->_mp_size);
-    hash_t h = 0;
-    for (size_t i = 0; i < n; i++) {
-        h = hash_combine(h, limb_hash(x->_mp_d[i]));
-    }
-    return h;
+    return hash_bytes(x->_mp_d, n * sizeof(mp_limb_t), x->_mp_size < 0 ? ~hash_seed() : hash_seed());
 }
 
 constexpr hash_t symbol_hash = 0x652d2463adb; // djb2("Symbol")
@@ -0,0 +1,271 @@
+#include "types.h"
+#include "core/expression/implementation.h"
+#include "hashcons.h"
+
+#include <cmath>
+#include <cstring>
+
+HashConsTable *HashConsTable::s_instance = nullptr;
+
+void hash_cons_forget(const BaseExpression *expr) {
+	HashConsTable::instance().forget(expr);
+}
+
+void HashConsTable::init() {
+	assert(s_instance == nullptr);
+	s_instance = new HashConsTable();
+}
+
+inline size_t approximate_size(BaseExpressionPtr item) {
+	switch (item->type()) {
+		case ExpressionType:
+			return sizeof(ExpressionImplementation<BigSlice>) +
+				item->as_expression()->size() * sizeof(BaseExpressionRef);
+		case MachineIntegerType:
+			return sizeof(MachineInteger);
+		case BigIntegerType:
+			return sizeof(BigInteger);
+		case MachineRealType:
+			return sizeof(MachineReal);
+		case MachineRationalType:
+		case BigRationalType:
+			return sizeof(BigRational);
+		case MachineComplexType:
+			return sizeof(MachineComplex);
+		case StringType:
+			return sizeof(String) + item->as_string()->length();
+		default:
+			return 0;
+	}
+}
+
+inline bool same_bits(machine_real_t x, machine_real_t y) {
+	return std::memcmp(&x, &y, sizeof(machine_real_t)) == 0;
+}
+
+// same_indeed() compares machine reals by value, which takes 0. and -0. to be
+// the same. sharing must not flip signs, so they are compared bitwise here.
+inline bool same_atom(BaseExpressionPtr entry, const BaseExpressionRef &item) {
+	if (entry->type() != item->type()) {
+		return false;
+	}
+
+	switch (item->type()) {
+		case MachineRealType:
+			return same_bits(
+				static_cast<const MachineReal*>(entry)->value,
+				static_cast<const MachineReal*>(item.get())->value);
+
+		case MachineComplexType: {
+			const auto &x = static_cast<const MachineComplex*>(entry)->m_value;
+			const auto &y = static_cast<const MachineComplex*>(item.get())->m_value;
+			return same_bits(x.real(), y.real()) && same_bits(x.imag(), y.imag());
+		}
+
+		default:
+			return entry->same_indeed(*item);
+	}
+}
+
+// canonical instances are never same() with each other. as -0. is same()
+// with 0., machine reals and complexes with a -0. part are never shared.
+inline bool has_negative_zero(const BaseExpressionRef &item) {
+	const auto negative_zero = [] (machine_real_t x) {
+		return x == 0 && std::signbit(x);
+	};
+
+	switch (item->type()) {
+		case MachineRealType:
+			return negative_zero(static_cast<const MachineReal*>(item.get())->value);
+
+		case MachineComplexType: {
+			const auto &x = static_cast<const MachineComplex*>(item.get())->m_value;
+			return negative_zero(x.real()) || negative_zero(x.imag());
+		}
+
+		default:
+			return false;
+	}
+}
+
+template<typename Equal>
+BaseExpressionRef HashConsTable::intern(
+	const BaseExpressionRef &candidate,
+	hash_t key,
+	const Equal &equal,
+	size_t &saved) {
+
+	// probed holds the references we temporarily obtain to entries in the
+	// table; it must get destroyed after the lock is released, as dropping
+	// the last reference to an entry calls forget().
+	std::vector<BaseExpressionRef> probed;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	const auto range = m_table.equal_range(key);
+	for (auto i = range.first; i != range.second; i++) {
+		BaseExpressionPtr entry = i->second;
+
+		// entries with a reference count of 0 are currently being destroyed
+		// and must not be touched (their destructor waits for our lock).
+		const Shared * const shared = entry;
+		if (!shared->try_add_ref()) {
+			continue;
+		}
+		probed.emplace_back(BaseExpressionRef(entry));
+		shared->m_ref_count.fetch_sub(1, std::memory_order_relaxed);
+
+		if (equal(entry)) {
+			if (entry != candidate.get()) {
+				saved += approximate_size(candidate.get());
+			}
+			return probed.back();
+		}
+	}
+
+	const BaseExpressionPtr item = candidate.get();
+	m_table.emplace(key, item);
+	m_keys[item] = key;
+	item->m_hash_consed.store(true, std::memory_order_relaxed);
+
+	return candidate;
+}
+
+BaseExpressionRef HashConsTable::share(
+	const BaseExpressionRef &item,
+	bool &canonical,
+	size_t &saved) {
+
+	if (item->is_hash_consed()) {
+		canonical = true;
+		return item;
+	}
+
+	switch (item->type()) {
+		case SymbolType:
+			// symbols are unique anyway.
+			canonical = true;
+			return item;
+
+		case BigRealType:
+		case BigComplexType:
+			// same() ignores precision here, so we must not merge these.
+			canonical = false;
+			return item;
+
+		case ExpressionType:
+			break;
+
+		default:
+			if (has_negative_zero(item)) {
+				canonical = false;
+				return item;
+			}
+			canonical = true;
+			return intern(item, item->hash(), [&item] (BaseExpressionPtr entry) {
+				return same_atom(entry, item);
+			}, saved);
+	}
+
+	const Expression * const expr = item->as_expression();
+
+	if (is_packed_slice(expr->slice_code())) {
+		// packed leaves have no identity that we could share.
+		canonical = false;
+		return item;
+	}
+
+	bool all_canonical = true;
+	bool changed = false;
+
+	bool head_canonical;
+	const BaseExpressionRef head = share(expr->_head, head_canonical, saved);
+	all_canonical = all_canonical && head_canonical;
+	changed = changed || head.get() != expr->head();
+
+	const size_t n = expr->size();
+	std::vector<BaseExpressionRef> leaves;
+	leaves.reserve(n);
+
+	expr->with_slice([this, n, &leaves, &all_canonical, &changed, &saved] (const auto &slice) {
+		for (size_t i = 0; i < n; i++) {
+			const BaseExpressionRef leaf = slice[i];
+			bool leaf_canonical;
+			leaves.emplace_back(share(leaf, leaf_canonical, saved));
+			all_canonical = all_canonical && leaf_canonical;
+			changed = changed || leaves.back().get() != leaf.get();
+		}
+	});
+
+	UnsafeBaseExpressionRef candidate;
+	if (changed) {
+		candidate = expression(head, sequential([n, &leaves] (auto &store) {
+			for (size_t i = 0; i < n; i++) {
+				store(BaseExpressionRef(leaves[i]));
+			}
+		}, n));
+	} else {
+		candidate = item;
+	}
+
+	if (!all_canonical || is_packed_slice(candidate->as_expression()->slice_code())) {
+		canonical = false;
+		return candidate;
+	}
+
+	// since all leaves are canonical, we can key and compare by identity.
+
+	hash_t key = hash_pair(n, std::uintptr_t(head.get()));
+	for (const BaseExpressionRef &leaf : leaves) {
+		key = hash_combine(key, std::uintptr_t(leaf.get()));
+	}
+
+	canonical = true;
+	return intern(candidate, key, [&head, &leaves] (BaseExpressionPtr entry) {
+		if (!entry->is_expression()) {
+			return false;
+		}
+		const Expression * const other = entry->as_expression();
+		if (other->head() != head.get() || other->size() != leaves.size()) {
+			return false;
+		}
+		return other->with_slice([&leaves] (const auto &slice) {
+			const size_t n = slice.size();
+			for (size_t i = 0; i < n; i++) {
+				if (slice[i].get() != leaves[i].get()) {
+					return false;
+				}
+			}
+			return true;
+		});
+	}, saved);
+}
+
+BaseExpressionRef HashConsTable::share(const BaseExpressionRef &item, size_t &saved) {
+	bool canonical;
+	return share(item, canonical, saved);
+}
+
+void HashConsTable::forget(BaseExpressionPtr item) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	const auto key = m_keys.find(item);
+	if (key == m_keys.end()) {
+		return;
+	}
+
+	const auto range = m_table.equal_range(key->second);
+	for (auto i = range.first; i != range.second; i++) {
+		if (i->second == item) {
+			m_table.erase(i);
+			break;
+		}
+	}
+
+	m_keys.erase(key);
+}
+
+size_t HashConsTable::size() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_keys.size();
+}
@@ -0,0 +1,59 @@
+#ifndef CMATHICS_HASHCONS_H
+#define CMATHICS_HASHCONS_H
+
+#include "types.h"
+
+#include <mutex>
+#include <unordered_map>
+
+// HashConsTable is a global, weakly referencing table of canonical expression
+// instances. sharing an expression through the table replaces each of its
+// subexpressions by a canonical instance that is the same(), so that repeated
+// terms (e.g. x^2 appearing in many places) are stored only once.
+
+// the table does not hold references to its instances; once an instance is
+// destroyed, it removes itself from the table (see ~BaseExpression).
+
+// two instances that are both in the table (i.e. is_hash_consed() is true)
+// are never same() unless they are identical, which allows BaseExpression::same
+// to do a pointer comparison for them.
+
+class HashConsTable {
+private:
+	static HashConsTable *s_instance;
+
+	std::mutex m_mutex;
+
+	std::unordered_multimap<hash_t, BaseExpressionPtr> m_table;
+	std::unordered_map<BaseExpressionPtr, hash_t> m_keys;
+
+	template<typename Equal>
+	BaseExpressionRef intern(
+		const BaseExpressionRef &candidate,
+		hash_t key,
+		const Equal &equal,
+		size_t &saved);
+
+	BaseExpressionRef share(
+		const BaseExpressionRef &item,
+		bool &canonical,
+		size_t &saved);
+
+public:
+	static void init();
+
+	static inline HashConsTable &instance() {
+		return *s_instance;
+	}
+
+	// returns an expression that is the same() as item, but whose subexpressions
+	// are canonical instances. saved is increased by the approximate number of
+	// bytes that are no longer needed if item is replaced by the result.
+	BaseExpressionRef share(const BaseExpressionRef &item, size_t &saved);
+
+	void forget(BaseExpressionPtr item);
+
+	size_t size();
+};
+
+#endif //CMATHICS_HASHCONS_H
@@ -5,6 +5,7 @@
 
 #include <forward_list>
 #include <unordered_set>
+#include <unordered_map>
 
 #include "gmpxx.h"
 #include <arb.h>
@@ -77,13 +78,38 @@ struct RuleHash {
 
 class NoRulesVectorFilter;
 
+#include "core/pattern/index.h"
+
+// below this number of pattern rules, a linear scan is as fast as RulesIndex.
+constexpr size_t MinIndexedRules = 8;
+
 template<typename Entry>
 class RulesVector {
 protected:
     std::vector<Entry> m_rules[NumberOfSliceCodes];
-	std::vector<Entry> m_all_rules;
+	std::vector<Entry> m_all_rules; // sorted, without exact rules
     bool m_is_match_size_known;
 
+	// rules whose pattern has a match_hash() (i.e. contains no pattern variables)
+	// can only match expressions with that very hash. we keep them out of the
+	// sorted vectors and look them up directly, so that memo tables like
+	// fib[n] = ... with millions of entries neither need to be scanned nor
+	// cost a sorted insert for each new entry.
+	std::unordered_map<hash_t, std::vector<Entry>> m_exact_rules;
+
+	// indexes m_all_rules, empty if there are too few rules.
+	RulesIndex m_index;
+	RulesIndexCache m_index_cache;
+
+	// updates m_index after m_all_rules[i] got inserted.
+	void update_index(size_t i, const Evaluation &evaluation);
+
+	// with Flat or Orderless, even rules without pattern variables match more
+	// than expressions that are same(), so m_rules then contains all rules.
+	inline bool is_indexed(const Entry &entry) const {
+		return m_is_match_size_known && entry.hash;
+	}
+
 	template<typename Filter>
 	inline optional<BaseExpressionRef> apply(
 		const std::vector<Entry> &entries,
@@ -92,15 +118,22 @@ protected:
 		const Evaluation &evaluation) const;
 
 	bool has_rule_with_pattern(
-		std::vector<Entry> &entries,
+		const std::vector<Entry> &entries,
 		const BaseExpressionRef &lhs,
-		const Evaluation &evaluation);
+		const Evaluation &evaluation) const;
 
-	void insert_rule(
+	// returns the position of entry, or of the rule it was merged into.
+	size_t insert_rule(
 		std::vector<Entry> &entries,
 		const Entry &entry,
 		const Evaluation &evaluation);
 
+	template<typename Expression, typename Filter>
+	inline optional<BaseExpressionRef> apply_indexed(
+		const Expression *expr,
+		Filter &filter,
+		const Evaluation &evaluation) const;
+
 	template<typename Expression, typename Filter>
 	inline optional<BaseExpressionRef> apply(
 		const Expression *expr,
@@ -121,14 +154,17 @@ public:
 
 	bool has_rule_with_pattern(
 		const BaseExpressionRef &lhs,
-		const Evaluation &evaluation);
+		const Evaluation &evaluation) const;
 
-	inline auto begin() const {
-		return m_all_rules.begin();
+	inline bool empty() const {
+		return m_all_rules.empty() && m_exact_rules.empty();
 	}
 
-	inline auto end() const {
-		return m_all_rules.end();
+	// all rules in the order in which they are tried.
+	std::vector<Entry> sorted(const Evaluation &evaluation) const;
+
+	inline const RulesIndexCache &index_cache() const {
+		return m_index_cache;
 	}
 };
 
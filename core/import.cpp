@@ -0,0 +1,650 @@
+#include "types.h"
+#include "core/expression/implementation.h"
+#include "import.h"
+
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <limits>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+MappedFile::MappedFile(const std::string &path) : m_data(nullptr), m_size(0), m_open(false) {
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return;
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+		m_size = size_t(info.st_size);
+
+		if (m_size == 0) {
+			m_data = "";
+			m_open = true;
+		} else {
+			void * const data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (data != MAP_FAILED) {
+				madvise(data, m_size, MADV_SEQUENTIAL);
+				m_data = static_cast<const char*>(data);
+				m_open = true;
+			}
+		}
+	}
+
+	close(fd); // the mapping stays valid.
+}
+
+MappedFile::~MappedFile() {
+	if (m_open && m_size > 0) {
+		munmap(const_cast<char*>(m_data), m_size);
+	}
+}
+
+namespace {
+
+inline bool is_blank(char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline void trim(const char *&begin, const char *&end) {
+	while (begin < end && is_blank(*begin)) {
+		begin++;
+	}
+	while (end > begin && is_blank(end[-1])) {
+		end--;
+	}
+}
+
+const machine_real_t powers_of_ten[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+bool scan_real_slowly(const char *begin, const char *end, machine_real_t &value) {
+	char buffer[128];
+	const size_t n = end - begin;
+
+	if (n < sizeof(buffer)) {
+		std::memcpy(buffer, begin, n);
+		buffer[n] = '\0';
+		value = std::strtod(buffer, nullptr);
+	} else {
+		value = std::strtod(std::string(begin, n).c_str(), nullptr);
+	}
+
+	return true;
+}
+
+} // namespace
+
+bool scan_integer(const char *begin, const char *end, machine_integer_t &value) {
+	trim(begin, end);
+
+	bool negative = false;
+	if (begin < end && (*begin == '-' || *begin == '+')) {
+		negative = *begin == '-';
+		begin++;
+	}
+
+	const size_t n = end - begin;
+	if (n < 1 || n > 19) { // 19 digits always fit into 64 bits
+		return false;
+	}
+
+	uint64_t x = 0;
+	for (const char *p = begin; p < end; p++) {
+		const unsigned int digit = static_cast<unsigned char>(*p) - '0';
+		if (digit > 9) {
+			return false;
+		}
+		x = 10 * x + digit;
+	}
+
+	const uint64_t max = uint64_t(std::numeric_limits<machine_integer_t>::max());
+	if (x > max + (negative ? 1 : 0)) {
+		return false;
+	}
+
+	value = negative ? machine_integer_t(0 - x) : machine_integer_t(x);
+	return true;
+}
+
+bool scan_real(const char *begin, const char *end, machine_real_t &value) {
+	trim(begin, end);
+
+	const char *p = begin;
+
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = *p == '-';
+		p++;
+	}
+
+	// the significant digits go into mantissa, as long as they fit; after that,
+	// the result is not exact anymore and we leave the rounding to strtod().
+
+	uint64_t mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	bool any = false;
+	bool exact = true;
+
+	const auto add_digit = [&mantissa, &digits, &exact] (unsigned int digit) {
+		if (digits < 19) {
+			mantissa = 10 * mantissa + digit;
+			if (mantissa > 0) {
+				digits++;
+			}
+			return true;
+		} else {
+			if (digit != 0) {
+				exact = false;
+			}
+			return false;
+		}
+	};
+
+	while (p < end) {
+		const unsigned int digit = static_cast<unsigned char>(*p) - '0';
+		if (digit > 9) {
+			break;
+		}
+		if (!add_digit(digit)) {
+			exponent++;
+		}
+		any = true;
+		p++;
+	}
+
+	if (p < end && *p == '.') {
+		p++;
+		while (p < end) {
+			const unsigned int digit = static_cast<unsigned char>(*p) - '0';
+			if (digit > 9) {
+				break;
+			}
+			if (add_digit(digit)) {
+				exponent--;
+			}
+			any = true;
+			p++;
+		}
+	}
+
+	if (!any) {
+		return false;
+	}
+
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		p++;
+
+		bool negative_exponent = false;
+		if (p < end && (*p == '-' || *p == '+')) {
+			negative_exponent = *p == '-';
+			p++;
+		}
+
+		if (p == end) {
+			return false;
+		}
+
+		int e = 0;
+		while (p < end) {
+			const unsigned int digit = static_cast<unsigned char>(*p) - '0';
+			if (digit > 9) {
+				return false;
+			}
+			if (e < 100000) {
+				e = 10 * e + digit;
+			}
+			p++;
+		}
+
+		exponent += negative_exponent ? -e : e;
+	}
+
+	if (p != end) {
+		return false;
+	}
+
+	// if both the mantissa and the power of ten are exact doubles, a single
+	// multiplication or division rounds correctly (Clinger's fast path).
+
+	if (exact && mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+		const machine_real_t x = machine_real_t(mantissa);
+		const machine_real_t y = exponent < 0 ?
+			x / powers_of_ten[-exponent] : x * powers_of_ten[exponent];
+		value = negative ? -y : y;
+		return true;
+	}
+
+	return scan_real_slowly(begin, end, value);
+}
+
+size_t import_chunk_size(size_t n) {
+	// enough chunks to keep all threads busy, but not below 1 MB each.
+	return std::max(n / (4 * Parallel::MaxParallelism) + 1, size_t(1) << 20);
+}
+
+std::vector<size_t> split_chunks(const char *data, size_t n, size_t chunk_size, const char *separators) {
+	bool is_separator[256] = {false};
+	for (const char *s = separators; *s; s++) {
+		is_separator[static_cast<unsigned char>(*s)] = true;
+	}
+
+	std::vector<size_t> bounds;
+	bounds.push_back(0);
+
+	size_t position = chunk_size;
+	while (position < n) {
+		while (position < n && !is_separator[static_cast<unsigned char>(data[position - 1])]) {
+			position++;
+		}
+		if (position >= n) {
+			break;
+		}
+		bounds.push_back(position);
+		position += chunk_size;
+	}
+
+	bounds.push_back(n);
+	return bounds;
+}
+
+namespace {
+
+class TableChunk {
+public:
+	std::vector<TableColumn> columns;
+	std::vector<uint32_t> widths;
+};
+
+class TableChunkParser {
+private:
+	const char m_separator;
+	std::vector<TableColumn::Type> &m_types;
+	TableChunk &m_chunk;
+	std::string m_quoted;
+
+	bool demote(size_t i) {
+		// column i cannot stay numeric. remember this, and all columns that
+		// are General by now, for the next attempt at parsing the chunk.
+
+		auto &columns = m_chunk.columns;
+		if (m_types.size() < columns.size()) {
+			m_types.resize(columns.size(), TableColumn::Integer);
+		}
+		for (size_t j = 0; j < columns.size(); j++) {
+			if (columns[j].type == TableColumn::General) {
+				m_types[j] = TableColumn::General;
+			}
+		}
+		m_types[i] = TableColumn::General;
+		return false;
+	}
+
+	bool add(size_t i, const char *begin, const char *end) {
+		auto &columns = m_chunk.columns;
+
+		if (i >= columns.size()) {
+			const size_t row = m_chunk.widths.size();
+			if (row == 0) {
+				columns.emplace_back(TableColumn::Integer);
+			} else { // earlier rows miss this field
+				columns.emplace_back(TableColumn::General);
+				columns.back().ends.assign(row, 0);
+			}
+		}
+
+		TableColumn &column = columns[i];
+
+		switch (column.type) {
+			case TableColumn::Integer: {
+				machine_integer_t x;
+				if (scan_integer(begin, end, x)) {
+					column.integers.push_back(x);
+					return true;
+				}
+				machine_real_t y;
+				if (scan_real(begin, end, y)) {
+					column.reals.reserve(column.integers.capacity());
+					for (const machine_integer_t z : column.integers) {
+						column.reals.push_back(machine_real_t(z));
+					}
+					std::vector<machine_integer_t>().swap(column.integers);
+					column.type = TableColumn::Real;
+					column.reals.push_back(y);
+					return true;
+				}
+				return demote(i);
+			}
+
+			case TableColumn::Real: {
+				machine_real_t y;
+				if (scan_real(begin, end, y)) {
+					column.reals.push_back(y);
+					return true;
+				}
+				return demote(i);
+			}
+
+			default:
+				column.text.append(begin, end - begin);
+				column.ends.push_back(column.text.size());
+				return true;
+		}
+	}
+
+	bool end_row(size_t width) {
+		auto &columns = m_chunk.columns;
+
+		for (size_t j = width; j < columns.size(); j++) {
+			TableColumn &column = columns[j];
+			if (column.type != TableColumn::General) {
+				return demote(j);
+			}
+			column.ends.push_back(column.text.size());
+		}
+
+		m_chunk.widths.push_back(uint32_t(width));
+		return true;
+	}
+
+	bool parse_blank_separated(const char *p, const char *end) {
+		while (p < end) {
+			size_t width = 0;
+
+			while (true) {
+				while (p < end && is_blank(*p)) {
+					p++;
+				}
+				if (p >= end || *p == '\n') {
+					break;
+				}
+				const char * const field = p;
+				while (p < end && !is_blank(*p) && *p != '\n') {
+					p++;
+				}
+				if (!add(width++, field, p)) {
+					return false;
+				}
+			}
+
+			if (p < end) {
+				p++; // '\n'
+			}
+
+			if (width > 0 && !end_row(width)) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	const char *parse_quoted(const char *p, const char *end) {
+		// p is right after the opening quote.
+
+		m_quoted.clear();
+
+		while (p < end) {
+			const char * const quote = static_cast<const char*>(std::memchr(p, '"', end - p));
+			if (!quote) {
+				m_quoted.append(p, end - p);
+				return end;
+			}
+			m_quoted.append(p, quote - p);
+			p = quote + 1;
+			if (p < end && *p == '"') {
+				m_quoted.push_back('"');
+				p++;
+			} else {
+				break;
+			}
+		}
+
+		// ignore anything between the closing quote and the next separator.
+		while (p < end && *p != m_separator && *p != '\n') {
+			p++;
+		}
+
+		return p;
+	}
+
+	bool parse_separated(const char *p, const char *end) {
+		const char separator = m_separator;
+
+		while (p < end) {
+			if (*p == '\n') { // blank line
+				p++;
+				continue;
+			} else if (*p == '\r' && (p + 1 == end || p[1] == '\n')) {
+				p += p + 1 == end ? 1 : 2;
+				continue;
+			}
+
+			size_t width = 0;
+
+			while (true) {
+				const char *field;
+				const char *field_end;
+
+				if (p < end && *p == '"') {
+					p = parse_quoted(p + 1, end);
+					field = m_quoted.data();
+					field_end = field + m_quoted.size();
+				} else {
+					field = p;
+					while (p < end && *p != separator && *p != '\n') {
+						p++;
+					}
+					field_end = p;
+					if (field_end > field && field_end[-1] == '\r' && (p == end || *p == '\n')) {
+						field_end--;
+					}
+				}
+
+				if (!add(width++, field, field_end)) {
+					return false;
+				}
+
+				if (p < end && *p == separator) {
+					p++;
+					if (p == end) { // a separator at the very end still ends a field
+						if (!add(width++, p, p)) {
+							return false;
+						}
+						break;
+					}
+				} else {
+					break;
+				}
+			}
+
+			if (p < end) {
+				p++; // '\n'
+			}
+
+			if (!end_row(width)) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+public:
+	inline TableChunkParser(char separator, std::vector<TableColumn::Type> &types, TableChunk &chunk) :
+		m_separator(separator), m_types(types), m_chunk(chunk) {
+	}
+
+	// false, if the chunk needs to be parsed again, as a column turned out to
+	// be General after it had been read as numbers; the new types are then in
+	// m_types.
+	bool parse(const char *begin, const char *end) {
+		m_chunk.columns.clear();
+		m_chunk.widths.clear();
+		for (const TableColumn::Type type : m_types) {
+			m_chunk.columns.emplace_back(type);
+		}
+
+		if (m_separator == ' ') {
+			return parse_blank_separated(begin, end);
+		} else {
+			return parse_separated(begin, end);
+		}
+	}
+};
+
+void parse_table_chunk(
+	const char *begin,
+	const char *end,
+	char separator,
+	std::vector<TableColumn::Type> &types,
+	TableChunk &chunk) {
+
+	TableChunkParser parser(separator, types, chunk);
+	while (!parser.parse(begin, end)) {
+	}
+}
+
+void append_column(TableColumn &column, TableColumn &part) {
+	switch (column.type) {
+		case TableColumn::Integer:
+			column.integers.insert(column.integers.end(), part.integers.begin(), part.integers.end());
+			break;
+
+		case TableColumn::Real:
+			if (part.type == TableColumn::Integer) {
+				for (const machine_integer_t x : part.integers) {
+					column.reals.push_back(machine_real_t(x));
+				}
+			} else {
+				column.reals.insert(column.reals.end(), part.reals.begin(), part.reals.end());
+			}
+			break;
+
+		default: {
+			assert(part.type == TableColumn::General);
+			const size_t base = column.text.size();
+			column.text.append(part.text);
+			for (const size_t end : part.ends) {
+				column.ends.push_back(base + end);
+			}
+			break;
+		}
+	}
+
+	part = TableColumn(part.type); // free the chunk's memory early
+}
+
+} // namespace
+
+Table parse_table(const char *data, size_t n, char separator, const Evaluation &evaluation) {
+	// quoted fields may contain newlines, so that we cannot tell where rows
+	// start without reading everything before.
+	const bool quotes = separator != ' ' && std::memchr(data, '"', n) != nullptr;
+
+	const std::vector<size_t> bounds = quotes ?
+		std::vector<size_t>{0, n} : split_chunks(data, n, import_chunk_size(n), "\n");
+	const size_t n_chunks = bounds.size() - 1;
+
+	std::vector<TableChunk> chunks(n_chunks);
+	std::vector<std::vector<TableColumn::Type>> types(n_chunks);
+
+	const auto parse = [data, separator, &bounds, &chunks, &types] (size_t i) {
+		parse_table_chunk(data + bounds[i], data + bounds[i + 1], separator, types[i], chunks[i]);
+	};
+
+	parallelize(parse, n_chunks, evaluation);
+
+	// a column is General if it is General in any chunk, or if any chunk
+	// misses it; it is Real if it has reals in any chunk.
+
+	size_t n_columns = 0;
+	for (const TableChunk &chunk : chunks) {
+		n_columns = std::max(n_columns, chunk.columns.size());
+	}
+
+	std::vector<TableColumn::Type> column_types(n_columns, TableColumn::Integer);
+	for (const TableChunk &chunk : chunks) {
+		if (chunk.widths.empty()) {
+			continue;
+		}
+		for (size_t j = 0; j < n_columns; j++) {
+			const TableColumn::Type type = j < chunk.columns.size() ?
+				chunk.columns[j].type : TableColumn::General;
+			column_types[j] = std::max(column_types[j], type);
+		}
+	}
+
+	// parse those chunks again that read a General column as numbers.
+
+	std::vector<size_t> again;
+	for (size_t i = 0; i < n_chunks; i++) {
+		const TableChunk &chunk = chunks[i];
+		if (chunk.widths.empty()) {
+			continue;
+		}
+		for (size_t j = 0; j < n_columns; j++) {
+			if (column_types[j] == TableColumn::General &&
+				(j >= chunk.columns.size() || chunk.columns[j].type != TableColumn::General)) {
+
+				types[i].assign(n_columns, TableColumn::Integer);
+				for (size_t k = 0; k < n_columns; k++) {
+					if (column_types[k] == TableColumn::General) {
+						types[i][k] = TableColumn::General;
+					}
+				}
+				again.push_back(i);
+				break;
+			}
+		}
+	}
+
+	parallelize([&again, &parse] (size_t k) {
+		parse(again[k]);
+	}, again.size(), evaluation);
+
+	Table table;
+
+	size_t rows = 0;
+	for (const TableChunk &chunk : chunks) {
+		rows += chunk.widths.size();
+	}
+	table.widths.reserve(rows);
+	for (const TableChunk &chunk : chunks) {
+		table.widths.insert(table.widths.end(), chunk.widths.begin(), chunk.widths.end());
+	}
+
+	table.columns.reserve(n_columns);
+	for (size_t j = 0; j < n_columns; j++) {
+		table.columns.emplace_back(column_types[j]);
+		TableColumn &column = table.columns.back();
+
+		switch (column.type) {
+			case TableColumn::Integer:
+				column.integers.reserve(rows);
+				break;
+			case TableColumn::Real:
+				column.reals.reserve(rows);
+				break;
+			default:
+				column.ends.reserve(rows);
+				break;
+		}
+
+		for (TableChunk &chunk : chunks) {
+			if (!chunk.widths.empty()) {
+				append_column(column, chunk.columns[j]);
+			}
+		}
+
+		assert(column.size() == rows);
+	}
+
+	return table;
+}
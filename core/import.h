@@ -0,0 +1,102 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// the parsing side of Import, ReadList and BinaryReadList. files are mapped
+// into memory and parsed in place, in chunks that run in parallel, into plain
+// vectors that the builtins then wrap into packed slices or string views.
+
+class MappedFile {
+private:
+	const char *m_data;
+	size_t m_size;
+	bool m_open;
+
+public:
+	MappedFile(const std::string &path);
+
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+
+	MappedFile &operator=(const MappedFile&) = delete;
+
+	inline bool is_open() const {
+		return m_open;
+	}
+
+	inline const char *data() const {
+		return m_data;
+	}
+
+	inline size_t size() const {
+		return m_size;
+	}
+};
+
+// scan_integer() and scan_real() accept a number surrounded by optional blanks,
+// e.g. " -12", "1.5e3" or ".5". scan_integer() fails on integers that do not
+// fit into a machine integer, which scan_real() then reads as reals.
+
+bool scan_integer(const char *begin, const char *end, machine_integer_t &value);
+
+bool scan_real(const char *begin, const char *end, machine_real_t &value);
+
+// the size of the chunks a file of n bytes gets split into for parsing.
+size_t import_chunk_size(size_t n);
+
+// the places where a file splits into chunks of roughly chunk_size bytes, such
+// that each chunk starts right after a separator (e.g. a newline). the first
+// element is always 0, the last one always n.
+std::vector<size_t> split_chunks(const char *data, size_t n, size_t chunk_size, const char *separators);
+
+class TableColumn {
+public:
+	enum Type { // in the order in which columns get promoted
+		Integer,
+		Real,
+		General // the fields' text, which may still hold numbers in some rows
+	};
+
+	Type type;
+
+	std::vector<machine_integer_t> integers;
+	std::vector<machine_real_t> reals;
+
+	std::string text; // the fields of a General column, back to back,
+	std::vector<size_t> ends; // each ending at ends[i]
+
+	inline TableColumn(Type type_) : type(type_) {
+	}
+
+	inline size_t size() const {
+		switch (type) {
+			case Integer:
+				return integers.size();
+			case Real:
+				return reals.size();
+			default:
+				return ends.size();
+		}
+	}
+};
+
+// a CSV, TSV or whitespace separated table, parsed column by column. columns
+// of integers or reals stay unboxed; rows with fewer fields than there are
+// columns get empty fields in the missing columns, which makes these General.
+
+class Table {
+public:
+	std::vector<TableColumn> columns;
+	std::vector<uint32_t> widths; // the number of fields in each row
+
+	inline size_t rows() const {
+		return widths.size();
+	}
+};
+
+// separator is ',' for CSV, '\t' for TSV and ' ' for runs of blanks. fields
+// may be quoted with "..." (in which "" stands for "), unless the separator is
+// ' '. blank lines are skipped.
+Table parse_table(const char *data, size_t n, char separator, const Evaluation &evaluation);
@@ -70,13 +70,15 @@ template<typename Callback>
 index_t subsets(
     const std::vector<size_t> &items,
     const Callback &callback,
-    Attributes attributes) {
+    Attributes attributes,
+    size_t min_count,
+    size_t max_count) {
 
     decider<Callback> decide(
         items, callback, attributes & Attributes::Orderless);
 
     if (attributes & Attributes::Flat) {
-        for (index_t i = 1; i <= items.size(); i++) {
+        for (index_t i = min_count; i <= max_count; i++) {
             const index_t result = decide(i);
             if (result >= 0) {
                 return result;
@@ -88,14 +90,181 @@ index_t subsets(
     }
 }
 
+// GenericArgument is one leaf of a pattern for GenericPatternMatcher, together
+// with what we know statically about the leaves it is able to match.
+
+class GenericArgument {
+private:
+    static BaseExpressionPtr required_head(BaseExpressionPtr pattern) {
+        if (!pattern->is_expression()) {
+            return nullptr;
+        }
+
+        const Expression * const expr = pattern->as_expression();
+
+        switch (expr->head()->symbol()) {
+            case S::Blank:
+                if (expr->size() == 1) {
+                    const BaseExpressionPtr head = expr->n_leaves<1>()[0].get();
+                    if (head->is_symbol()) {
+                        return head;
+                    }
+                }
+                return nullptr;
+
+            case S::Pattern:
+                if (expr->size() != 2) {
+                    return nullptr;
+                }
+                return required_head(expr->n_leaves<2>()[1].get());
+
+            case S::PatternTest:
+            case S::Condition:
+                if (expr->size() != 2) {
+                    return nullptr;
+                }
+                return required_head(expr->n_leaves<2>()[0].get());
+
+            case S::BlankSequence:
+            case S::BlankNullSequence:
+            case S::Alternatives:
+            case S::Repeated:
+            case S::RepeatedNull:
+            case S::Except:
+            case S::Optional:
+            case S::OptionsPattern:
+            case S::Longest:
+            case S::Shortest:
+            case S::HoldPattern:
+            case S::Verbatim:
+            case S::Sequence:
+                return nullptr;
+
+            default:
+                break;
+        }
+
+        if (!expr->head()->is_symbol() || has_optional(pattern)) {
+            return nullptr;
+        }
+
+        return expr->head();
+    }
+
+    // returns true if pattern contains no pattern constructs, and collects
+    // the Symbol heads of all expressions in it.
+    static bool is_literal(const BaseExpressionRef &pattern, std::vector<SymbolPtr> &heads) {
+        if (!pattern->is_expression()) {
+            return true;
+        }
+
+        const Expression * const expr = pattern->as_expression();
+
+        switch (expr->head()->symbol()) {
+            case S::Blank:
+            case S::BlankSequence:
+            case S::BlankNullSequence:
+            case S::Pattern:
+            case S::PatternTest:
+            case S::Condition:
+            case S::Alternatives:
+            case S::Repeated:
+            case S::RepeatedNull:
+            case S::Except:
+            case S::Optional:
+            case S::OptionsPattern:
+            case S::Longest:
+            case S::Shortest:
+            case S::HoldPattern:
+            case S::Verbatim:
+                return false;
+
+            default:
+                break;
+        }
+
+        if (!is_literal(expr->_head, heads)) {
+            return false;
+        }
+
+        if (expr->head()->is_symbol()) {
+            heads.push_back(expr->head()->as_symbol());
+        }
+
+        if (is_packed_slice(expr->slice_code())) {
+            return true;
+        }
+
+        return expr->with_slice([&heads] (const auto &slice) {
+            for (auto leaf : slice) {
+                if (!is_literal(leaf, heads)) {
+                    return false;
+                }
+            }
+            return true;
+        });
+    }
+
+public:
+    const PatternMatcherRef matcher;
+
+    // if set, the pattern contains no pattern constructs. it then only matches
+    // leaves that are same() as literal, unless one of literal_heads is
+    // Orderless, Flat or OneIdentity. compiled matchers get cached (see
+    // PatternCache), so we look up these attributes when matching.
+    UnsafeBaseExpressionRef literal;
+    std::vector<SymbolPtr> literal_heads;
+
+    // if set, the pattern only matches leaves having this Symbol as head.
+    UnsafeBaseExpressionRef head;
+
+    inline GenericArgument(const PatternMatcherRef &matcher_, const BaseExpressionRef &pattern) :
+        matcher(matcher_) {
+
+        if (!pattern->is_sequence() && is_literal(pattern, literal_heads)) {
+            literal = pattern;
+        } else {
+            literal_heads.clear();
+            head = required_head(pattern.get());
+        }
+    }
+
+    inline bool is_exact() const {
+        for (const SymbolPtr symbol : literal_heads) {
+            if (any(symbol->state().attributes(),
+                Attributes::Orderless + Attributes::Flat + Attributes::OneIdentity)) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// with Orderless, GenericPatternMatcher first takes away the leaves matching
+// literal arguments (e.g. the a in a + x_), which it finds through their hash,
+// as it does not matter which of several same() leaves they take. it then
+// enumerates assignments for the remaining arguments, but tries only single
+// leaves with the right head for head-constrained arguments like x_Integer or
+// f[x_] (under Flat, groups of leaves always have the Flat head).
+
 template<typename Dummy, typename MatchRest>
 class GenericPatternMatcher :
     public PatternMatcher,
     public ExtendedHeapObject<GenericPatternMatcher<Dummy, MatchRest>> {
 private:
-    const std::vector<PatternMatcherRef> m_matchers;
+    const std::vector<GenericArgument> m_arguments;
     const MatchRest m_rest;
 
+    struct Candidates {
+        // for each leaf, what we match against if the leaf is matched
+        // alone (under Flat, this is the evaluated h[leaf]) and its head.
+        std::vector<UnsafeBaseExpressionRef> items;
+        std::vector<BaseExpressionPtr> heads;
+
+        // the arguments we still need to enumerate assignments for.
+        std::vector<size_t> arguments;
+    };
+
     template<typename Sequence>
     index_t match_generic(
         const Sequence &sequence,
@@ -103,10 +272,11 @@ private:
         index_t end,
         BaseExpressionPtr head,
         Attributes attributes,
+        const Candidates &candidates,
         const std::vector<size_t> &rest,
         size_t arg) const {
 
-        if (arg == m_matchers.size()) {
+        if (arg == candidates.arguments.size()) {
             if (!rest.empty()) {
                 return -1;
             } else {
@@ -114,18 +284,39 @@ private:
             }
         }
 
+        const GenericArgument &argument = m_arguments[candidates.arguments[arg]];
+
+        const BaseExpressionPtr required_head =
+            argument.head.get() != head ? argument.head.get() : nullptr;
+
+        // each argument takes at least one leaf (exactly one without Flat),
+        // and the last one needs to take all leaves that are left.
+
+        const size_t n_arguments_left = candidates.arguments.size() - arg;
+
+        if (rest.size() < n_arguments_left ||
+            (!(attributes & Attributes::Flat) && rest.size() != n_arguments_left)) {
+            return -1;
+        }
+
+        const size_t min_count = n_arguments_left == 1 ? rest.size() : 1;
+        const size_t max_count = required_head ? 1 : rest.size() - (n_arguments_left - 1);
+
+        if (min_count > max_count) {
+            return -1;
+        }
+
         return subsets(rest,
-            [this, &sequence, begin, end, head, attributes, arg]
+            [this, &sequence, begin, end, head, attributes, &candidates, &argument, required_head, arg]
             (const auto &chosen, const auto &not_chosen) -> index_t {
 
                 UnsafeBaseExpressionRef expr;
 
                 if (chosen.size() == 1) {
-                    expr = *sequence.element(chosen[0]);
-                    if (attributes & Attributes::Flat) {
-                        expr = expression(head, expr)->evaluate_or_copy(
-                            sequence.context().evaluation);
+                    if (required_head && candidates.heads[chosen[0] - begin] != required_head) {
+                        return -1;
                     }
+                    expr = candidates.items[chosen[0] - begin];
                 } else {
                     assert(attributes & Attributes::Flat);
                     expr = expression(
@@ -143,8 +334,9 @@ private:
 
                 // std::cout << "trying to match " << expr->debugform() << " as argument " << arg << std::endl;
 
-                if (m_matchers[arg]->match(FlatLeafSequence(sequence.context(), head, expr), 0, 1) == 1) {
-                    const index_t match = match_generic(sequence, begin, end, head, attributes, not_chosen, arg + 1);
+                if (argument.matcher->match(FlatLeafSequence(sequence.context(), head, expr), 0, 1) == 1) {
+                    const index_t match = match_generic(
+                        sequence, begin, end, head, attributes, candidates, not_chosen, arg + 1);
                     if (match >= 0) {
                         // std::cout << "match success" << std::endl;
                         return match;
@@ -155,7 +347,7 @@ private:
                 }
 
                 return -1;
-            }, attributes);
+            }, attributes, min_count, max_count);
     }
 
     template<typename Sequence>
@@ -170,21 +362,96 @@ private:
         const Attributes attributes =
             head->lookup_name()->state().attributes();
 
+        const Evaluation &evaluation = sequence.context().evaluation;
+
+        Candidates candidates;
+        candidates.items.reserve(end - begin);
+        candidates.heads.reserve(end - begin);
+        for (index_t i = begin; i < end; i++) {
+            UnsafeBaseExpressionRef expr = *sequence.element(i);
+            if (attributes & Attributes::Flat) {
+                expr = expression(head, expr)->evaluate_or_copy(evaluation);
+            }
+            candidates.heads.push_back(expr->head(evaluation));
+            candidates.items.emplace_back(std::move(expr));
+        }
+
+        std::vector<bool> taken(end - begin, false);
+
+        std::unordered_multimap<hash_t, index_t> hashes;
+        std::unordered_map<BaseExpressionPtr, size_t> needed_heads;
+
+        const size_t n_arguments = m_arguments.size();
+        candidates.arguments.reserve(n_arguments);
+
+        for (size_t arg = 0; arg < n_arguments; arg++) {
+            const GenericArgument &argument = m_arguments[arg];
+            const BaseExpressionPtr literal = argument.literal.get();
+
+            if (literal && (attributes & Attributes::Orderless) &&
+                !(literal->is_expression() && literal->as_expression()->head() == head) &&
+                argument.is_exact()) {
+
+                if (hashes.empty()) {
+                    for (index_t i = begin; i < end; i++) {
+                        hashes.emplace(candidates.items[i - begin]->hash(), i);
+                    }
+                }
+
+                index_t found = -1;
+                const auto range = hashes.equal_range(literal->hash());
+                for (auto i = range.first; i != range.second; i++) {
+                    const index_t j = i->second;
+                    if (!taken[j - begin] && (found < 0 || j < found) &&
+                        candidates.items[j - begin]->same(literal)) {
+                        found = j;
+                    }
+                }
+
+                if (found < 0) {
+                    return -1;
+                }
+
+                taken[found - begin] = true;
+            } else {
+                if (argument.head && argument.head.get() != head) {
+                    needed_heads[argument.head.get()]++;
+                }
+                candidates.arguments.push_back(arg);
+            }
+        }
+
+        // each head-constrained argument needs a leaf of its own.
+        for (const auto &needed : needed_heads) {
+            size_t available = 0;
+            for (index_t i = begin; i < end && available < needed.second; i++) {
+                if (!taken[i - begin] && candidates.heads[i - begin] == needed.first) {
+                    available++;
+                }
+            }
+            if (available < needed.second) {
+                return -1;
+            }
+        }
+
         std::vector<size_t> indices;
         indices.reserve(end - begin);
-        for (size_t i = begin; i < end; i++) {
-            indices.push_back(i);
+        for (index_t i = begin; i < end; i++) {
+            if (!taken[i - begin]) {
+                indices.push_back(i);
+            }
         }
 
-        return match_generic(sequence, begin, end, head, attributes, indices, 0);
+        return match_generic(
+            sequence, begin, end, head, attributes, candidates, indices, 0);
     }
 
 public:
     inline GenericPatternMatcher(
-        std::vector<PatternMatcherRef> &&matchers,
+        std::vector<GenericArgument> &&arguments,
         const MatchRest &next) :
 
-        m_matchers(matchers),
+        m_arguments(arguments),
         m_rest(next) {
 
         PatternMatcherSize any_size(
@@ -2,6 +2,7 @@
 #include "core/atoms/symbol.h"
 #include "matcher.tcc"
 #include "unicode/uchar.h"
+#include "core/pattern/automaton.h"
 
 #define DECLARE_MATCH_EXPRESSION_METHODS                                                                      \
 	virtual index_t match( 					                                                                  \
@@ -390,6 +391,26 @@ public:
 	}
 };
 
+class NativePatternTest {
+private:
+    const NativePredicate m_predicate;
+    const PatternTest m_fallback;
+
+public:
+    inline NativePatternTest(const NativePredicate &predicate, const BaseExpressionRef &test) :
+        m_predicate(predicate), m_fallback(test) {
+    }
+
+	template<typename Sequence, typename Slice>
+	inline bool operator()(const Sequence &sequence, Slice &slice) const {
+        const tribool result = m_predicate((*slice).get());
+        if (result == undecided) {
+            return m_fallback(sequence, slice);
+        }
+        return result;
+	}
+};
+
 template<typename F>
 auto with_pattern_test(const BaseExpressionRef &test, const F& f) {
 	if (test) {
@@ -414,8 +435,19 @@ auto with_pattern_test(const BaseExpressionRef &test, const F& f) {
 				return f([] (const auto&, auto &slice) {
 					return (*slice)->is_non_negative();
 				});
-			default:
-				return f(PatternTest(test));
+			case S::IntegerQ:
+			case S::EvenQ:
+			case S::OddQ:
+			case S::MachineNumberQ:
+				return f(NativePatternTest(NativePredicate::function(test->symbol()), test));
+			default: {
+				const NativePredicate predicate = NativePredicate::pure_function(test.get());
+				if (predicate.defined()) {
+					return f(NativePatternTest(predicate, test));
+				} else {
+					return f(PatternTest(test));
+				}
+			}
 		}
 	} else {
 		return f(NoPatternTest());
@@ -1495,14 +1527,17 @@ private:
             return -1;
         }
 
-		return m_strategy(
-			sequence,
-			begin,
-			min_size,
-			max_size,
-			[this, begin, end, &sequence] (index_t i) {
-				auto slice = sequence.slice(begin, begin + i);
-                return m_rest(sequence, begin + i, end, slice);
+		return sequence.context().memoized(this, sequence, begin, end,
+			[this, begin, end, min_size, max_size, &sequence] () {
+				return m_strategy(
+					sequence,
+					begin,
+					min_size,
+					max_size,
+					[this, begin, end, &sequence] (index_t i) {
+						auto slice = sequence.slice(begin, begin + i);
+		                return m_rest(sequence, begin + i, end, slice);
+					});
 			});
 	}
 
@@ -1570,6 +1605,43 @@ public:
     DECLARE_NO_MATCH_CHARACTER_METHODS
 };
 
+// a Condition on one variable like x > 0 or IntegerQ[x], which can often be
+// decided without evaluating it (see NativePredicate).
+
+class NativeCondition {
+private:
+    NativePredicate m_predicate;
+    index_t m_slot_index;
+
+public:
+    NativeCondition(const BaseExpressionRef &condition, const CompiledVariables &variables) :
+        m_slot_index(-1) {
+
+        index_t index;
+        m_predicate = NativePredicate::condition(
+            condition.get(),
+            [&variables] (BaseExpressionPtr item) -> index_t {
+                return item->is_symbol() ? variables.find(item->as_symbol()) : -1;
+            },
+            index);
+
+        if (m_predicate.defined()) {
+            m_slot_index = index;
+        }
+    }
+
+    inline tribool operator()(const Match &match) const {
+        if (m_slot_index < 0) {
+            return undecided;
+        }
+        const UnsafeBaseExpressionRef &value = match.slot(m_slot_index);
+        if (!value) {
+            return undecided;
+        }
+        return m_predicate(value.get());
+    }
+};
+
 template<typename Dummy, typename MatchRest>
 class ConditionMatcher :
     public PatternMatcher,
@@ -1577,6 +1649,7 @@ class ConditionMatcher :
 private:
     const PatternMatcherRef m_matcher;
     const BaseExpressionRef m_condition;
+    const NativeCondition m_native;
     const MatchRest m_rest;
 
     template<typename Sequence>
@@ -1591,13 +1664,25 @@ private:
         }
 
         const MatchContext &context = sequence.context();
-        const Evaluation &evaluation = context.evaluation;
 
-        const BaseExpressionRef condition =
-            m_condition->replace_all_or_copy(context.match, evaluation);
+        switch (m_native(*context.match)) {
+            case true:
+                break;
 
-        if (!condition->evaluate_or_copy(evaluation)->is_true()) {
-            return -1;
+            case false:
+                return -1;
+
+            default: {
+                const Evaluation &evaluation = context.evaluation;
+
+                const BaseExpressionRef condition =
+                    m_condition->replace_all_or_copy(context.match, evaluation);
+
+                if (!condition->evaluate_or_copy(evaluation)->is_true()) {
+                    return -1;
+                }
+                break;
+            }
         }
 
         auto slice = sequence.slice(match, end);
@@ -1606,11 +1691,12 @@ private:
 
 public:
     ConditionMatcher(
-        const std::tuple<PatternMatcherRef, BaseExpressionRef> &parameters,
+        const std::tuple<PatternMatcherRef, BaseExpressionRef, NativeCondition> &parameters,
         const MatchRest &rest) :
 
         m_matcher(std::get<0>(parameters)),
         m_condition(std::get<1>(parameters)),
+        m_native(std::get<2>(parameters)),
         m_rest(rest) {
     }
 
@@ -1980,6 +2066,42 @@ PatternMatcherRef PatternCompiler::compile_element(
 	return matcher;
 }
 
+// collects all symbols in item, which is a superset of both its pattern
+// variables and the variables its conditions refer to. returns false if
+// item contains OptionsPattern, whose outcome depends on more than that.
+static bool collect_symbols(
+    const BaseExpressionRef &item,
+    std::unordered_set<SymbolRef, SymbolHash, SymbolEqual> &symbols) {
+
+    switch (item->type()) {
+        case SymbolType:
+            symbols.insert(SymbolRef(item->as_symbol()));
+            return item->symbol() != S::OptionsPattern;
+
+        case ExpressionType: {
+            const Expression * const expr = item->as_expression();
+            if (!collect_symbols(expr->_head, symbols)) {
+                return false;
+            }
+            if (is_packed_slice(expr->slice_code())) {
+                return true;
+            }
+            return expr->with_slice([&symbols] (const auto &slice) {
+                const size_t n = slice.size();
+                for (size_t i = 0; i < n; i++) {
+                    if (!collect_symbols(slice[i], symbols)) {
+                        return false;
+                    }
+                }
+                return true;
+            });
+        }
+
+        default:
+            return true;
+    }
+}
+
 class PatternBuilder {
 private:
     CachedPatternMatcherRef m_next_matcher;
@@ -2030,6 +2152,12 @@ PatternMatcherRef PatternCompiler::compile_ordered(
 
 	UnsafePatternMatcherRef next_matcher = factory.next();
 
+	// if the chain ends here, matching from leaf i on can only depend on the
+	// variables in leaves i to n - 1, which allows sequence matchers to
+	// memoize their failures (see SequenceMemo).
+	bool memoize = !next_matcher;
+	std::unordered_set<SymbolRef, SymbolHash, SymbolEqual> symbols;
+
 	for (index_t i = n - 1; i >= 0; i--) {
         const PatternMatcherSize size(
             matchable[i], matchable[i + 1]);
@@ -2037,6 +2165,15 @@ PatternMatcherRef PatternCompiler::compile_ordered(
         const PatternMatcherRef matcher = compile_element(
             begin[i], size, factory.for_next(next_matcher));
 
+        if (memoize && collect_symbols(begin[i], symbols)) {
+            if (!matcher->fixed_size()) {
+                matcher->set_memo_symbols(
+                    std::vector<SymbolRef>(symbols.begin(), symbols.end()));
+            }
+        } else {
+            memoize = false;
+        }
+
 		next_matcher = matcher;
     }
 
@@ -2052,8 +2189,8 @@ PatternMatcherRef PatternCompiler::compile_generic(
     const PatternFactory &factory) {
 
     const index_t n = end - begin;
-    std::vector<PatternMatcherRef> matchers;
-    matchers.reserve(n);
+    std::vector<GenericArgument> arguments;
+    arguments.reserve(n);
 
     const auto unanchored = factory.unanchored();
 
@@ -2061,12 +2198,12 @@ PatternMatcherRef PatternCompiler::compile_generic(
         MatchSize::at_least(0), MatchSize::at_least(0));
 
     for (index_t i = 0; i < n; i++) {
-        matchers.push_back(compile_element(
-            begin[i], any_size, unanchored));
+        arguments.emplace_back(compile_element(
+            begin[i], any_size, unanchored), begin[i]);
     }
 
     PatternMatcherRef matcher =
-        factory.create<GenericPatternMatcher>(std::move(matchers));
+        factory.create<GenericPatternMatcher>(std::move(arguments));
 
     return matcher;
 }
@@ -2393,8 +2530,10 @@ PatternMatcherRef PatternCompiler::compile_expression(
 
         case S::Condition:
             if (patt_end - patt_begin == 2) {
+                const PatternMatcherRef matcher =
+                    compile(*patt_begin, size.from_next(), factory);
                 return factory.create<ConditionMatcher>(std::make_tuple(
-                    compile(*patt_begin, size.from_next(), factory), patt_begin[1]));
+                    matcher, patt_begin[1], NativeCondition(patt_begin[1], factory.variables())));
             }
             break;
 
@@ -2464,8 +2603,12 @@ PatternMatcherRef compile_expression_pattern(const BaseExpressionRef &patt) {
 PatternMatcherRef compile_string_pattern(const BaseExpressionRef &patt) {
     PatternCompiler compiler(patt, true);
     CompiledVariables variables;
-    return compiler.compile(
+    const PatternMatcherRef matcher = compiler.compile(
         PatternFactory(variables, PatternLength(PatternLength::Longest)));
+    // StringAutomaton only accepts a subset of the patterns that compile
+    // without errors, so it never hides a FailedPatternMatcher here.
+    matcher->set_automaton(StringAutomaton::compile(patt));
+    return matcher;
 }
 
 index_t PatternMatcher::match(
@@ -2476,6 +2619,9 @@ index_t PatternMatcher::match(
 
     switch (string->extent_type()) {
         case StringExtent::ascii: {
+            if (m_automaton) {
+                return m_automaton->match(context, string, begin, end);
+            }
             const AsciiCharacterSequence sequence(context, string);
             return match(sequence, begin, end);
         }
@@ -2493,6 +2639,28 @@ index_t PatternMatcher::match(
     }
 }
 
+index_t PatternMatcher::search(
+    MatchContext &context,
+    const String *string,
+    index_t begin,
+    index_t end,
+    index_t &match_begin) const {
+
+    if (m_automaton && string->extent_type() == StringExtent::ascii) {
+        return m_automaton->search(context, string, begin, end, match_begin);
+    }
+
+    for (index_t i = begin; i < end; i++) {
+        const index_t match_end = match(context, string, i, end);
+        if (match_end >= 0) {
+            match_begin = i;
+            return match_end;
+        }
+    }
+
+    return -1;
+}
+
 RewriteBaseExpression MatcherBase::prepare(
     const BaseExpressionRef &item,
     const Evaluation &evaluation) const {
@@ -2526,8 +2694,8 @@ inline bool HeadLeavesMatcher::match(
 
     if (expr->has_leaves_array()) {
         if (expr->with_leaves_array(
-            [&context, head, &match_leaves] (const BaseExpressionRef *leaves, size_t size) {
-                return match_leaves->match(FastLeafSequence(context, head, leaves), 0, size);
+            [&context, head, expr, &match_leaves] (const BaseExpressionRef *leaves, size_t size) {
+                return match_leaves->match(FastLeafSequence(context, head, leaves, expr), 0, size);
             }) < 0) {
 
             return false;
@@ -9,10 +9,15 @@ class AsciiCharacterSequence;
 class SimpleCharacterSequence;
 class ComplexCharacterSequence;
 
+class StringAutomaton;
+
 class PatternMatcher : public AbstractHeapObject<PatternMatcher> {
 protected:
     PatternMatcherSize m_size;
     CompiledVariables m_variables;
+    std::vector<SymbolRef> m_memo_symbols;
+    bool m_memoize;
+    std::shared_ptr<const StringAutomaton> m_automaton;
 
 public:
     virtual void set_size(const PatternMatcherSize &size) {
@@ -27,7 +32,28 @@ public:
         return m_variables;
     }
 
-    inline PatternMatcher() {
+    // symbols whose bindings the outcome of matching from this node might
+    // depend on. setting these allows the node to memoize its failures.
+    inline void set_memo_symbols(std::vector<SymbolRef> &&symbols) {
+        m_memo_symbols = std::move(symbols);
+        m_memoize = true;
+    }
+
+    inline bool memoizable() const {
+        return m_memoize;
+    }
+
+    inline const std::vector<SymbolRef> &memo_symbols() const {
+        return m_memo_symbols;
+    }
+
+    // an equivalent of this (string) pattern that matches ASCII strings
+    // without backtracking, see StringAutomaton.
+    inline void set_automaton(const std::shared_ptr<const StringAutomaton> &automaton) {
+        m_automaton = automaton;
+    }
+
+    inline PatternMatcher() : m_memoize(false) {
     }
 
     virtual ~PatternMatcher() {
@@ -82,6 +108,15 @@ public:
         const String *string,
         index_t begin,
         index_t end) const;
+
+    // finds the first i with begin <= i < end such that match() from i
+    // succeeds. returns the end of that match and stores i in match_begin.
+    index_t search(
+        MatchContext &context,
+        const String *string,
+        index_t begin,
+        index_t end,
+        index_t &match_begin) const;
 };
 
 class Matcher;
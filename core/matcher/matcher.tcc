@@ -7,6 +7,7 @@
 #include "core/builtin.h"
 #include "core/pattern/context.tcc"
 #include "core/pattern/sequence.tcc"
+#include "core/pattern/predicate.h"
 
 class StringMatcherBase {
 protected:
@@ -96,29 +97,30 @@ public:
         inline bool next() {
             m_context.reset();
 
-            // this is a very simple brute force approach currently. it could be based on
-            // something much smarter like Boyer Moore if the pattern starts with a fixed
-            // string, which is usually always the case, see
-            // https://en.wikipedia.org/wiki/Boyer%E2%80%93Moore_string_search_algorithm
-
-            while (m_begin < m_end) {
-                const index_t match_end = m_matcher->match(
-                    m_context, m_string, m_begin, m_end);
-                if (match_end >= 0) {
-                    m_match_begin = m_begin;
-                    m_match_end = match_end;
-                    if (m_overlap) {
-                        m_begin++;
-                    } else {
-                        m_begin = match_end;
-                    }
-                    return true;
+            index_t match_begin;
+            const index_t match_end = m_matcher->search(
+                m_context, m_string, m_begin, m_end, match_begin);
+
+            if (match_end >= 0) {
+                m_match_begin = match_begin;
+                m_match_end = match_end;
+                if (m_overlap || match_end == match_begin) {
+                    m_begin = match_begin + 1; // never stall on an empty match.
                 } else {
-                    m_begin++;
+                    m_begin = match_end;
                 }
+                return true;
+            } else {
+                m_begin = m_end;
+                return false;
             }
+        }
 
-            return false;
+        // searches again from begin, which might lie before where next()
+        // would continue, e.g. inside the last match.
+        inline bool next(index_t begin) {
+            m_begin = begin;
+            return next();
         }
     };
 
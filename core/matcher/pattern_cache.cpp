@@ -0,0 +1,156 @@
+#include "core/types.h"
+#include "core/expression/implementation.h"
+#include "pattern_cache.h"
+
+#include <chrono>
+
+PatternCache *PatternCache::s_instance = nullptr;
+
+void PatternCache::init() {
+	assert(s_instance == nullptr);
+	s_instance = new PatternCache();
+}
+
+PatternCache::PatternCache() {
+	m_statistics.hits = 0;
+	m_statistics.misses = 0;
+	m_statistics.compile_seconds = 0.0;
+}
+
+hash_t PatternCache::key(Kind kind, const BaseExpressionRef &expr, const PatternMatcher *matcher) {
+	return hash_combine(
+		hash_pair(hash_t(kind), std::uintptr_t(matcher)), expr->hash());
+}
+
+PatternCache::List::iterator PatternCache::find(
+	Kind kind,
+	hash_t h,
+	const BaseExpressionRef &expr,
+	const PatternMatcher *matcher) {
+
+	const auto range = m_index.equal_range(h);
+	for (auto i = range.first; i != range.second; i++) {
+		const Entry &entry = *i->second;
+		if (entry.kind == kind &&
+			(kind != RewritePattern || entry.matcher.get() == matcher) &&
+			entry.expr->same(expr)) {
+
+			// move to front, i.e. make this the most recently used entry.
+			m_entries.splice(m_entries.begin(), m_entries, i->second);
+			return m_entries.begin();
+		}
+	}
+
+	return m_entries.end();
+}
+
+void PatternCache::insert(hash_t h, Entry &&entry) {
+	m_entries.emplace_front(std::move(entry));
+	m_index.emplace(h, m_entries.begin());
+
+	if (m_entries.size() > Capacity) {
+		const auto last = std::prev(m_entries.end());
+		const Entry &evicted = *last;
+
+		const hash_t evicted_h = key(
+			evicted.kind,
+			evicted.expr,
+			evicted.kind == RewritePattern ? evicted.matcher.get() : nullptr);
+
+		const auto range = m_index.equal_range(evicted_h);
+		for (auto i = range.first; i != range.second; i++) {
+			if (i->second == last) {
+				m_index.erase(i);
+				break;
+			}
+		}
+
+		m_entries.erase(last);
+	}
+}
+
+template<typename Compile>
+PatternMatcherRef PatternCache::matcher(
+	Kind kind,
+	const BaseExpressionRef &patt,
+	const Compile &compile) {
+
+	const hash_t h = key(kind, patt, nullptr);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		const auto i = find(kind, h, patt, nullptr);
+		if (i != m_entries.end()) {
+			m_statistics.hits++;
+			return i->matcher;
+		}
+	}
+
+	// compile without holding the lock, as compiling might be slow.
+
+	const auto t0 = std::chrono::steady_clock::now();
+	const PatternMatcherRef matcher = compile(patt);
+	const auto t1 = std::chrono::steady_clock::now();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_statistics.misses++;
+	m_statistics.compile_seconds += std::chrono::duration<double>(t1 - t0).count();
+
+	const auto i = find(kind, h, patt, nullptr);
+	if (i != m_entries.end()) {
+		return i->matcher; // some other thread was faster.
+	}
+
+	insert(h, Entry{kind, patt, matcher, RewriteRef()});
+	return matcher;
+}
+
+PatternMatcherRef PatternCache::expression_matcher(const BaseExpressionRef &patt) {
+	return matcher(ExpressionPattern, patt, compile_expression_pattern);
+}
+
+PatternMatcherRef PatternCache::string_matcher(const BaseExpressionRef &patt) {
+	return matcher(StringPattern, patt, compile_string_pattern);
+}
+
+RewriteRef PatternCache::rewrite(
+	const PatternMatcherRef &matcher,
+	const BaseExpressionRef &rhs,
+	const Evaluation &evaluation) {
+
+	const hash_t h = key(RewritePattern, rhs, matcher.get());
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		const auto i = find(RewritePattern, h, rhs, matcher.get());
+		if (i != m_entries.end()) {
+			m_statistics.hits++;
+			return i->rewrite;
+		}
+	}
+
+	const auto t0 = std::chrono::steady_clock::now();
+	CompiledArguments arguments(matcher->variables());
+	const RewriteRef rewrite = Rewrite::from_arguments(arguments, rhs, evaluation);
+	const auto t1 = std::chrono::steady_clock::now();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_statistics.misses++;
+	m_statistics.compile_seconds += std::chrono::duration<double>(t1 - t0).count();
+
+	const auto i = find(RewritePattern, h, rhs, matcher.get());
+	if (i != m_entries.end()) {
+		return i->rewrite;
+	}
+
+	// keeping matcher in the entry guarantees that its address is not reused.
+	insert(h, Entry{RewritePattern, rhs, matcher, rewrite});
+	return rewrite;
+}
+
+PatternCache::Statistics PatternCache::statistics() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_statistics;
+}
@@ -0,0 +1,82 @@
+#ifndef CMATHICS_PATTERN_CACHE_H
+#define CMATHICS_PATTERN_CACHE_H
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+// PatternCache is a process-wide, bounded LRU cache of compiled patterns and
+// rewrites. Cache (see core/cache.h) only caches these per expression object,
+// so a pattern that arrives in a new expression object (e.g. Cases[list, _Integer]
+// typed again, or a rule built dynamically) would otherwise get compiled again.
+
+// patterns are looked up by their structural hash() and same(). compiled
+// matchers look up the attributes of symbols during matching, also for the
+// heads inside literal arguments (see GenericArgument), so sharing them
+// between same() patterns is safe, even across SetAttributes and ClearAttributes.
+
+class PatternCache {
+public:
+	static constexpr size_t Capacity = 4096;
+
+	struct Statistics {
+		size_t hits;
+		size_t misses;
+		double compile_seconds; // time spent compiling on misses
+	};
+
+private:
+	static PatternCache *s_instance;
+
+	enum Kind {
+		ExpressionPattern,
+		StringPattern,
+		RewritePattern
+	};
+
+	struct Entry {
+		Kind kind;
+		BaseExpressionRef expr; // the pattern, or the rhs for RewritePattern
+		PatternMatcherRef matcher;
+		RewriteRef rewrite;
+	};
+
+	using List = std::list<Entry>;
+
+	std::mutex m_mutex;
+	List m_entries; // most recently used first
+	std::unordered_multimap<hash_t, List::iterator> m_index;
+
+	Statistics m_statistics;
+
+	static hash_t key(Kind kind, const BaseExpressionRef &expr, const PatternMatcher *matcher);
+
+	List::iterator find(Kind kind, hash_t h, const BaseExpressionRef &expr, const PatternMatcher *matcher);
+
+	void insert(hash_t h, Entry &&entry);
+
+	template<typename Compile>
+	PatternMatcherRef matcher(Kind kind, const BaseExpressionRef &patt, const Compile &compile);
+
+public:
+	static void init();
+
+	static inline PatternCache &instance() {
+		return *s_instance;
+	}
+
+	PatternCache();
+
+	PatternMatcherRef expression_matcher(const BaseExpressionRef &patt);
+
+	PatternMatcherRef string_matcher(const BaseExpressionRef &patt);
+
+	RewriteRef rewrite(
+		const PatternMatcherRef &matcher,
+		const BaseExpressionRef &rhs,
+		const Evaluation &evaluation);
+
+	Statistics statistics();
+};
+
+#endif //CMATHICS_PATTERN_CACHE_H
@@ -4,6 +4,9 @@
 #include "numberform.h"
 #include "core/atoms/string.h"
 #include "evaluation.h"
+#include "digits.h"
+
+#include <cstring>
 
 inline StringRef round(StringRef number, machine_integer_t n_digits) {
     assert(n_digits < 0);
@@ -30,6 +33,22 @@ inline machine_integer_t round_exp(machine_integer_t exp, machine_integer_t step
     }
 }
 
+// the digits MachineReal::make_boxes asks to_s_exp for, as a printf_digits
+// precision: 6 digits, or in InputForm and FullForm none, i.e. "%f".
+inline bool make_boxes_precision(BaseExpressionPtr form, int &precision) {
+    switch (form->symbol()) {
+        case S::InputForm:
+        case S::FullForm:
+            precision = -1;
+            return true;
+        case S::OutputForm:
+            precision = 5;
+            return true;
+        default:
+            return false; // exponents become SuperscriptBoxes
+    }
+}
+
 class IllegalDigitBlock {
 };
 
@@ -532,4 +551,92 @@ BaseExpressionRef NumberFormatter::operator()(
     }
 
     return options.NumberFormat(this, s, m_base_10, pexp, options, form, evaluation);
-}
\ No newline at end of file
+}
+inline void NumberFormatter::append_digits(
+    std::string &out,
+    const RealDigits &d,
+    const Evaluation &evaluation) const {
+
+    // the steps of operator() for make_boxes_defaults(): ExponentStep 1, no
+    // DigitBlock, no left NumberPadding and a NumberFormat that gives x*^e.
+
+    machine_integer_t exp = d.exp;
+    const machine_integer_t rexp = round_exp(exp, 1);
+    const bool scientific = rexp < -5 || rexp > 5;
+    if (scientific) {
+        exp -= rexp;
+    }
+
+    if (d.negative) {
+        out.push_back('-');
+    }
+
+    const machine_integer_t length = d.length;
+
+    if (exp < 0) { // pad left with '0'.
+        out.append("0.", 2);
+        out.append(size_t(-exp - 1), '0');
+        out.append(d.digits, length);
+    } else if (length < exp + 1) { // pad right with '0'.
+        evaluation.message(m_number_form, "sigz");
+        out.append(d.digits, length);
+        out.append(size_t(exp + 1 - length), '0');
+        out.push_back('.');
+    } else {
+        out.append(d.digits, exp + 1);
+        out.push_back('.');
+        out.append(d.digits + exp + 1, length - (exp + 1));
+    }
+
+    if (scientific) {
+        char buffer[MaxIntegerDigits + 1];
+        out.append("*^", 2);
+        out.append(buffer, integer_text(buffer, rexp));
+    }
+}
+
+bool NumberFormatter::append_real(
+    std::string &out,
+    machine_real_t x,
+    BaseExpressionPtr form,
+    const Evaluation &evaluation) const {
+
+    int precision;
+    RealDigits d;
+
+    if (!make_boxes_precision(form, precision) || !printf_digits(x, precision, d)) {
+        return false;
+    }
+
+    append_digits(out, d, evaluation);
+    return true;
+}
+
+size_t NumberFormatter::append_reals(
+    std::string &out,
+    const machine_real_t *values,
+    size_t n,
+    const char *separator,
+    BaseExpressionPtr form,
+    const Evaluation &evaluation) const {
+
+    int precision;
+    if (!make_boxes_precision(form, precision)) {
+        return 0;
+    }
+
+    const size_t separator_length = std::strlen(separator);
+    RealDigits d;
+
+    for (size_t i = 0; i < n; i++) {
+        if (!printf_digits(values[i], precision, d)) {
+            return i;
+        }
+        if (i > 0) {
+            out.append(separator, separator_length);
+        }
+        append_digits(out, d, evaluation);
+    }
+
+    return n;
+}
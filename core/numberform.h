@@ -3,6 +3,7 @@
 
 class NumberFormatter;
 class NumberFormOptions;
+struct RealDigits;
 
 using NumberFormatFunction = std::function<BaseExpressionRef(
     const NumberFormatter *formatter,
@@ -82,6 +83,11 @@ private:
         BaseExpressionPtr form,
         const Evaluation &evaluation) const;
 
+    inline void append_digits(
+        std::string &out,
+        const RealDigits &d,
+        const Evaluation &evaluation) const;
+
 public:
     BaseExpressionRef operator()(
         const SExp &s_exp,
@@ -91,6 +97,27 @@ public:
 	    const NumberFormOptions &options,
         const Evaluation &evaluation) const;
 
+    // appends x as boxes_to_text reads MakeBoxes[x, form] for the builtin
+    // rules, i.e. as operator() formats it with make_boxes_defaults(), but
+    // without building strings and boxes. returns false, without appending
+    // anything, if x or form needs the full path.
+    bool append_real(
+        std::string &out,
+        machine_real_t x,
+        BaseExpressionPtr form,
+        const Evaluation &evaluation) const;
+
+    // appends up to n reals separated by separator as append_real does, and
+    // returns how many were appended. if that is less than n, the next one
+    // needs the full path.
+    size_t append_reals(
+        std::string &out,
+        const machine_real_t *values,
+        size_t n,
+        const char *separator,
+        BaseExpressionPtr form,
+        const Evaluation &evaluation) const;
+
 	inline const NumberFormOptions &defaults() const {
 		return m_default_options;
 	}
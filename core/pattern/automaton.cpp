@@ -0,0 +1,826 @@
+#include "core/types.h"
+#include "core/expression/implementation.h"
+#include "unicode/uchar.h"
+#include "automaton.h"
+
+#include <cstring>
+
+namespace {
+
+inline bool is_ascii_newline(char c) {
+	return c >= 0x0a && c <= 0x0d; // see is_newline() in matcher.cpp
+}
+
+inline bool is_ascii_word(const char *text, index_t n, index_t i) {
+	return i < n && isalnum(text[i]);
+}
+
+template<typename F>
+StringAutomaton::CharacterSet character_class(const F &f) {
+	StringAutomaton::CharacterSet set;
+	for (int c = 0; c < 128; c++) {
+		if (f(c)) {
+			set.set(c);
+		}
+	}
+	return set;
+}
+
+} // namespace
+
+class StringAutomaton::Compiler {
+private:
+	StringAutomaton &m_automaton;
+
+	// when we're inside Repeated or Alternatives, there is no single place a
+	// variable could get bound at.
+	bool m_no_variables;
+
+	inline index_t pc() const {
+		return m_automaton.m_program.size();
+	}
+
+	inline index_t emit(Opcode opcode, index_t x = 0, index_t y = 0) {
+		m_automaton.m_program.push_back(Instruction{opcode, x, y});
+		return pc() - 1;
+	}
+
+	inline index_t add_set(const CharacterSet &set, const CharacterSet &folded) {
+		m_automaton.m_sets.push_back(set);
+		m_automaton.m_folded_sets.push_back(folded);
+		return m_automaton.m_sets.size() - 1;
+	}
+
+	inline index_t add_set(const CharacterSet &set) {
+		return add_set(set, set);
+	}
+
+	static optional<CharacterSet> character_class(SymbolName name) {
+		switch (name) {
+			case S::DigitCharacter:
+				return ::character_class([] (int c) {
+					return u_isdigit(c);
+				});
+			case S::Whitespace:
+			case S::WhitespaceCharacter:
+				return ::character_class([] (int c) {
+					return u_isWhitespace(c);
+				});
+			case S::WordCharacter:
+				return ::character_class([] (int c) {
+					return u_isalnum(c);
+				});
+			case S::LetterCharacter:
+				return ::character_class([] (int c) {
+					return u_isalpha(c);
+				});
+			case S::HexidecimalCharacter:
+				return ::character_class([] (int c) {
+					return u_isxdigit(c);
+				});
+			default:
+				return optional<CharacterSet>();
+		}
+	}
+
+	// if item always matches a fixed number of characters, one from each set
+	// in sets (and nothing else), adds these sets and returns true.
+	static bool character_sets(
+		const BaseExpressionRef &item,
+		std::vector<CharacterSet> &sets) {
+
+		switch (item->type()) {
+			case StringType: {
+				const std::string s = item->as_string()->utf8();
+				for (const char c : s) {
+					if (c & 0x80) {
+						return false;
+					}
+					CharacterSet set;
+					set.set(tolower(c));
+					set.set(toupper(c));
+					sets.push_back(set);
+				}
+				return true;
+			}
+
+			case SymbolType: {
+				const auto set = character_class(item->symbol());
+				if (set && item->symbol() != S::Whitespace) {
+					sets.push_back(*set);
+					return true;
+				}
+				return false;
+			}
+
+			case ExpressionType:
+				break;
+
+			default:
+				return false;
+		}
+
+		const Expression * const expr = item->as_expression();
+
+		switch (expr->head()->symbol()) {
+			case S::Blank:
+				if (expr->size() == 0) {
+					sets.push_back(CharacterSet().set());
+					return true;
+				}
+				return false;
+
+			case S::StringExpression:
+				return expr->with_slice([&sets] (const auto &slice) {
+					const size_t n = slice.size();
+					for (size_t i = 0; i < n; i++) {
+						if (!character_sets(slice[i], sets)) {
+							return false;
+						}
+					}
+					return true;
+				});
+
+			case S::Alternatives: {
+				const size_t n = expr->size();
+				const size_t offset = sets.size();
+				for (size_t i = 0; i < n; i++) {
+					std::vector<CharacterSet> alternative;
+					if (!character_sets(expr->leaf(i), alternative)) {
+						return false;
+					}
+					if (i == 0) {
+						sets.insert(sets.end(), alternative.begin(), alternative.end());
+					} else if (alternative.size() != sets.size() - offset) {
+						return false;
+					} else {
+						for (size_t j = 0; j < alternative.size(); j++) {
+							sets[offset + j] |= alternative[j];
+						}
+					}
+				}
+				return n > 0;
+			}
+
+			case S::Shortest:
+			case S::Longest:
+			case S::HoldPattern:
+				return expr->size() == 1 && character_sets(expr->leaf(0), sets);
+
+			default:
+				return false;
+		}
+	}
+
+	// AlternativesMatcher does not backtrack into its alternatives once one
+	// of them matched. we only translate Alternatives where this does not
+	// matter, i.e. where from any position at most one end is possible: all
+	// alternatives have a fixed size, and a shorter one never matches where
+	// a longer one does.
+	static bool unambiguous_alternatives(const Expression *alternatives) {
+		const size_t n = alternatives->size();
+
+		std::vector<std::vector<CharacterSet>> sets(n);
+		for (size_t i = 0; i < n; i++) {
+			if (!character_sets(alternatives->leaf(i), sets[i])) {
+				return false;
+			}
+		}
+
+		for (size_t i = 0; i < n; i++) {
+			for (size_t j = 0; j < n; j++) {
+				const auto &u = sets[i];
+				const auto &v = sets[j];
+
+				if (u.size() >= v.size()) {
+					continue;
+				}
+
+				bool overlap = true;
+				for (size_t k = 0; k < u.size(); k++) {
+					if ((u[k] & v[k]).none()) {
+						overlap = false;
+						break;
+					}
+				}
+				if (overlap) {
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	template<typename Body>
+	bool compile_loop(
+		const Body &body,
+		index_t minimum,
+		bool shortest) {
+
+		// x+ is x followed by x*, and x* is
+		// L: Split(B, E) B: x, Jump(L) E:
+
+		if (minimum > 0 && !body()) {
+			return false;
+		}
+
+		const index_t loop = emit(Split);
+		if (!body()) {
+			return false;
+		}
+		emit(Jump, loop);
+
+		Instruction &split = m_automaton.m_program[loop];
+		if (shortest) {
+			split.x = pc();
+			split.y = loop + 1;
+		} else {
+			split.x = loop + 1;
+			split.y = pc();
+		}
+
+		return true;
+	}
+
+	bool compile_repeated(const Expression *expr, index_t minimum, bool shortest) {
+		if (expr->size() != 1) {
+			return false; // we don't handle the {min, max} form
+		}
+
+		const BaseExpressionRef item = expr->leaf(0);
+
+		// the matcher takes repetitions of a fixed size element one by one
+		// (see SimpleGreedy), which is what a loop does. Shortest only
+		// does so for elements of size 1 though.
+		std::vector<CharacterSet> sets;
+		if (!character_sets(item, sets) || sets.empty() || (shortest && sets.size() != 1)) {
+			return false;
+		}
+
+		const bool no_variables = m_no_variables;
+		m_no_variables = true;
+		const bool ok = compile_loop([this, &item, shortest] () {
+			return compile(item, shortest);
+		}, minimum, shortest);
+		m_no_variables = no_variables;
+		return ok;
+	}
+
+	bool compile_alternatives(const Expression *expr, bool shortest) {
+		const size_t n = expr->size();
+		if (n == 0 || !unambiguous_alternatives(expr)) {
+			return false;
+		}
+
+		const bool no_variables = m_no_variables;
+		m_no_variables = true;
+
+		std::vector<index_t> jumps;
+		for (size_t i = 0; i < n; i++) {
+			index_t split = -1;
+			if (i + 1 < n) {
+				split = emit(Split, pc() + 1);
+			}
+			if (!compile(expr->leaf(i), shortest)) {
+				m_no_variables = no_variables;
+				return false;
+			}
+			if (i + 1 < n) {
+				jumps.push_back(emit(Jump));
+				m_automaton.m_program[split].y = pc();
+			}
+		}
+
+		for (const index_t jump : jumps) {
+			m_automaton.m_program[jump].x = pc();
+		}
+
+		m_no_variables = no_variables;
+		return true;
+	}
+
+	bool compile_pattern(const Expression *expr, bool shortest) {
+		if (expr->size() != 2 || m_no_variables) {
+			return false;
+		}
+
+		const BaseExpressionRef &variable = expr->leaf(0);
+		const BaseExpressionRef &item = expr->leaf(1);
+
+		if (!variable->is_symbol()) {
+			return false;
+		}
+
+		// we only bind variables to single elements that bind to the slice of
+		// the string they matched (literal strings bind to the pattern).
+		switch (item->type()) {
+			case SymbolType:
+				if (!character_class(item->symbol())) {
+					return false;
+				}
+				break;
+
+			case ExpressionType:
+				switch (item->as_expression()->head()->symbol()) {
+					case S::Blank:
+					case S::BlankSequence:
+					case S::BlankNullSequence:
+						break;
+					default:
+						return false;
+				}
+				break;
+
+			default:
+				return false;
+		}
+
+		auto &variables = m_automaton.m_variables;
+		for (const SymbolRef &symbol : variables) {
+			if (symbol.get() == variable.get()) {
+				return false; // a back reference
+			}
+		}
+		const index_t k = variables.size();
+		variables.push_back(SymbolRef(variable->as_symbol()));
+
+		emit(Save, 2 * k + 2);
+		if (!compile_element(item, shortest)) {
+			return false;
+		}
+		emit(Save, 2 * k + 3);
+
+		return true;
+	}
+
+	bool compile_element(const BaseExpressionRef &item, bool shortest) {
+		switch (item->type()) {
+			case StringType: {
+				std::vector<CharacterSet> folded;
+				if (!character_sets(item, folded)) {
+					return false;
+				}
+				const std::string s = item->as_string()->utf8();
+				for (size_t i = 0; i < s.size(); i++) {
+					CharacterSet set;
+					set.set(s[i]);
+					emit(Character, add_set(set, folded[i]));
+				}
+				return true;
+			}
+
+			case SymbolType:
+				switch (item->symbol()) {
+					case S::StartOfLine:
+						emit(Assert, AtStartOfLine);
+						return true;
+
+					case S::EndOfLine:
+						emit(Assert, AtEndOfLine);
+						return true;
+
+					case S::WordBoundary:
+						emit(Assert, AtWordBoundary);
+						return true;
+
+					case S::Whitespace: {
+						// the matcher takes as much whitespace as there is
+						// without backtracking (see MatchCharacterBlankSequence).
+						const index_t set = add_set(*character_class(S::Whitespace));
+						const index_t loop = emit(Character, set);
+						emit(Split, loop, loop + 2);
+						emit(AssertNotNext, set);
+						return true;
+					}
+
+					default: {
+						const auto set = character_class(item->symbol());
+						if (!set) {
+							return false;
+						}
+						emit(Character, add_set(*set));
+						return true;
+					}
+				}
+
+			case ExpressionType:
+				break;
+
+			default:
+				return false;
+		}
+
+		const Expression * const expr = item->as_expression();
+
+		switch (expr->head()->symbol()) {
+			case S::Blank:
+				if (expr->size() == 0) {
+					emit(Character, add_set(CharacterSet().set()));
+					return true;
+				}
+				return false;
+
+			case S::BlankSequence:
+			case S::BlankNullSequence:
+				if (expr->size() == 0) {
+					const index_t any = add_set(CharacterSet().set());
+					return compile_loop([this, any] () {
+						emit(Character, any);
+						return true;
+					}, expr->head()->symbol() == S::BlankSequence ? 1 : 0, shortest);
+				}
+				return false;
+
+			case S::Repeated:
+				return compile_repeated(expr, 1, shortest);
+
+			case S::RepeatedNull:
+				return compile_repeated(expr, 0, shortest);
+
+			case S::Alternatives:
+				return compile_alternatives(expr, shortest);
+
+			case S::Shortest:
+				return expr->size() == 1 && compile(expr->leaf(0), true);
+
+			case S::Longest:
+				return expr->size() == 1 && compile(expr->leaf(0), false);
+
+			case S::HoldPattern:
+				return expr->size() == 1 && compile(expr->leaf(0), shortest);
+
+			case S::Pattern:
+				return compile_pattern(expr, shortest);
+
+			default:
+				return false;
+		}
+	}
+
+	// compiles a chain of elements like PatternCompiler::compile_ordered.
+	bool compile_chain(const BaseExpressionRef *begin, const BaseExpressionRef *end, bool shortest) {
+		std::vector<index_t> starts;
+
+		for (const BaseExpressionRef *item = begin; item != end; item++) {
+			const SymbolName name = (*item)->symbol();
+
+			if (name == S::StartOfString) {
+				starts.push_back(emit(Start, pc() + 1));
+			} else if (name == S::EndOfString) {
+				// EndMatcher ends its chain, ignoring whatever follows.
+				emit(Assert, AtEndOfString);
+				break;
+			} else if (!compile_element(*item, shortest)) {
+				return false;
+			}
+		}
+
+		// StartMatcher on an empty string ends its chain, too.
+		for (const index_t start : starts) {
+			m_automaton.m_program[start].y = pc();
+		}
+
+		return true;
+	}
+
+public:
+	inline Compiler(StringAutomaton &automaton) : m_automaton(automaton), m_no_variables(false) {
+	}
+
+	bool compile(const BaseExpressionRef &patt, bool shortest) {
+		if (patt->is_expression() && patt->as_expression()->head()->symbol() == S::StringExpression) {
+			return patt->as_expression()->with_leaves_array(
+				[this, shortest] (const BaseExpressionRef *leaves, size_t n) {
+					return compile_chain(leaves, leaves + n, shortest);
+				});
+		} else {
+			return compile_chain(&patt, &patt + 1, shortest);
+		}
+	}
+};
+
+std::shared_ptr<const StringAutomaton> StringAutomaton::compile(const BaseExpressionRef &patt) {
+	const auto automaton = std::make_shared<StringAutomaton>();
+	Compiler compiler(*automaton);
+	if (!compiler.compile(patt, false)) {
+		return std::shared_ptr<const StringAutomaton>();
+	}
+	automaton->m_program.push_back(Instruction{Accept, 0, 0});
+
+	std::string literal;
+	for (const Instruction &instruction : automaton->m_program) {
+		if (instruction.opcode == Accept) {
+			automaton->m_literal = literal;
+			break;
+		}
+		if (instruction.opcode != Character) {
+			break;
+		}
+		const CharacterSet &set = automaton->m_sets[instruction.x];
+		if (set.count() != 1) {
+			break;
+		}
+		for (int c = 0; c < 128; c++) {
+			if (set.test(c)) {
+				literal.push_back(char(c));
+				break;
+			}
+		}
+	}
+
+	return automaton;
+}
+
+index_t StringAutomaton::find_literal(
+	const char *text,
+	index_t begin,
+	index_t end,
+	bool search,
+	bool anchored,
+	index_t &match_begin) const {
+
+	const index_t n = m_literal.size();
+	const char first = m_literal[0];
+
+	for (index_t i = begin; i + n <= end; i++) {
+		if (search) {
+			const void * const p = std::memchr(text + i, first, end - n + 1 - i);
+			if (!p) {
+				break;
+			}
+			i = static_cast<const char*>(p) - text;
+		}
+
+		if (std::memcmp(text + i, m_literal.data(), n) == 0 && (!anchored || i + n == end)) {
+			match_begin = i;
+			return i + n;
+		}
+
+		if (!search) {
+			break;
+		}
+	}
+
+	return -1;
+}
+
+// the threads for one position of the string, in order of priority. each
+// thread has its own captures; capture 0 is where its match began.
+
+class StringAutomaton::Run {
+private:
+	const StringAutomaton &m_automaton;
+	const std::vector<CharacterSet> &m_sets;
+	const char * const m_text;
+	const index_t m_length;
+	const index_t m_end;
+	const size_t m_n_captures;
+
+	std::vector<size_t> m_marks;
+	size_t m_generation;
+
+public:
+	class Threads {
+	public:
+		std::vector<index_t> pcs;
+		std::vector<index_t> captures;
+
+		inline void clear() {
+			pcs.clear();
+			captures.clear();
+		}
+
+		inline bool empty() const {
+			return pcs.empty();
+		}
+	};
+
+private:
+	bool holds(Assertion assertion, index_t i) const {
+		switch (assertion) {
+			case AtEndOfString:
+				return i == m_end;
+
+			case AtStartOfLine:
+				return i == 0 || is_ascii_newline(m_text[i - 1]);
+
+			case AtEndOfLine: // see EndOfLine in matcher.cpp
+				return i >= m_end - 1 || is_ascii_newline(m_text[i + 1]);
+
+			case AtWordBoundary: // see AsciiStringExtent::is_word_boundary
+				if (i == 0) {
+					return is_ascii_word(m_text, m_length, 0);
+				} else if (i == m_length) {
+					return is_ascii_word(m_text, m_length, i - 1);
+				} else if (i < m_length) {
+					return is_ascii_word(m_text, m_length, i) != is_ascii_word(m_text, m_length, i - 1);
+				} else {
+					return false;
+				}
+
+			default:
+				return false;
+		}
+	}
+
+	inline bool in_set(index_t set, index_t i) const {
+		const unsigned char c = m_text[i];
+		return c < 128 && m_sets[set][c];
+	}
+
+public:
+	Run(const StringAutomaton &automaton,
+		const std::vector<CharacterSet> &sets,
+		const char *text,
+		index_t length,
+		index_t end) :
+
+		m_automaton(automaton),
+		m_sets(sets),
+		m_text(text),
+		m_length(length),
+		m_end(end),
+		m_n_captures(2 * automaton.m_variables.size() + 2),
+		m_marks(automaton.m_program.size(), 0),
+		m_generation(0) {
+	}
+
+	inline size_t n_captures() const {
+		return m_n_captures;
+	}
+
+	inline void next_generation() {
+		m_generation++;
+	}
+
+	// follows pc through all instructions that do not consume a character
+	// and adds the threads that arrive at one.
+	void add(Threads &threads, index_t pc, index_t i, index_t *captures) {
+		if (m_marks[pc] == m_generation) {
+			return;
+		}
+		m_marks[pc] = m_generation;
+
+		const Instruction &instruction = m_automaton.m_program[pc];
+
+		switch (instruction.opcode) {
+			case Jump:
+				add(threads, instruction.x, i, captures);
+				break;
+
+			case Split:
+				add(threads, instruction.x, i, captures);
+				add(threads, instruction.y, i, captures);
+				break;
+
+			case Save: {
+				const index_t saved = captures[instruction.x];
+				captures[instruction.x] = i;
+				add(threads, pc + 1, i, captures);
+				captures[instruction.x] = saved;
+				break;
+			}
+
+			case Assert:
+				if (holds(Assertion(instruction.x), i)) {
+					add(threads, pc + 1, i, captures);
+				}
+				break;
+
+			case AssertNotNext:
+				if (i >= m_end || !in_set(instruction.x, i)) {
+					add(threads, pc + 1, i, captures);
+				}
+				break;
+
+			case Start:
+				if (i == 0) {
+					add(threads, m_end == 0 ? instruction.y : instruction.x, i, captures);
+				}
+				break;
+
+			default:
+				threads.pcs.push_back(pc);
+				threads.captures.insert(threads.captures.end(), captures, captures + m_n_captures);
+				break;
+		}
+	}
+
+	inline bool step(index_t pc, index_t i) const {
+		const Instruction &instruction = m_automaton.m_program[pc];
+		return instruction.opcode == Character && i < m_end && in_set(instruction.x, i);
+	}
+
+	inline bool accepts(index_t pc) const {
+		return m_automaton.m_program[pc].opcode == Accept;
+	}
+};
+
+index_t StringAutomaton::run(
+	MatchContext &context,
+	const String *string,
+	index_t begin,
+	index_t end,
+	bool search,
+	index_t &match_begin) const {
+
+	assert(string->extent_type() == StringExtent::ascii);
+
+	const char * const text = static_cast<const AsciiStringExtent*>(
+		string->extent())->data() + string->to_extent_offset(0);
+
+	const bool anchored = !(context.options & MatchContext::NoEndAnchor);
+
+	if (!m_literal.empty() && !(context.options & MatchContext::IgnoreCase)) {
+		return find_literal(text, begin, end, search, anchored, match_begin);
+	}
+
+	Run run(
+		*this,
+		(context.options & MatchContext::IgnoreCase) ? m_folded_sets : m_sets,
+		text,
+		string->length(),
+		end);
+
+	const size_t n_captures = run.n_captures();
+
+	Run::Threads current;
+	Run::Threads next;
+	std::vector<index_t> captures(n_captures);
+	std::vector<index_t> matched;
+	index_t match_end = -1;
+
+	run.next_generation();
+
+	for (index_t i = begin; ; i++) {
+		// the matcher tries a start at i only after all earlier starts
+		// failed, so the new thread comes last.
+		if (match_end < 0 && (i == begin || (search && i < end))) {
+			std::fill(captures.begin(), captures.end(), -1);
+			captures[0] = i;
+			run.add(current, 0, i, captures.data());
+		}
+
+		if (current.empty() && (match_end >= 0 || !search || i >= end)) {
+			break;
+		}
+
+		run.next_generation();
+		next.clear();
+
+		const size_t n = current.pcs.size();
+		for (size_t t = 0; t < n; t++) {
+			const index_t pc = current.pcs[t];
+			index_t * const thread_captures = &current.captures[t * n_captures];
+
+			if (run.accepts(pc)) {
+				if (!anchored || i == end) {
+					// all threads after this one have a lower priority.
+					match_end = i;
+					matched.assign(thread_captures, thread_captures + n_captures);
+					break;
+				}
+			} else if (run.step(pc, i)) {
+				run.add(next, pc + 1, i + 1, thread_captures);
+			}
+		}
+
+		std::swap(current, next);
+
+		if (i >= end) {
+			break;
+		}
+	}
+
+	if (match_end < 0) {
+		return -1;
+	}
+
+	match_begin = matched[0];
+
+	const size_t n_variables = m_variables.size();
+	for (size_t k = 0; k < n_variables; k++) {
+		const index_t from = matched[2 * k + 2];
+		const index_t to = matched[2 * k + 3];
+		if (from < 0 || to < 0) {
+			continue;
+		}
+
+		const index_t slot_index = context.match->slot_index(m_variables[k].get());
+		if (slot_index < 0) {
+			continue;
+		}
+
+		bool is_owner;
+		context.match->assign(
+			slot_index,
+			String::construct(
+				StringExtentRef(string->extent()),
+				string->to_extent_offset(from),
+				to - from),
+			is_owner);
+	}
+
+	return match_end;
+}
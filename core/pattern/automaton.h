@@ -0,0 +1,98 @@
+#pragma once
+
+#include <bitset>
+#include <memory>
+#include <string>
+#include <vector>
+
+// StringAutomaton is a translation of a string pattern into a program for a
+// Pike VM (see https://swtch.com/~rsc/regexp/regexp2.html), which runs over
+// ASCII strings in one pass and in time linear in the length of the string,
+// instead of backtracking through the PatternMatcher tree.
+
+// the VM keeps its threads in priority order, so it finds exactly the match
+// (and bindings) that the backtracking matcher would find first. where the
+// matcher does not backtrack (e.g. into Alternatives or Whitespace), the
+// translation only accepts patterns for which this makes no difference, and
+// compile() returns an empty reference for everything else, e.g. patterns
+// with Condition, PatternTest, Except or a variable that occurs twice.
+
+class StringAutomaton {
+public:
+	typedef std::bitset<128> CharacterSet;
+
+	enum Opcode {
+		Character, // consume a character in set x
+		Split, // continue at x, then (with lower priority) at y
+		Jump, // continue at x
+		Save, // store the current position in capture x
+		Assert, // continue only if assertion x holds
+		AssertNotNext, // continue only if the next character is not in set x
+		Start, // StartOfString: continue at x, or at y if the string is empty
+		Accept
+	};
+
+	enum Assertion {
+		AtEndOfString,
+		AtStartOfLine,
+		AtEndOfLine,
+		AtWordBoundary
+	};
+
+	struct Instruction {
+		Opcode opcode;
+		index_t x;
+		index_t y;
+	};
+
+private:
+	class Compiler;
+	class Run;
+
+	std::vector<Instruction> m_program;
+	std::vector<CharacterSet> m_sets;
+	std::vector<CharacterSet> m_folded_sets; // for IgnoreCase
+	std::vector<SymbolRef> m_variables; // bound through captures 2k + 2, 2k + 3
+	std::string m_literal; // if the pattern is just a string, e.g. "\n"
+
+	index_t find_literal(
+		const char *text,
+		index_t begin,
+		index_t end,
+		bool search,
+		bool anchored,
+		index_t &match_begin) const;
+
+	index_t run(
+		MatchContext &context,
+		const String *string,
+		index_t begin,
+		index_t end,
+		bool search,
+		index_t &match_begin) const;
+
+public:
+	static std::shared_ptr<const StringAutomaton> compile(const BaseExpressionRef &patt);
+
+	// like PatternMatcher::match for an ASCII string.
+	inline index_t match(
+		MatchContext &context,
+		const String *string,
+		index_t begin,
+		index_t end) const {
+
+		index_t match_begin;
+		return run(context, string, begin, end, false, match_begin);
+	}
+
+	// like PatternMatcher::search for an ASCII string.
+	inline index_t search(
+		MatchContext &context,
+		const String *string,
+		index_t begin,
+		index_t end,
+		index_t &match_begin) const {
+
+		return run(context, string, begin, end, true, match_begin);
+	}
+};
@@ -17,10 +17,16 @@ typedef UnsafeSharedPtr<PatternMatcher> UnsafePatternMatcherRef;
 
 class OptionsProcessor;
 
+class SequenceMemo;
+
 using OptionsProcessorRef = ConstSharedPtr<OptionsProcessor>;
 using UnsafeOptionsProcessorRef = UnsafeSharedPtr<OptionsProcessor>;
 
 class MatchContext {
+private:
+    std::unique_ptr<SequenceMemo> m_memo;
+    size_t m_steps;
+
 public:
     enum {
         NoEndAnchor = 1,
@@ -49,4 +55,14 @@ public:
         MatchOptions options_ = 0);
 
     inline void reset();
+
+    // calls f() to match the rest of a pattern from node at begin, unless
+    // that has failed before in the same state (see SequenceMemo).
+    template<typename Sequence, typename F>
+    inline index_t memoized(
+        const PatternMatcher *node,
+        const Sequence &sequence,
+        index_t begin,
+        index_t end,
+        const F &f);
 };
@@ -1,10 +1,13 @@
 #pragma once
 
+#include "memo.h"
+
 inline MatchContext::MatchContext(
     const PatternMatcherRef &matcher,
     const Evaluation &evaluation_,
     MatchOptions options_) :
 
+    m_steps(0),
     evaluation(evaluation_),
     match(Match::construct(matcher)),
     options(options_) {
@@ -25,6 +28,7 @@ inline MatchContext::MatchContext(
     const Evaluation &evaluation_,
     MatchOptions options_) :
 
+    m_steps(0),
     evaluation(evaluation_),
     match(Match::construct(matcher, options_processor)),
     options(options_) {
@@ -32,4 +36,43 @@ inline MatchContext::MatchContext(
 
 inline void MatchContext::reset() {
     match->reset();
+    m_memo.reset();
+    m_steps = 0;
+}
+
+template<typename Sequence, typename F>
+inline index_t MatchContext::memoized(
+    const PatternMatcher *node,
+    const Sequence &sequence,
+    index_t begin,
+    index_t end,
+    const F &f) {
+
+    // sequences of length 1 might live on the stack (e.g. a head we match),
+    // so their identity is not stable over the course of one match.
+    if (!node->memoizable() || end - begin < 2 ||
+        ++m_steps < SequenceMemo::MemoAfterSteps) {
+        return f();
+    }
+
+    const auto subject = sequence.identity();
+    if (!std::get<0>(subject)) {
+        return f();
+    }
+
+    if (!m_memo) {
+        m_memo = std::make_unique<SequenceMemo>();
+    }
+
+    SequenceMemo::State state(
+        node, subject, begin, end, m_memo->slots(node, *match), *match);
+    if (m_memo->failed(state)) {
+        return -1;
+    }
+
+    const index_t result = f();
+    if (result < 0) {
+        m_memo->add(std::move(state));
+    }
+    return result;
 }
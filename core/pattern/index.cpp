@@ -0,0 +1,204 @@
+#include "core/types.h"
+#include "core/expression/implementation.h"
+#include "index.h"
+
+namespace {
+
+enum class LeafKind {
+	Head, // matches exactly one leaf with a specific head
+	Any, // matches exactly one leaf with any head
+	Stop // might match any number of leaves
+};
+
+LeafKind leaf_kind(
+	BaseExpressionPtr pattern,
+	const Symbols &symbols,
+	BaseExpressionPtr &head) {
+
+	if (!pattern->is_expression()) {
+		head = pattern->head(symbols);
+		return LeafKind::Head;
+	}
+
+	const Expression * const expr = pattern->as_expression();
+
+	switch (expr->head()->symbol()) {
+		case S::Blank:
+			if (expr->size() == 1) {
+				const BaseExpressionPtr h = expr->n_leaves<1>()[0].get();
+				if (h->is_symbol()) {
+					head = h;
+					return LeafKind::Head;
+				}
+			}
+			return LeafKind::Any;
+
+		case S::Pattern:
+			if (expr->size() != 2) {
+				return LeafKind::Stop;
+			}
+			return leaf_kind(expr->n_leaves<2>()[1].get(), symbols, head);
+
+		case S::PatternTest:
+		case S::Condition:
+			if (expr->size() != 2) {
+				return LeafKind::Stop;
+			}
+			return leaf_kind(expr->n_leaves<2>()[0].get(), symbols, head);
+
+		case S::BlankSequence:
+		case S::BlankNullSequence:
+		case S::Alternatives:
+		case S::Repeated:
+		case S::RepeatedNull:
+		case S::Except:
+		case S::Optional:
+		case S::OptionsPattern:
+		case S::Longest:
+		case S::Shortest:
+		case S::HoldPattern:
+		case S::Verbatim:
+		case S::Sequence:
+			return LeafKind::Stop;
+
+		default:
+			break;
+	}
+
+	// note that x_^n_. also matches x, i.e. something that is not a Power.
+	if (!expr->head()->is_symbol() || has_optional(pattern)) {
+		return LeafKind::Any;
+	}
+
+	head = expr->head();
+	return LeafKind::Head;
+}
+
+// keeps indices sorted, which is a push_back if index is the largest one.
+inline void add_sorted(std::vector<size_t> &indices, size_t index) {
+	indices.insert(std::upper_bound(indices.begin(), indices.end(), index), index);
+}
+
+} // namespace
+
+bool has_optional(BaseExpressionPtr item) {
+	if (!item->is_expression()) {
+		return false;
+	}
+
+	const Expression * const expr = item->as_expression();
+
+	if (expr->head()->symbol() == S::Optional || has_optional(expr->head())) {
+		return true;
+	}
+
+	if (is_packed_slice(expr->slice_code())) {
+		return false;
+	}
+
+	return expr->with_slice([] (const auto &slice) {
+		for (auto leaf : slice) {
+			if (has_optional(leaf.get())) {
+				return true;
+			}
+		}
+		return false;
+	});
+}
+
+size_t RulesIndex::child(size_t node, BaseExpressionPtr head) {
+	if (!head) {
+		if (!m_nodes[node].any) {
+			m_nodes[node].any = m_nodes.size();
+			m_nodes.emplace_back();
+		}
+		return m_nodes[node].any;
+	}
+
+	const auto i = m_nodes[node].children.find(head);
+	if (i != m_nodes[node].children.end()) {
+		return i->second;
+	}
+
+	const size_t index = m_nodes.size();
+	m_nodes[node].children[head] = index;
+	m_nodes.emplace_back();
+	return index;
+}
+
+void RulesIndex::clear() {
+	m_nodes.clear();
+	m_nodes.emplace_back();
+}
+
+void RulesIndex::add(
+	const BaseExpressionRef &pattern,
+	size_t index,
+	const Symbols &symbols) {
+
+	BaseExpressionPtr lhs = pattern.get();
+
+	while (lhs->is_expression()) {
+		const Expression * const expr = lhs->as_expression();
+		if (expr->head()->symbol() == S::Condition && expr->size() == 2) {
+			lhs = expr->n_leaves<2>()[0].get();
+		} else if (expr->head()->symbol() == S::HoldPattern && expr->size() == 1) {
+			lhs = expr->n_leaves<1>()[0].get();
+		} else {
+			break;
+		}
+	}
+
+	if (!lhs->is_expression()) {
+		add_sorted(m_nodes[0].stop, index);
+		return;
+	}
+
+	const Expression * const expr = lhs->as_expression();
+
+	if (is_packed_slice(expr->slice_code())) {
+		add_sorted(m_nodes[0].stop, index);
+		return;
+	}
+
+	expr->with_slice([this, index, &symbols] (const auto &slice) {
+		size_t node = 0;
+
+		for (auto leaf : slice) {
+			BaseExpressionPtr head = nullptr;
+
+			switch (leaf_kind(leaf.get(), symbols, head)) {
+				case LeafKind::Stop:
+					add_sorted(m_nodes[node].stop, index);
+					return;
+				case LeafKind::Any:
+					node = child(node, nullptr);
+					break;
+				case LeafKind::Head:
+					node = child(node, head);
+					break;
+			}
+		}
+
+		add_sorted(m_nodes[node].end, index);
+	});
+}
+
+void RulesIndex::insert(
+	const BaseExpressionRef &pattern,
+	size_t index,
+	const Symbols &symbols) {
+
+	const auto shift = [index] (std::vector<size_t> &indices) {
+		for (auto i = std::lower_bound(indices.begin(), indices.end(), index); i != indices.end(); i++) {
+			(*i)++;
+		}
+	};
+
+	for (Node &node : m_nodes) {
+		shift(node.stop);
+		shift(node.end);
+	}
+
+	add(pattern, index, symbols);
+}
@@ -0,0 +1,251 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// true if item contains an Optional anywhere, e.g. x_^n_. (which also
+// matches x, i.e. something that is not a Power).
+bool has_optional(BaseExpressionPtr item);
+
+// RulesIndex is a discrimination net over the leaves of the patterns of a set
+// of rules. each pattern is turned into a path that, for each leaf, requires a
+// specific head (e.g. for x_Integer or g[x_]) or allows any head (e.g. for x_).
+// the path ends at the first leaf that might match more or less than exactly
+// one leaf (e.g. x__ or x_.), as the positions of all further leaves are then
+// unknown.
+
+// for an expression, candidates() gives the indices of all rules that might
+// match it, in ascending order, i.e. in the order of the indexed rules.
+
+class RulesIndex {
+private:
+	struct Node {
+		std::unordered_map<BaseExpressionPtr, size_t> children;
+		size_t any; // child for leaves with any head, 0 if none
+
+		std::vector<size_t> stop; // rules that accept any remaining leaves
+		std::vector<size_t> end; // rules that end with this leaf
+
+		inline Node() : any(0) {
+		}
+	};
+
+	std::vector<Node> m_nodes;
+
+	size_t child(size_t node, BaseExpressionPtr head);
+
+	template<typename Token>
+	void collect(
+		size_t node,
+		size_t i,
+		size_t n,
+		const Token &token,
+		std::vector<size_t> &result) const;
+
+public:
+	inline RulesIndex() : m_nodes(1) {
+	}
+
+	void clear();
+
+	inline bool empty() const {
+		return m_nodes.size() == 1 &&
+			m_nodes[0].stop.empty() &&
+			m_nodes[0].end.empty();
+	}
+
+	// adds the rule with the given index. this is cheapest for ascending
+	// values of index, as when building the index from a sorted vector.
+	void add(
+		const BaseExpressionRef &pattern,
+		size_t index,
+		const Symbols &symbols);
+
+	// adds a rule that got inserted at index into the indexed vector, i.e.
+	// moves all rules at index and after up by one. this only touches the
+	// stored indices, not the patterns of the other rules.
+	void insert(
+		const BaseExpressionRef &pattern,
+		size_t index,
+		const Symbols &symbols);
+
+	// token(i) gives the head of leaf i (a Symbol), or nullptr if it has a
+	// head that is not a Symbol.
+	template<typename Token>
+	inline void candidates(
+		size_t n,
+		const Token &token,
+		std::vector<size_t> &result) const {
+
+		collect(0, 0, n, token, result);
+		std::sort(result.begin(), result.end());
+	}
+};
+
+template<typename Token>
+void RulesIndex::collect(
+	size_t index,
+	size_t i,
+	size_t n,
+	const Token &token,
+	std::vector<size_t> &result) const {
+
+	const Node &node = m_nodes[index];
+
+	result.insert(result.end(), node.stop.begin(), node.stop.end());
+
+	if (i == n) {
+		result.insert(result.end(), node.end.begin(), node.end.end());
+		return;
+	}
+
+	if (!node.children.empty()) {
+		const auto child = node.children.find(token(i));
+		if (child != node.children.end()) {
+			collect(child->second, i + 1, n, token, result);
+		}
+	}
+
+	if (node.any) {
+		collect(node.any, i + 1, n, token, result);
+	}
+}
+
+// RulesIndexCache is a small polymorphic inline cache for the candidates
+// RulesIndex gives for expressions with tiny slices. as the candidates only
+// depend on the number of leaves and their heads, these form the key.
+
+// entries only ever get invalid when the RulesIndex changes, i.e. when a rule
+// is added, which is also when Definitions::update_version() is called. we
+// clear the cache right there instead of checking the Version for each lookup.
+
+class RulesIndexCache {
+public:
+	static constexpr size_t Size = 4;
+
+	// shared between the cache and its callers, so that a hit neither copies
+	// the candidates nor holds the lock while they are being tried.
+	typedef std::shared_ptr<const std::vector<size_t>> Candidates;
+
+private:
+	struct Entry {
+		bool valid;
+		SliceCode code;
+		TypeMask type_mask;
+		BaseExpressionPtr heads[MaxTinySliceSize];
+		Candidates candidates;
+
+		inline Entry() : valid(false) {
+		}
+
+		inline bool matches(
+			SliceCode code_,
+			TypeMask type_mask_,
+			const BaseExpressionPtr *heads_) const {
+
+			if (!valid || code != code_ || type_mask != type_mask_) {
+				return false;
+			}
+			const size_t n = tiny_slice_size(code);
+			for (size_t i = 0; i < n; i++) {
+				if (heads[i] != heads_[i]) {
+					return false;
+				}
+			}
+			return true;
+		}
+	};
+
+	// lookups do not wait for the lock, but simply bypass the cache.
+	mutable std::atomic_flag m_lock = ATOMIC_FLAG_INIT;
+	mutable Entry m_entries[Size];
+	mutable size_t m_next;
+
+	mutable std::atomic<size_t> m_hits;
+	mutable std::atomic<size_t> m_misses;
+
+public:
+	inline RulesIndexCache() : m_next(0), m_hits(0), m_misses(0) {
+	}
+
+	inline RulesIndexCache(const RulesIndexCache&) : RulesIndexCache() {
+	}
+
+	inline RulesIndexCache &operator=(const RulesIndexCache&) {
+		clear();
+		return *this;
+	}
+
+	// unlike lookups, clear() must not be skipped, so it waits for the lock.
+	inline void clear() {
+		while (m_lock.test_and_set(std::memory_order_acquire)) {
+			std::this_thread::yield();
+		}
+		for (Entry &entry : m_entries) {
+			entry.valid = false;
+			entry.candidates.reset();
+		}
+		m_next = 0;
+		m_lock.clear(std::memory_order_release);
+	}
+
+	// compute(result) fills in the candidates on a miss.
+	template<typename Compute>
+	Candidates candidates(
+		SliceCode code,
+		TypeMask type_mask,
+		const BaseExpressionPtr *heads,
+		const Compute &compute) const;
+
+	inline size_t hits() const {
+		return m_hits.load(std::memory_order_relaxed);
+	}
+
+	inline size_t misses() const {
+		return m_misses.load(std::memory_order_relaxed);
+	}
+};
+
+template<typename Compute>
+RulesIndexCache::Candidates RulesIndexCache::candidates(
+	SliceCode code,
+	TypeMask type_mask,
+	const BaseExpressionPtr *heads,
+	const Compute &compute) const {
+
+	if (!m_lock.test_and_set(std::memory_order_acquire)) {
+		for (const Entry &entry : m_entries) {
+			if (entry.matches(code, type_mask, heads)) {
+				Candidates result = entry.candidates;
+				m_lock.clear(std::memory_order_release);
+				m_hits.fetch_add(1, std::memory_order_relaxed);
+				return result;
+			}
+		}
+		m_lock.clear(std::memory_order_release);
+	}
+
+	m_misses.fetch_add(1, std::memory_order_relaxed);
+	const auto computed = std::make_shared<std::vector<size_t>>();
+	compute(*computed);
+	Candidates result(computed);
+
+	if (!m_lock.test_and_set(std::memory_order_acquire)) {
+		Entry &entry = m_entries[m_next];
+		m_next = (m_next + 1) % Size;
+
+		entry.valid = true;
+		entry.code = code;
+		entry.type_mask = type_mask;
+		std::copy(heads, heads + tiny_slice_size(code), entry.heads);
+		entry.candidates = result;
+
+		m_lock.clear(std::memory_order_release);
+	}
+
+	return result;
+}
@@ -0,0 +1,257 @@
+#include "core/types.h"
+#include "core/expression/implementation.h"
+#include "literals.h"
+
+#include <cstring>
+
+namespace {
+
+inline const String *ascii_string(const BaseExpressionRef &item) {
+	if (!item->is_string()) {
+		return nullptr;
+	}
+	const String * const string = item->as_string();
+	if (string->extent_type() != StringExtent::ascii) {
+		return nullptr;
+	}
+	return string;
+}
+
+} // namespace
+
+LiteralAutomaton::LiteralAutomaton(BaseExpressionPtr rules, bool ignore_case) :
+	m_ignore_case(ignore_case), m_applicable(false), m_single_first(-1) {
+
+	m_first.fill(false);
+
+	m_next.emplace_back();
+	m_next[0].fill(-1);
+	m_depth.push_back(0);
+	m_output.push_back(-1);
+	m_rule.push_back(-1);
+
+	const auto add_rule = [this] (const BaseExpressionRef &rule) {
+		if (!rule->is_expression()) {
+			return false;
+		}
+		const Expression * const expr = rule->as_expression();
+		if (expr->size() != 2) {
+			return false;
+		}
+		switch (expr->head()->symbol()) {
+			case S::Rule:
+			case S::RuleDelayed:
+				break;
+			default:
+				return false;
+		}
+
+		const auto * const leaves = expr->n_leaves<2>();
+		const String * const key = ascii_string(leaves[0]);
+		const String * const replacement = ascii_string(leaves[1]);
+		if (!key || !replacement || key->length() == 0) {
+			return false;
+		}
+
+		add(std::string(key->ascii(), key->length()), m_replacements.size());
+		m_replacements.emplace_back(replacement->ascii(), replacement->length());
+		return true;
+	};
+
+	if (rules->is_list()) {
+		const bool added = rules->as_expression()->with_slice([&add_rule] (const auto &slice) {
+			const size_t n = slice.size();
+			for (size_t i = 0; i < n; i++) {
+				if (!add_rule(slice[i])) {
+					return false;
+				}
+			}
+			return n > 0;
+		});
+		if (!added) {
+			return;
+		}
+	} else if (!add_rule(BaseExpressionRef(rules))) {
+		return;
+	}
+
+	link();
+	m_applicable = true;
+}
+
+void LiteralAutomaton::add(const std::string &key, index_t rule) {
+	int32_t state = 0;
+
+	for (const char c : key) {
+		const int folded = m_ignore_case ? tolower(c) : c;
+		assert(folded >= 0 && folded < 128);
+
+		if (m_next[state][folded] < 0) {
+			const int32_t next = int32_t(m_next.size());
+			m_next.emplace_back();
+			m_next[next].fill(-1);
+			m_depth.push_back(m_depth[state] + 1);
+			m_output.push_back(-1);
+			m_rule.push_back(-1);
+			m_next[state][folded] = next;
+		}
+
+		state = m_next[state][folded];
+	}
+
+	if (m_rule[state] < 0) { // of duplicate keys, the first rule wins.
+		m_rule[state] = int32_t(rule);
+	}
+}
+
+void LiteralAutomaton::link() {
+	// turn the trie into a DFA, i.e. fill in the failure transitions,
+	// visiting the states in breadth-first order.
+
+	std::vector<int32_t> fail(m_next.size(), 0);
+	std::vector<int32_t> queue;
+	queue.reserve(m_next.size());
+
+	for (int c = 0; c < 128; c++) {
+		const int32_t child = m_next[0][c];
+		if (child < 0) {
+			m_next[0][c] = 0;
+		} else {
+			queue.push_back(child);
+		}
+	}
+
+	for (size_t i = 0; i < queue.size(); i++) {
+		const int32_t state = queue[i];
+		m_output[state] = m_rule[state] >= 0 ? state : m_output[fail[state]];
+
+		for (int c = 0; c < 128; c++) {
+			const int32_t child = m_next[state][c];
+			if (child < 0) {
+				m_next[state][c] = m_next[fail[state]][c];
+			} else {
+				fail[child] = m_next[fail[state]][c];
+				queue.push_back(child);
+			}
+		}
+	}
+
+	if (m_ignore_case) {
+		for (auto &next : m_next) {
+			for (int c = 'A'; c <= 'Z'; c++) {
+				next[c] = next[tolower(c)];
+			}
+		}
+	}
+
+	for (int c = 0; c < 128; c++) {
+		m_first[c] = m_next[0][c] != 0;
+	}
+
+	int n_first = 0;
+	for (int c = 0; c < 128; c++) {
+		if (m_first[c]) {
+			m_single_first = c;
+			n_first++;
+		}
+	}
+	if (n_first != 1) {
+		m_single_first = -1;
+	}
+}
+
+inline index_t LiteralAutomaton::skip(const char *text, index_t i, index_t n) const {
+	// skips to the next character that some key starts with.
+
+	if (m_single_first >= 0) {
+		const void * const p = std::memchr(text + i, m_single_first, n - i);
+		return p ? static_cast<const char*>(p) - text : n;
+	} else {
+		while (i < n && !m_first[static_cast<unsigned char>(text[i])]) {
+			i++;
+		}
+		return i;
+	}
+}
+
+std::vector<LiteralAutomaton::Match> LiteralAutomaton::find(
+	const char *text, index_t n, machine_integer_t max_matches) const {
+
+	std::vector<Match> matches;
+
+	index_t i = 0;
+	int32_t state = 0;
+	Match best{-1, -1, -1};
+
+	// no match found later can begin before i + 1 - m_depth[state], so once
+	// that position has passed the best match so far, it is the leftmost one.
+
+	const auto commit = [&matches, &best, &i, &state, max_matches] () {
+		matches.push_back(best);
+		i = best.end;
+		state = 0;
+		best.begin = -1;
+		return machine_integer_t(matches.size()) < max_matches;
+	};
+
+	while (true) {
+		if (state == 0 && best.begin < 0) {
+			i = skip(text, i, n);
+		}
+
+		if (i >= n) {
+			if (best.begin >= 0 && commit()) {
+				continue;
+			}
+			break;
+		}
+
+		const unsigned char c = static_cast<unsigned char>(text[i]);
+		assert(c < 128);
+		state = m_next[state][c];
+
+		const int32_t output = m_output[state];
+		if (output >= 0) {
+			const index_t begin = i + 1 - m_depth[output];
+			const index_t rule = m_rule[output];
+			if (best.begin < 0 || begin < best.begin || (begin == best.begin && rule < best.rule)) {
+				best = Match{begin, i + 1, rule};
+			}
+		}
+
+		i++;
+
+		if (best.begin >= 0 && best.begin < i - m_depth[state]) {
+			if (!commit()) {
+				break;
+			}
+		}
+	}
+
+	return matches;
+}
+
+StringRef LiteralAutomaton::replace(const String *string, machine_integer_t max_matches) const {
+	const char * const text = string->ascii();
+	const index_t n = string->length();
+
+	const std::vector<Match> matches = find(text, n, max_matches);
+
+	index_t size = n;
+	for (const Match &match : matches) {
+		size += index_t(m_replacements[match.rule].size()) - (match.end - match.begin);
+	}
+
+	std::string result;
+	result.reserve(size);
+
+	index_t last = 0;
+	for (const Match &match : matches) {
+		result.append(text + last, match.begin - last);
+		result.append(m_replacements[match.rule]);
+		last = match.end;
+	}
+	result.append(text + last, n - last);
+
+	return String::construct(AsciiStringExtent::construct(std::move(result)));
+}
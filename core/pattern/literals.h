@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+
+// LiteralAutomaton is an Aho-Corasick automaton over the left sides of a list
+// of string rules like {"xyz" -> "A", "w" -> "BCD"}, which lets StringReplace
+// find the matches of all rules in one pass over an ASCII string, instead of
+// running one matcher per rule and merging their matches.
+
+// the automaton is cached in the Cache of the rule list. for rule lists it
+// cannot handle (e.g. patterns, non-string right sides or non-ASCII strings),
+// is_applicable() is false, so that callers fall back to StringCases.
+
+class LiteralAutomaton;
+
+typedef ConstSharedPtr<LiteralAutomaton> LiteralAutomatonRef;
+typedef QuasiConstSharedPtr<LiteralAutomaton> CachedLiteralAutomatonRef;
+typedef UnsafeSharedPtr<LiteralAutomaton> UnsafeLiteralAutomatonRef;
+
+class LiteralAutomaton : public HeapObject<LiteralAutomaton> {
+public:
+	struct Match {
+		index_t begin;
+		index_t end;
+		index_t rule;
+	};
+
+private:
+	const bool m_ignore_case;
+	bool m_applicable;
+
+	// the transitions of state s are m_next[s], with state 0 being the root.
+	std::vector<std::array<int32_t, 128>> m_next;
+	std::vector<int32_t> m_depth;
+	std::vector<int32_t> m_output; // the longest key that is a suffix of s, or -1
+	std::vector<int32_t> m_rule; // the first rule whose key is s, or -1
+
+	std::vector<std::string> m_replacements;
+
+	std::array<bool, 128> m_first; // characters keys start with
+	int m_single_first; // the only character keys start with, or -1
+
+	void add(const std::string &key, index_t rule);
+
+	void link();
+
+	inline index_t skip(const char *text, index_t i, index_t n) const;
+
+public:
+	LiteralAutomaton(BaseExpressionPtr rules, bool ignore_case);
+
+	inline bool ignore_case() const {
+		return m_ignore_case;
+	}
+
+	inline bool is_applicable() const {
+		return m_applicable;
+	}
+
+	// the leftmost, non-overlapping matches in text, where of several rules
+	// matching at the same position, the first one in the rule list wins.
+	std::vector<Match> find(const char *text, index_t n, machine_integer_t max_matches) const;
+
+	StringRef replace(const String *string, machine_integer_t max_matches) const;
+};
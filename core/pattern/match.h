@@ -100,6 +100,10 @@ public:
         return m_slots[m_slots[i].index_to_ith].value;
     }
 
+    inline index_t slot_index(const Symbol *variable) const {
+        return m_matcher->variables().find(variable);
+    }
+
     inline const UnsafeBaseExpressionRef &slot(index_t i) const {
         assert(i >= 0 && i < m_slots.size());
         return m_slots[i].value;
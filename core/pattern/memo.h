@@ -0,0 +1,131 @@
+#pragma once
+
+#include <unordered_map>
+#include <algorithm>
+
+// SequenceMemo remembers the states from which matching the rest of a pattern
+// has already failed once. a state is a matcher node, a position in a subject
+// sequence and the bindings of those variables that the rest of the pattern
+// refers to (see PatternMatcher::memo_symbols). as the outcome of matching
+// from such a state is always the same, sequence matchers need not retry it
+// when backtracking, which turns patterns like {a___, x_, b___, x_, c___} from
+// exponential into polynomial time. if no variables are bound, this is just a
+// dynamic programming table over (node, begin).
+
+// a state refers to its subject by address. as matching Flat heads creates
+// temporary expressions, whose leaves might later get the address of another
+// temporary's, each state also holds a reference to the subject expression.
+
+// taking snapshots of the bindings is not free, so MatchContext switches the
+// memo on only after a match has taken MemoAfterSteps sequence steps.
+
+class SequenceMemo {
+public:
+	enum {
+		MemoAfterSteps = 256,
+		MaxStates = 1 << 16
+	};
+
+	class State {
+	private:
+		const PatternMatcher * const m_node;
+		const void * const m_subject;
+		const UnsafeBaseExpressionRef m_owner;
+		const index_t m_begin;
+		const index_t m_end;
+		std::vector<UnsafeBaseExpressionRef> m_slots;
+		hash_t m_hash;
+
+	public:
+		inline State(
+			const PatternMatcher *node,
+			const std::tuple<const void*, index_t, BaseExpressionPtr> &subject,
+			index_t begin,
+			index_t end,
+			const std::vector<index_t> &slots,
+			const Match &match) :
+
+			m_node(node),
+			m_subject(std::get<0>(subject)),
+			m_owner(std::get<2>(subject)),
+			m_begin(std::get<1>(subject) + begin),
+			m_end(std::get<1>(subject) + end) {
+
+			m_hash = hash_pair(hash_pair(
+				std::uintptr_t(m_node), std::uintptr_t(m_subject)), hash_pair(m_begin, m_end));
+
+			m_slots.reserve(slots.size());
+			for (const index_t i : slots) {
+				const UnsafeBaseExpressionRef &value = match.slot(i);
+				m_slots.push_back(value);
+				m_hash = hash_combine(m_hash, value ? value->hash() : 0);
+			}
+		}
+
+		inline hash_t hash() const {
+			return m_hash;
+		}
+
+		inline bool operator==(const State &state) const {
+			if (m_node != state.m_node || m_subject != state.m_subject ||
+				m_begin != state.m_begin || m_end != state.m_end) {
+				return false;
+			}
+
+			const size_t n = m_slots.size();
+			if (n != state.m_slots.size()) {
+				return false;
+			}
+
+			for (size_t i = 0; i < n; i++) {
+				const BaseExpressionPtr a = m_slots[i].get();
+				const BaseExpressionPtr b = state.m_slots[i].get();
+				if (a != b && (!a || !b || !a->same(b))) {
+					return false;
+				}
+			}
+
+			return true;
+		}
+	};
+
+private:
+	std::unordered_multimap<hash_t, State> m_failed;
+	std::unordered_map<const PatternMatcher*, std::vector<index_t>> m_slots;
+
+public:
+	// the slots of the variables node's outcome might depend on.
+	inline const std::vector<index_t> &slots(const PatternMatcher *node, const Match &match) {
+		const auto i = m_slots.find(node);
+		if (i != m_slots.end()) {
+			return i->second;
+		}
+
+		std::vector<index_t> &slots = m_slots[node];
+		for (const SymbolRef &symbol : node->memo_symbols()) {
+			const index_t index = match.slot_index(symbol.get());
+			if (index >= 0) {
+				slots.push_back(index);
+			}
+		}
+		std::sort(slots.begin(), slots.end());
+		return slots;
+	}
+
+	inline bool failed(const State &state) const {
+		const auto range = m_failed.equal_range(state.hash());
+		for (auto i = range.first; i != range.second; i++) {
+			if (i->second == state) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	inline void add(State &&state) {
+		if (m_failed.size() < MaxStates) {
+			const hash_t hash = state.hash();
+			m_failed.emplace(hash, std::move(state));
+		}
+	}
+};
@@ -0,0 +1,529 @@
+#pragma once
+
+#include "core/atoms/integer.h"
+#include "core/atoms/real.h"
+
+#include <vector>
+
+// NativePredicate is a C++ version of a test on a single value that would
+// otherwise need an evaluation, namely one of the builtin predicates below or
+// a comparison against a numeric literal (as in x_ /; x > 0 or _?(# > 0 &)).
+
+// whenever the outcome might differ from what evaluation gives (e.g. for
+// Positive[Pi] or 1.5 == 1.5000000000000002), it returns undecided and the
+// caller needs to evaluate after all.
+
+class NativePredicate {
+public:
+	enum Operator {
+		None,
+		IntegerQ,
+		EvenQ,
+		OddQ,
+		NumberQ,
+		MachineNumberQ,
+		Positive,
+		Negative,
+		NonPositive,
+		NonNegative,
+		Less,
+		LessEqual,
+		Greater,
+		GreaterEqual,
+		Equal,
+		Unequal,
+		Same
+	};
+
+private:
+	Operator m_operator;
+	bool m_integer_operand;
+	machine_integer_t m_integer;
+	machine_real_t m_real;
+
+	static inline Operator mirrored(Operator op) {
+		switch (op) {
+			case Less:
+				return Greater;
+			case LessEqual:
+				return GreaterEqual;
+			case Greater:
+				return Less;
+			case GreaterEqual:
+				return LessEqual;
+			default:
+				return op;
+		}
+	}
+
+	// for a machine integer and a machine real, x < y and so on convert the
+	// integer to a real first, as Comparison in arithmetic/compare.tcc does.
+	template<typename T, typename U>
+	inline tribool compare(T x, U y) const {
+		switch (m_operator) {
+			case Less:
+				return x < y;
+			case LessEqual:
+				return x <= y;
+			case Greater:
+				return x > y;
+			case GreaterEqual:
+				return x >= y;
+			default:
+				return undecided;
+		}
+	}
+
+	template<typename T>
+	inline tribool compare(T x) const {
+		if (m_integer_operand) {
+			return compare(x, m_integer);
+		} else {
+			return compare(x, m_real);
+		}
+	}
+
+public:
+	inline NativePredicate() : m_operator(None) {
+	}
+
+	// for a test like IntegerQ.
+	static inline NativePredicate function(SymbolName name) {
+		NativePredicate predicate;
+		switch (name) {
+			case S::IntegerQ:
+				predicate.m_operator = IntegerQ;
+				break;
+			case S::EvenQ:
+				predicate.m_operator = EvenQ;
+				break;
+			case S::OddQ:
+				predicate.m_operator = OddQ;
+				break;
+			case S::NumberQ:
+				predicate.m_operator = NumberQ;
+				break;
+			case S::MachineNumberQ:
+				predicate.m_operator = MachineNumberQ;
+				break;
+			case S::Positive:
+				predicate.m_operator = Positive;
+				break;
+			case S::Negative:
+				predicate.m_operator = Negative;
+				break;
+			case S::NonPositive:
+				predicate.m_operator = NonPositive;
+				break;
+			case S::NonNegative:
+				predicate.m_operator = NonNegative;
+				break;
+			default:
+				break;
+		}
+		return predicate;
+	}
+
+	// for a comparison head[x, operand] or, if swapped, head[operand, x].
+	static inline NativePredicate comparison(
+		SymbolName head,
+		BaseExpressionPtr operand,
+		bool swapped) {
+
+		NativePredicate predicate;
+
+		switch (operand->type()) {
+			case MachineIntegerType:
+				predicate.m_integer_operand = true;
+				predicate.m_integer = static_cast<const MachineInteger*>(operand)->value;
+				break;
+			case MachineRealType:
+				if (head == S::Equal || head == S::Unequal) {
+					return predicate; // Equal on reals has a tolerance
+				}
+				predicate.m_integer_operand = false;
+				predicate.m_real = static_cast<const MachineReal*>(operand)->value;
+				break;
+			default:
+				return predicate;
+		}
+
+		Operator op;
+		switch (head) {
+			case S::Less:
+				op = Less;
+				break;
+			case S::LessEqual:
+				op = LessEqual;
+				break;
+			case S::Greater:
+				op = Greater;
+				break;
+			case S::GreaterEqual:
+				op = GreaterEqual;
+				break;
+			case S::Equal:
+				op = Equal;
+				break;
+			case S::Unequal:
+				op = Unequal;
+				break;
+			default:
+				return predicate;
+		}
+
+		predicate.m_operator = swapped ? mirrored(op) : op;
+		return predicate;
+	}
+
+	// for a literal number that a value must be the same as.
+	static inline NativePredicate same(BaseExpressionPtr literal) {
+		NativePredicate predicate;
+		switch (literal->type()) {
+			case MachineIntegerType:
+				predicate.m_integer_operand = true;
+				predicate.m_integer = static_cast<const MachineInteger*>(literal)->value;
+				break;
+			case MachineRealType:
+				predicate.m_integer_operand = false;
+				predicate.m_real = static_cast<const MachineReal*>(literal)->value;
+				break;
+			default:
+				return predicate;
+		}
+		predicate.m_operator = Same;
+		return predicate;
+	}
+
+	// for a condition like Positive[x], x > 0 or 0 < x on a single variable x.
+	// variable(item) gives an index >= 0 if item is the variable; the index of
+	// the variable that was found is stored in index.
+	template<typename Variable>
+	static NativePredicate condition(
+		BaseExpressionPtr condition,
+		const Variable &variable,
+		index_t &index) {
+
+		if (!condition->is_expression()) {
+			return NativePredicate();
+		}
+
+		const Expression * const expr = condition->as_expression();
+		const SymbolName head = expr->head()->symbol();
+
+		switch (expr->size()) {
+			case 1: {
+				const auto &leaves = expr->n_leaves<1>();
+				index = variable(leaves[0].get());
+				if (index >= 0) {
+					return function(head);
+				}
+				break;
+			}
+
+			case 2: {
+				const auto &leaves = expr->n_leaves<2>();
+				const index_t index0 = variable(leaves[0].get());
+				const index_t index1 = variable(leaves[1].get());
+				if (index0 >= 0 && index1 < 0) {
+					index = index0;
+					return comparison(head, leaves[1].get(), false);
+				} else if (index0 < 0 && index1 >= 0) {
+					index = index1;
+					return comparison(head, leaves[0].get(), true);
+				}
+				break;
+			}
+
+			default:
+				break;
+		}
+
+		return NativePredicate();
+	}
+
+	// for a Function like # > 0 &, i.e. Function[Greater[Slot[1], 0]].
+	static inline NativePredicate pure_function(BaseExpressionPtr f) {
+		if (!f->has_form(S::Function, 1)) {
+			return NativePredicate();
+		}
+
+		const BaseExpressionPtr body = f->as_expression()->n_leaves<1>()[0].get();
+		if (!body->is_expression() || body->as_expression()->size() != 2) {
+			return NativePredicate();
+		}
+
+		const Expression * const cmp = body->as_expression();
+		const auto &leaves = cmp->n_leaves<2>();
+
+		const auto is_slot_1 = [] (BaseExpressionPtr item) {
+			if (!item->has_form(S::Slot, 1)) {
+				return false;
+			}
+			const auto index = item->as_expression()->n_leaves<1>()[0]->get_machine_int_value();
+			return index && *index == 1;
+		};
+
+		if (is_slot_1(leaves[0].get())) {
+			return comparison(cmp->head()->symbol(), leaves[1].get(), false);
+		} else if (is_slot_1(leaves[1].get())) {
+			return comparison(cmp->head()->symbol(), leaves[0].get(), true);
+		} else {
+			return NativePredicate();
+		}
+	}
+
+	inline bool defined() const {
+		return m_operator != None;
+	}
+
+	inline tribool operator()(machine_integer_t x) const {
+		switch (m_operator) {
+			case IntegerQ:
+			case NumberQ:
+				return true;
+			case MachineNumberQ:
+				return false;
+			case EvenQ:
+				return (x & 1) == 0;
+			case OddQ:
+				return (x & 1) != 0;
+			case Positive:
+				return x > 0;
+			case Negative:
+				return x < 0;
+			case NonPositive:
+				return x <= 0;
+			case NonNegative:
+				return x >= 0;
+			case Equal:
+				return m_integer_operand ? tribool(x == m_integer) : undecided;
+			case Unequal:
+				return m_integer_operand ? tribool(x != m_integer) : undecided;
+			case Same:
+				return m_integer_operand && x == m_integer;
+			case None:
+				return undecided;
+			default:
+				return compare(x);
+		}
+	}
+
+	inline tribool operator()(machine_real_t x) const {
+		switch (m_operator) {
+			case IntegerQ:
+			case EvenQ:
+			case OddQ:
+				return false;
+			case NumberQ:
+			case MachineNumberQ:
+				return true;
+			case Positive:
+				return x > 0.;
+			case Negative:
+				return x < 0.;
+			case NonPositive:
+				return x <= 0.;
+			case NonNegative:
+				return x >= 0.;
+			case Same:
+				return !m_integer_operand && x == m_real;
+			case Equal:
+			case Unequal:
+			case None:
+				return undecided;
+			default:
+				return compare(x);
+		}
+	}
+
+	inline tribool operator()(BaseExpressionPtr item) const {
+		switch (item->type()) {
+			case MachineIntegerType:
+				return (*this)(static_cast<const MachineInteger*>(item)->value);
+
+			case MachineRealType:
+				return (*this)(static_cast<const MachineReal*>(item)->value);
+
+			case ExpressionType:
+				if (item->is_sequence()) {
+					return undecided;
+				}
+				break;
+
+			default:
+				break;
+		}
+
+		switch (m_operator) {
+			case IntegerQ:
+				return item->type() == BigIntegerType;
+			case EvenQ:
+				return item->type() == BigIntegerType &&
+					(static_cast<const BigInteger*>(item)->value & 1) == 0;
+			case OddQ:
+				return item->type() == BigIntegerType &&
+					(static_cast<const BigInteger*>(item)->value & 1) != 0;
+			case NumberQ:
+				return item->is_number();
+			case MachineNumberQ:
+				return item->type() == MachineComplexType;
+			default:
+				return undecided;
+		}
+	}
+};
+
+// NativePattern is a pattern for a single value that NativePredicate can
+// decide, like _Integer, 5, x_Real?Positive, _?(# > 3 &) or x_ /; x > 0. it
+// allows matching the leaves of packed slices without boxing each of them.
+
+class NativePattern {
+private:
+	bool m_defined;
+	bool m_integer; // might machine integers match?
+	bool m_real; // might machine reals match?
+	const Symbol *m_variable;
+	std::vector<NativePredicate> m_tests;
+
+	bool compile_head(BaseExpressionPtr head) {
+		switch (head->symbol()) {
+			case S::Integer:
+				m_real = false;
+				return true;
+			case S::Real:
+				m_integer = false;
+				return true;
+			default:
+				if (!head->is_symbol()) {
+					return false;
+				}
+				m_integer = false;
+				m_real = false;
+				return true;
+		}
+	}
+
+	bool compile_test(const NativePredicate &test) {
+		if (!test.defined()) {
+			return false;
+		}
+		m_tests.push_back(test);
+		return true;
+	}
+
+	bool compile(BaseExpressionPtr patt, bool sequence) {
+		switch (patt->type()) {
+			case MachineIntegerType:
+				m_real = false;
+				return !sequence && compile_test(NativePredicate::same(patt));
+
+			case MachineRealType:
+				m_integer = false;
+				return !sequence && compile_test(NativePredicate::same(patt));
+
+			case ExpressionType:
+				break;
+
+			default:
+				return false;
+		}
+
+		const Expression * const expr = patt->as_expression();
+
+		switch (expr->head()->symbol()) {
+			case S::Blank:
+			case S::BlankSequence:
+			case S::BlankNullSequence:
+				if ((expr->head()->symbol() != S::Blank) != sequence) {
+					return false;
+				}
+				switch (expr->size()) {
+					case 0:
+						return true;
+					case 1:
+						return compile_head(expr->n_leaves<1>()[0].get());
+					default:
+						return false;
+				}
+
+			case S::Pattern:
+				if (expr->size() == 2) {
+					const auto &leaves = expr->n_leaves<2>();
+					if (!leaves[0]->is_symbol() || m_variable) {
+						return false;
+					}
+					m_variable = leaves[0]->as_symbol();
+					return compile(leaves[1].get(), sequence);
+				}
+				return false;
+
+			case S::PatternTest:
+				if (expr->size() == 2 && !sequence) {
+					const auto &leaves = expr->n_leaves<2>();
+					if (!compile(leaves[0].get(), false)) {
+						return false;
+					}
+					const BaseExpressionPtr test = leaves[1].get();
+					return compile_test(test->is_symbol() ?
+						NativePredicate::function(test->symbol()) :
+						NativePredicate::pure_function(test));
+				}
+				return false;
+
+			case S::Condition:
+				if (expr->size() == 2 && !sequence) {
+					const auto &leaves = expr->n_leaves<2>();
+					if (!compile(leaves[0].get(), false) || !m_variable) {
+						return false;
+					}
+					const Symbol * const variable = m_variable;
+					index_t index;
+					return compile_test(NativePredicate::condition(
+						leaves[1].get(),
+						[variable] (BaseExpressionPtr item) -> index_t {
+							return item == variable ? 0 : -1;
+						},
+						index));
+				}
+				return false;
+
+			default:
+				return false;
+		}
+	}
+
+public:
+	// for a pattern matching one value, or, if sequence is true, for a
+	// BlankSequence or BlankNullSequence matching a sequence of such values.
+	NativePattern(BaseExpressionPtr patt, bool sequence = false) :
+		m_integer(true), m_real(true), m_variable(nullptr) {
+
+		m_defined = compile(patt, sequence);
+	}
+
+	inline bool defined() const {
+		return m_defined;
+	}
+
+	template<typename U>
+	inline tribool operator()(U x) const {
+		if (!(std::is_same<U, machine_integer_t>::value ? m_integer : m_real)) {
+			return false;
+		}
+
+		tribool result = true;
+		for (const NativePredicate &test : m_tests) {
+			switch (test(x)) {
+				case true:
+					break;
+				case false:
+					return false;
+				default:
+					result = undecided;
+					break;
+			}
+		}
+		return result;
+	}
+};
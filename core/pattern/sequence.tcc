@@ -5,6 +5,7 @@ private:
     MatchContext &m_context;
     const BaseExpressionPtr m_head;
     const BaseExpressionRef * const m_array;
+    const Expression * const m_owner;
 
 public:
     class Element {
@@ -51,8 +52,14 @@ public:
         }
     };
 
-    inline FastLeafSequence(MatchContext &context, BaseExpressionPtr head, const BaseExpressionRef *array) :
-        m_context(context), m_head(head), m_array(array) {
+    // owner is the expression array belongs to, if there is one.
+    inline FastLeafSequence(
+        MatchContext &context,
+        BaseExpressionPtr head,
+        const BaseExpressionRef *array,
+        const Expression *owner = nullptr) :
+
+        m_context(context), m_head(head), m_array(array), m_owner(owner) {
     }
 
     inline MatchContext &context() const {
@@ -63,6 +70,14 @@ public:
         return m_head;
     }
 
+    inline std::tuple<const void*, index_t, BaseExpressionPtr> identity() const {
+        if (m_owner) {
+            return std::make_tuple(static_cast<const void*>(m_array), index_t(0), m_owner);
+        } else {
+            return std::make_tuple(static_cast<const void*>(nullptr), index_t(0), BaseExpressionPtr(nullptr)); // never memoized
+        }
+    }
+
     inline Element element(index_t begin) const {
         return Element(m_array, begin);
     }
@@ -143,6 +158,10 @@ public:
         return m_expr->head();
     }
 
+    inline std::tuple<const void*, index_t, BaseExpressionPtr> identity() const {
+        return std::make_tuple(static_cast<const void*>(m_expr), index_t(0), m_expr);
+    }
+
     inline Element element(index_t begin) const {
         return Element(m_expr, begin);
     }
@@ -198,6 +217,10 @@ public:
         return m_item->is_sequence() ? m_head : m_item->head(m_context.evaluation);
     }
 
+    inline std::tuple<const void*, index_t, BaseExpressionPtr> identity() const {
+        return std::make_tuple(static_cast<const void*>(nullptr), index_t(0), BaseExpressionPtr(nullptr)); // never memoized
+    }
+
     inline Element element(index_t begin) const {
         assert(begin == 0);
         if (!m_element) {
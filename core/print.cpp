@@ -0,0 +1,755 @@
+#include "types.h"
+#include "core/expression/implementation.h"
+#include "print.h"
+#include "export.h"
+#include "digits.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// blocks in which text is moved to a FileWriter.
+constexpr size_t DrainSize = 1 << 16;
+
+// the number of reals formatted in one go, between drains.
+constexpr size_t RealsBlockSize = 1024;
+
+// strips Pattern, HoldPattern, Verbatim and tests from a pattern. verbatim is
+// set if what remains is to be taken literally, tested if a test or condition
+// restricts it.
+BaseExpressionPtr strip_pattern(BaseExpressionPtr item, bool &verbatim, bool &tested) {
+	while (item->is_expression() && !verbatim) {
+		const Expression * const expr = item->as_expression();
+		const size_t n = expr->size();
+
+		// patterns never live in packed slices, so their leaves stay
+		// alive with expr.
+
+		switch (expr->head()->symbol()) {
+			case S::Pattern:
+				if (n != 2) {
+					return item;
+				}
+				item = expr->leaf(1).get();
+				break;
+
+			case S::HoldPattern:
+				if (n != 1) {
+					return item;
+				}
+				item = expr->leaf(0).get();
+				break;
+
+			case S::Verbatim:
+				if (n != 1) {
+					return item;
+				}
+				item = expr->leaf(0).get();
+				verbatim = true;
+				break;
+
+			case S::PatternTest:
+			case S::Condition:
+				if (n != 2) {
+					return item;
+				}
+				item = expr->leaf(0).get();
+				tested = true;
+				break;
+
+			default:
+				return item;
+		}
+	}
+
+	return item;
+}
+
+// adds the symbols that a MakeBoxes rule for item applies to, i.e. heads
+// of expressions, symbols, or heads of atoms; nothing for a rule that
+// applies to anything without a test. false if we cannot tell.
+bool rule_symbols(
+	BaseExpressionPtr item,
+	std::vector<const Symbol*> &symbols,
+	const Evaluation &evaluation) {
+
+	bool verbatim = false;
+	bool tested = false;
+	item = strip_pattern(item, verbatim, tested);
+
+	if (item->is_symbol()) {
+		symbols.push_back(item->as_symbol());
+		return true;
+	} else if (!item->is_expression()) {
+		symbols.push_back(item->head(evaluation)->as_symbol());
+		return true;
+	}
+
+	const Expression * const expr = item->as_expression();
+	const size_t n = expr->size();
+
+	if (!verbatim) {
+		switch (expr->head()->symbol()) {
+			case S::Blank:
+			case S::BlankSequence:
+			case S::BlankNullSequence:
+				if (n == 0) {
+					return !tested;
+				} else if (n == 1 && expr->leaf(0)->is_symbol()) {
+					symbols.push_back(expr->leaf(0)->as_symbol());
+					return true;
+				} else {
+					return false;
+				}
+
+			case S::Alternatives:
+				for (size_t i = 0; i < n; i++) {
+					if (!rule_symbols(expr->leaf(i).get(), symbols, evaluation)) {
+						return false;
+					}
+				}
+				return true;
+
+			default:
+				break;
+		}
+	}
+
+	bool head_verbatim = false;
+	bool head_tested = false;
+	const BaseExpressionPtr head = strip_pattern(expr->head(), head_verbatim, head_tested);
+
+	if (head->is_symbol()) {
+		symbols.push_back(head->as_symbol());
+		return true;
+	} else if (!head_verbatim && head->is_expression() &&
+		head->as_expression()->head()->symbol() == S::Alternatives) {
+
+		const Expression * const alternatives = head->as_expression();
+		for (size_t i = 0; i < alternatives->size(); i++) {
+			const BaseExpressionPtr alternative = alternatives->leaf(i).get();
+			if (!alternative->is_symbol()) {
+				return false;
+			}
+			symbols.push_back(alternative->as_symbol());
+		}
+		return true;
+	} else {
+		return false;
+	}
+}
+
+// whether a MakeBoxes rule with the given form pattern might apply in form.
+bool matches_form(BaseExpressionPtr pattern, const Symbol *form) {
+	bool verbatim = false;
+	bool tested = false;
+	pattern = strip_pattern(pattern, verbatim, tested);
+
+	if (pattern->is_symbol()) {
+		return pattern == form;
+	} else if (!pattern->is_expression()) {
+		return false;
+	} else if (verbatim) {
+		return true;
+	}
+
+	const Expression * const expr = pattern->as_expression();
+	const size_t n = expr->size();
+
+	switch (expr->head()->symbol()) {
+		case S::Alternatives:
+			for (size_t i = 0; i < n; i++) {
+				if (matches_form(expr->leaf(i).get(), form)) {
+					return true;
+				}
+			}
+			return false;
+
+		case S::Blank:
+			return n == 0 || expr->leaf(0)->symbol() == S::_Symbol;
+
+		default:
+			return true;
+	}
+}
+
+template<typename U>
+inline const PackedSlice<U> &packed_slice(const Expression *expr) {
+	return static_cast<const PackedExpression<U>*>(expr)->slice();
+}
+
+} // namespace
+
+PrintDefinitions::PrintDefinitions() : m_initialized(false) {
+	for (FormRules &form : m_forms) {
+		form.unknown = true;
+	}
+}
+
+void PrintDefinitions::add_operator(
+	const Symbol *symbol,
+	const char *name,
+	machine_integer_t precedence,
+	const char *grouping) {
+
+	Grouping g;
+	if (strcmp(grouping, "Left") == 0) {
+		g = Grouping::Left;
+	} else if (strcmp(grouping, "Right") == 0) {
+		g = Grouping::Right;
+	} else if (strcmp(grouping, "NonAssociative") == 0) {
+		g = Grouping::NonAssociative;
+	} else {
+		g = Grouping::None;
+	}
+
+	m_operators[symbol] = Operator{std::string(" ") + name + " ", precedence, g};
+}
+
+void PrintDefinitions::add_rule(
+	BaseExpressionPtr item,
+	BaseExpressionPtr form,
+	const Evaluation &evaluation) {
+
+	std::vector<const Symbol*> symbols;
+	const bool known = rule_symbols(item, symbols, evaluation);
+
+	const Symbol * const forms[NumPrintForms] = {
+		evaluation.FullForm, evaluation.InputForm, evaluation.OutputForm};
+
+	for (int i = 0; i < NumPrintForms; i++) {
+		if (!matches_form(form, forms[i])) {
+			continue;
+		}
+
+		if (known) {
+			for (const Symbol *symbol : symbols) {
+				m_forms[i].rules[symbol] += 1;
+			}
+		} else {
+			m_forms[i].unknown = true;
+		}
+	}
+}
+
+void PrintDefinitions::initialize(const Evaluation &evaluation) {
+	for (FormRules &form : m_forms) {
+		form.unknown = false;
+		form.rules.clear();
+	}
+
+	const Rules * const rules = evaluation.MakeBoxes->state().down_rules();
+
+	if (rules) {
+		for (const RuleEntry &entry : rules->sorted(evaluation)) {
+			const BaseExpressionPtr pattern = entry.pattern().get();
+
+			// MakeBoxes[expr_] just adds StandardForm.
+			if (pattern->has_form(S::MakeBoxes, 2)) {
+				const Expression * const lhs = pattern->as_expression();
+				add_rule(lhs->leaf(0).get(), lhs->leaf(1).get(), evaluation);
+			}
+		}
+	}
+
+	m_initialized = true;
+}
+
+Printer::Printer(std::string &out, const Evaluation &evaluation, FileWriter *drain) :
+	m_out(out),
+	m_evaluation(evaluation),
+	m_definitions(evaluation.definitions.printing),
+	m_drain(drain),
+	m_builtin(evaluation.MakeBoxes->has_builtin_rules()) {
+
+	begin(PrintForm::FullForm, StringCharacters::Escaped);
+}
+
+bool Printer::has_format_values(const Symbol *symbol) const {
+	const SymbolRules * const rules = symbol->state().rules();
+	return rules && !rules->format_values.empty();
+}
+
+void Printer::begin(PrintForm form, StringCharacters strings) {
+	const Evaluation &evaluation = m_evaluation;
+
+	m_form = form;
+	switch (form) {
+		case PrintForm::FullForm:
+			m_form_symbol = BaseExpressionRef(evaluation.FullForm);
+			break;
+		case PrintForm::InputForm:
+			m_form_symbol = BaseExpressionRef(evaluation.InputForm);
+			break;
+		case PrintForm::OutputForm:
+			m_form_symbol = BaseExpressionRef(evaluation.OutputForm);
+			break;
+	}
+
+	m_strings = strings;
+	m_options.ShowStringCharacters = strings != StringCharacters::Hidden;
+
+	const bool native = m_builtin && m_definitions.is_native(form);
+	m_native = native;
+	m_native_integers = native && m_definitions.rules(form, evaluation.Integer) == 0;
+	m_native_reals = native && m_definitions.rules(form, evaluation.Real) == 0;
+	m_native_strings = native && m_definitions.rules(form, evaluation.String) == 0;
+	m_native_symbols = native && m_definitions.rules(form, evaluation._Symbol) == 0;
+}
+
+bool Printer::is_native_atom(const BaseExpression *atom) const {
+	switch (atom->type()) {
+		case SymbolType:
+			return m_native_symbols && m_definitions.rules(m_form, static_cast<const Symbol*>(atom)) == 0;
+
+		case MachineIntegerType:
+		case BigIntegerType:
+			return m_native_integers;
+
+		case MachineRealType:
+		case BigRealType:
+			return m_native_reals;
+
+		case StringType:
+			return m_native_strings;
+
+		default:
+			return false;
+	}
+}
+
+bool Printer::is_native(const Expression *expr, Frame &frame) const {
+	frame.expr = expr;
+	frame.kind = Kind::Generic;
+	frame.next = Frame::head;
+	frame.op = nullptr;
+
+	if (!m_native) {
+		return false;
+	}
+
+	const BaseExpressionPtr head = expr->head();
+
+	if (!head->is_symbol()) {
+		// f[x][y]: neither format values nor MakeBoxes rules look at it
+		// as a whole, but they do look at f[x].
+		return true;
+	}
+
+	const Symbol * const symbol = head->as_symbol();
+
+	switch (symbol->symbol()) {
+		// formatting does not traverse these, or treats them specially.
+		case S::StandardForm:
+		case S::InputForm:
+		case S::OutputForm:
+		case S::FullForm:
+		case S::TraditionalForm:
+		case S::TeXForm:
+		case S::MathMLForm:
+		case S::NumberForm:
+		case S::Graphics:
+		case S::HoldForm:
+		case S::Infix:
+		case S::Prefix:
+		case S::Postfix:
+		case S::Row:
+			return false;
+
+		default:
+			break;
+	}
+
+	const size_t rules = m_definitions.rules(m_form, symbol);
+
+	if (m_form == PrintForm::FullForm) {
+		return rules == 0;
+	}
+
+	if (has_format_values(symbol)) {
+		return false;
+	}
+
+	if (symbol->symbol() == S::List) {
+		if (rules != 1) {
+			return false;
+		}
+		frame.kind = Kind::List;
+		frame.next = 0;
+		return true;
+	}
+
+	const PrintDefinitions::Operator * const op = m_definitions.lookup_operator(symbol);
+
+	if (op) {
+		if (rules != 1) {
+			return false;
+		}
+
+		const size_t n = expr->size();
+
+		switch (op->grouping) {
+			case PrintDefinitions::Grouping::Left:
+			case PrintDefinitions::Grouping::Right:
+				if (n != 2) {
+					return true; // the operator's rule does not apply
+				}
+				break;
+
+			default:
+				if (n < 1) {
+					return true;
+				}
+				break;
+		}
+
+		frame.kind = Kind::Infix;
+		frame.next = 0;
+		frame.op = op;
+		return true;
+	}
+
+	return rules == 0;
+}
+
+bool Printer::is_parenthesized(const Frame &frame, size_t i, const BaseExpression *leaf) const {
+	// see MakeBoxes::parenthesize()
+
+	bool when_equal;
+
+	switch (frame.op->grouping) {
+		case PrintDefinitions::Grouping::NonAssociative:
+			when_equal = true;
+			break;
+		case PrintDefinitions::Grouping::Left:
+			when_equal = i > 0;
+			break;
+		case PrintDefinitions::Grouping::Right:
+			when_equal = i == 0;
+			break;
+		default:
+			when_equal = false;
+			break;
+	}
+
+	while (leaf->has_form(S::HoldForm, 1)) {
+		leaf = leaf->as_expression()->leaf(0).get();
+	}
+
+	if (!leaf->is_expression()) {
+		return false;
+	}
+
+	const Expression * const expr = leaf->as_expression();
+	optional<machine_integer_t> precedence;
+
+	switch (expr->head()->symbol()) {
+		case S::Infix:
+		case S::Prefix:
+		case S::Postfix:
+			if (expr->size() >= 3) {
+				precedence = expr->leaf(2)->get_machine_int_value();
+			}
+			break;
+
+		case S::PrecedenceForm:
+			if (expr->size() == 2) {
+				precedence = expr->leaf(1)->get_machine_int_value();
+			}
+			break;
+
+		default:
+			break;
+	}
+
+	return precedence && (frame.op->precedence > *precedence ||
+		(when_equal && frame.op->precedence == *precedence));
+}
+
+void Printer::integer(machine_integer_t x) {
+	char buffer[MaxIntegerDigits + 1];
+	m_out.append(buffer, integer_text(buffer, x));
+}
+
+void Printer::real(machine_real_t x) {
+	// exactly as MakeBoxes writes it, which relies on NumberForm.
+	if (!m_evaluation.definitions.number_form.append_real(m_out, x, m_form_symbol.get(), m_evaluation)) {
+		m_out.append(MachineReal::construct(x)->make_boxes(
+			m_form_symbol.get(), m_evaluation)->boxes_to_text(m_options, m_evaluation));
+	}
+}
+
+void Printer::reals(const machine_real_t *values, size_t n, const char *separator) {
+	const NumberFormatter &number_form = m_evaluation.definitions.number_form;
+
+	size_t i = 0;
+	while (i < n) {
+		if (i > 0) {
+			m_out.append(separator);
+		}
+
+		const size_t block = std::min(n - i, RealsBlockSize);
+		const size_t k = number_form.append_reals(
+			m_out, values + i, block, separator, m_form_symbol.get(), m_evaluation);
+		i += k;
+
+		if (k < block) {
+			if (k > 0) {
+				m_out.append(separator);
+			}
+			real(values[i++]);
+		}
+
+		drain(DrainSize);
+	}
+}
+
+void Printer::write_string(const String *s) {
+	const std::string text = s->utf8();
+
+	switch (m_strings) {
+		case StringCharacters::Hidden:
+			m_out.append(text);
+			break;
+
+		case StringCharacters::Shown:
+			m_out.push_back('"');
+			m_out.append(text);
+			m_out.push_back('"');
+			break;
+
+		case StringCharacters::Escaped:
+			m_out.push_back('"');
+			for (const char c : text) {
+				if (c == '"' || c == '\\') {
+					m_out.push_back('\\');
+				}
+				m_out.push_back(c);
+			}
+			m_out.push_back('"');
+			break;
+	}
+}
+
+void Printer::write_atom(const BaseExpression *atom) {
+	switch (atom->type()) {
+		case SymbolType:
+			m_out.append(static_cast<const Symbol*>(atom)->short_name());
+			break;
+
+		case MachineIntegerType:
+			integer(static_cast<const MachineInteger*>(atom)->value);
+			break;
+
+		case BigIntegerType:
+			m_out.append(static_cast<const BigInteger*>(atom)->value.get_str());
+			break;
+
+		case StringType:
+			write_string(static_cast<const String*>(atom));
+			break;
+
+		default:
+			m_out.append(atom->make_boxes(
+				m_form_symbol.get(), m_evaluation)->boxes_to_text(m_options, m_evaluation));
+			break;
+	}
+}
+
+void Printer::write_packed(const Expression *expr) {
+	const size_t n = expr->size();
+
+	switch (expr->slice_code()) {
+		case PackedSliceMachineIntegerCode: {
+			const machine_integer_t * const values = packed_slice<machine_integer_t>(expr).address();
+			for (size_t i = 0; i < n; i++) {
+				if (i > 0) {
+					m_out.append(", ", 2);
+				}
+				integer(values[i]);
+				drain(DrainSize);
+			}
+			break;
+		}
+
+		case PackedSliceMachineRealCode:
+			reals(packed_slice<machine_real_t>(expr).address(), n, ", ");
+			break;
+
+		default:
+			throw std::runtime_error("illegal slice code");
+	}
+}
+
+void Printer::write_boxes(const BaseExpression *item) {
+	// exactly what formatting item as part of a larger expression gives.
+
+	const Evaluation &evaluation = m_evaluation;
+
+	const BaseExpressionRef formatted = m_form == PrintForm::FullForm ?
+		BaseExpressionRef(item) :
+		item->custom_format_or_copy(BaseExpressionRef(evaluation.OutputForm), evaluation);
+
+	m_out.append(expression(evaluation.MakeBoxes, formatted, m_form_symbol)->
+		evaluate_or_copy(evaluation)->boxes_to_text(m_options, evaluation));
+}
+
+void Printer::write(const BaseExpression *item) {
+	if (!item->is_expression()) {
+		if (is_native_atom(item)) {
+			write_atom(item);
+		} else {
+			write_boxes(item);
+		}
+		return;
+	}
+
+	Frame frame;
+	if (!is_native(item->as_expression(), frame)) {
+		write_boxes(item);
+		return;
+	}
+
+	if (frame.kind == Kind::List) {
+		m_out.push_back('{');
+	}
+
+	m_stack.push_back(frame);
+}
+
+void Printer::step() {
+	// write() may push, so we are done with frame once we call it.
+
+	Frame &frame = m_stack.back();
+	const Expression * const expr = frame.expr;
+
+	if (frame.next == Frame::head) {
+		frame.next = Frame::bracket;
+		write(expr->head());
+		return;
+	}
+
+	if (frame.next == Frame::bracket) {
+		m_out.push_back('[');
+		frame.next = 0;
+	}
+
+	const size_t n = expr->size();
+
+	if (frame.next == 0 && frame.kind != Kind::Infix && is_packed_slice(expr->slice_code())) {
+		if (expr->slice_code() == PackedSliceMachineIntegerCode ? m_native_integers : m_native_reals) {
+			write_packed(expr);
+			frame.next = n;
+		}
+	}
+
+	if (frame.next < n) {
+		const size_t i = frame.next++;
+
+		if (i > 0) {
+			if (frame.kind == Kind::Infix) {
+				m_out.append(frame.op->name);
+			} else {
+				m_out.append(", ", 2);
+			}
+		}
+
+		// the leaves of slices that are not packed live in their
+		// expression, which stays alive while we are writing it.
+		const BaseExpressionRef leaf = expr->leaf(i);
+
+		if (frame.kind == Kind::Infix && n > 1 && is_parenthesized(frame, i, leaf.get())) {
+			m_out.push_back('(');
+			write_boxes(leaf.get());
+			m_out.push_back(')');
+		} else {
+			write(leaf.get());
+		}
+	} else {
+		switch (frame.kind) {
+			case Kind::Generic:
+				m_out.push_back(']');
+				break;
+			case Kind::List:
+				m_out.push_back('}');
+				break;
+			case Kind::Infix:
+				break;
+		}
+		m_stack.pop_back();
+	}
+}
+
+void Printer::drain(size_t size) {
+	if (m_drain && m_out.size() >= size) {
+		m_drain->write(m_out);
+		m_out.clear();
+	}
+}
+
+void Printer::print(const BaseExpression *expr) {
+	m_stack.clear();
+
+	write(expr);
+	while (!m_stack.empty()) {
+		step();
+		drain(DrainSize);
+	}
+
+	drain(0);
+}
+
+void Printer::operator()(const BaseExpression *expr, PrintForm form, StringCharacters strings) {
+	begin(form, strings);
+	print(expr);
+}
+
+void Printer::output(const BaseExpression *expr) {
+	const Evaluation &evaluation = m_evaluation;
+
+	if (!m_builtin) {
+		m_out.append(expr->make_boxes(evaluation.OutputForm, evaluation)->boxes_to_text(StyleBoxOptions(), evaluation));
+		drain(0);
+		return;
+	}
+
+	if (expr->is_expression() && expr->as_expression()->size() == 1) {
+		const Expression * const wrapper = expr->as_expression();
+		const BaseExpressionRef leaf = wrapper->leaf(0);
+
+		switch (wrapper->head()->symbol()) {
+			case S::FullForm:
+				(*this)(leaf.get(), PrintForm::FullForm, StringCharacters::Shown);
+				return;
+
+			case S::InputForm: {
+				// unlike its leaves, leaf itself gets formatted for InputForm.
+				begin(PrintForm::InputForm, StringCharacters::Shown);
+				Frame frame;
+				if (leaf->is_expression() ? is_native(leaf->as_expression(), frame) : is_native_atom(leaf.get())) {
+					print(leaf.get());
+					return;
+				}
+				break;
+			}
+
+			case S::Row:
+				// what Print gives.
+				if (leaf->is_list() && !has_format_values(evaluation.Row) && !has_format_values(evaluation.List)) {
+					begin(PrintForm::OutputForm, StringCharacters::Hidden);
+					const Expression * const items = leaf->as_expression();
+					for (size_t i = 0; i < items->size(); i++) {
+						print(items->leaf(i).get());
+					}
+					return;
+				}
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	(*this)(expr, PrintForm::OutputForm, StringCharacters::Hidden);
+}
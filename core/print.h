@@ -0,0 +1,178 @@
+#pragma once
+
+#include "types.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class FileWriter;
+
+// the forms that Printer writes without going through boxes.
+enum class PrintForm : int {
+	FullForm = 0,
+	InputForm,
+	OutputForm
+};
+
+constexpr int NumPrintForms = 3;
+
+// how strings are written: as they are (as in OutputForm), quoted (as with
+// ShowStringCharacters) or quoted with " and \ escaped, so that they read back.
+enum class StringCharacters {
+	Hidden,
+	Shown,
+	Escaped
+};
+
+// what Printer knows about formatting that is defined by builtins: the
+// operators that are formatted as infix, and which heads, symbols and atoms
+// have builtin MakeBoxes rules in each form.
+
+class PrintDefinitions {
+public:
+	enum class Grouping {
+		None,
+		NonAssociative,
+		Left,
+		Right
+	};
+
+	struct Operator {
+		std::string name; // as written in InputForm and OutputForm, e.g. " == "
+		machine_integer_t precedence;
+		Grouping grouping;
+	};
+
+private:
+	struct FormRules {
+		bool unknown; // some rule might apply to any expression
+		std::unordered_map<const Symbol*, size_t> rules;
+	};
+
+	std::unordered_map<const Symbol*, Operator> m_operators;
+	FormRules m_forms[NumPrintForms];
+	bool m_initialized;
+
+	void add_rule(BaseExpressionPtr item, BaseExpressionPtr form, const Evaluation &evaluation);
+
+public:
+	PrintDefinitions();
+
+	// called by builtins that format symbol as an infix operator.
+	void add_operator(
+		const Symbol *symbol,
+		const char *name,
+		machine_integer_t precedence,
+		const char *grouping);
+
+	// scans the MakeBoxes rules, once all builtins are defined.
+	void initialize(const Evaluation &evaluation);
+
+	inline bool is_native(PrintForm form) const {
+		return m_initialized && !m_forms[int(form)].unknown;
+	}
+
+	// the number of builtin MakeBoxes rules in form that apply to expressions
+	// with head symbol, to symbol itself, or to atoms with head symbol.
+	inline size_t rules(PrintForm form, const Symbol *symbol) const {
+		const auto &rules = m_forms[int(form)].rules;
+		const auto i = rules.find(symbol);
+		return i == rules.end() ? 0 : i->second;
+	}
+
+	inline const Operator *lookup_operator(const Symbol *symbol) const {
+		const auto i = m_operators.find(symbol);
+		return i == m_operators.end() ? nullptr : &i->second;
+	}
+};
+
+// writes expressions as MakeBoxes and boxes_to_text would, but directly into
+// a string, walking them with an explicit stack. only parts that formatting
+// rules apply to, i.e. format values or MakeBoxes rules other than the ones
+// for lists and infix operators, are turned into boxes. once anyone defines
+// MakeBoxes rules, everything goes through boxes.
+
+class Printer {
+private:
+	enum class Kind {
+		Generic, // f[a, b]
+		List, // {a, b}
+		Infix // a op b
+	};
+
+	struct Frame {
+		static constexpr size_t head = size_t(-1);
+		static constexpr size_t bracket = size_t(-2);
+
+		const Expression *expr;
+		Kind kind;
+		size_t next; // the next leaf, or head or bracket
+		const PrintDefinitions::Operator *op;
+	};
+
+	std::string &m_out;
+	const Evaluation &m_evaluation;
+	const PrintDefinitions &m_definitions;
+	FileWriter * const m_drain;
+	const bool m_builtin;
+
+	PrintForm m_form;
+	BaseExpressionRef m_form_symbol;
+	StringCharacters m_strings;
+	StyleBoxOptions m_options;
+	bool m_native;
+	bool m_native_integers;
+	bool m_native_reals;
+	bool m_native_strings;
+	bool m_native_symbols;
+
+	std::vector<Frame> m_stack;
+
+	bool has_format_values(const Symbol *symbol) const;
+
+	bool is_native_atom(const BaseExpression *atom) const;
+
+	bool is_native(const Expression *expr, Frame &frame) const;
+
+	bool is_parenthesized(const Frame &frame, size_t i, const BaseExpression *leaf) const;
+
+	void write_string(const String *s);
+
+	void write_atom(const BaseExpression *atom);
+
+	void write_packed(const Expression *expr);
+
+	void write_boxes(const BaseExpression *item);
+
+	void write(const BaseExpression *item);
+
+	void step();
+
+	void drain(size_t size);
+
+	void begin(PrintForm form, StringCharacters strings);
+
+	void print(const BaseExpression *expr);
+
+public:
+	// if drain is given, text gets moved from out to drain in blocks.
+	Printer(std::string &out, const Evaluation &evaluation, FileWriter *drain = nullptr);
+
+	// as Evaluation::format_output, i.e. in OutputForm, unless expr is
+	// FullForm[x] or InputForm[x].
+	void output(const BaseExpression *expr);
+
+	// as MakeBoxes[expr, form] would read, where expr is formatted for
+	// OutputForm first unless form is FullForm.
+	void operator()(const BaseExpression *expr, PrintForm form, StringCharacters strings);
+
+	// the digits of x, or x as a real in the last form printed.
+	void integer(machine_integer_t x);
+
+	void real(machine_real_t x);
+
+	// n reals as real writes them, separated by separator, formatted in
+	// blocks by NumberFormatter::append_reals.
+	void reals(const machine_real_t *values, size_t n, const char *separator);
+};
@@ -36,6 +36,62 @@ BaseExpressionRef function_pattern(
     return expression(expression(head, expression(BlankSequence)), expression(BlankNullSequence));
 }
 
+bool is_exact_pattern(const BaseExpressionRef &pattern) {
+	if (!pattern->is_expression()) {
+		return true;
+	}
+
+	const Expression * const expr = pattern->as_expression();
+
+	switch (expr->head()->symbol()) {
+		case S::Blank:
+		case S::BlankSequence:
+		case S::BlankNullSequence:
+		case S::Pattern:
+		case S::PatternTest:
+		case S::Condition:
+		case S::Alternatives:
+		case S::Repeated:
+		case S::RepeatedNull:
+		case S::Except:
+		case S::Optional:
+		case S::OptionsPattern:
+		case S::Longest:
+		case S::Shortest:
+		case S::HoldPattern:
+		case S::Verbatim:
+			return false;
+
+		default:
+			break;
+	}
+
+	if (!is_exact_pattern(expr->_head)) {
+		return false;
+	}
+
+	// under these attributes, the matcher also matches expressions that are
+	// not same(), e.g. g[b, a] for g[a, b] with Orderless g.
+	if (expr->head()->is_symbol() && any(
+		expr->head()->as_symbol()->state().attributes(),
+		Attributes::Orderless + Attributes::Flat + Attributes::OneIdentity)) {
+		return false;
+	}
+
+	if (is_packed_slice(expr->slice_code())) {
+		return true;
+	}
+
+	return expr->with_slice([] (const auto &slice) {
+		for (auto leaf : slice) {
+			if (!is_exact_pattern(leaf)) {
+				return false;
+			}
+		}
+		return true;
+	});
+}
+
 inline MatchSize match_size(const BaseExpressionRef &pattern) {
 	if (!pattern->is_expression()) {
 		return MatchSize::exactly(0); // undefined
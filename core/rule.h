@@ -3,6 +3,8 @@
 
 #include "types.h"
 
+#include <iterator>
+
 enum class DefinitionsPos : int {
 	None,
 	Own,
@@ -13,6 +15,8 @@ enum class DefinitionsPos : int {
 
 #include "sort.h"
 
+bool is_exact_pattern(const BaseExpressionRef &pattern);
+
 class Rule : public AbstractHeapObject<Rule> {
 public:
 	const BaseExpressionRef pattern;
@@ -35,8 +39,14 @@ public:
 
 	virtual MatchSize leaf_match_size() const;
 
+	// only defined if pattern matches nothing but expressions that are same() as
+	// pattern, in which case these expressions all have this very hash().
 	inline optional<hash_t> match_hash() const {
-		return pattern->match_hash();
+		if (is_exact_pattern(pattern)) {
+			return pattern->hash();
+		} else {
+			return optional<hash_t>();
+		}
 	}
 };
 
@@ -135,6 +145,28 @@ inline optional<BaseExpressionRef> RulesVector<Entry>::apply(
 	Filter &filter,
 	const Evaluation &evaluation) const {
 
+	if (m_is_match_size_known && !m_exact_rules.empty()) {
+		// exact rules are more specific than any pattern rule, so we try them first.
+		const auto i = m_exact_rules.find(expr->hash());
+		if (i != m_exact_rules.end()) {
+			for (const Entry &entry : i->second) {
+				if (!entry.pattern()->same(*expr) || !filter(entry)) {
+					continue;
+				}
+
+				const optional<BaseExpressionRef> result =
+					entry.try_apply(expr, evaluation);
+				if (result) {
+					return result;
+				}
+			}
+		}
+	}
+
+	if (m_is_match_size_known && !m_index.empty()) {
+		return apply_indexed(expr, filter, evaluation);
+	}
+
 	const auto slice_code = expr->slice_code();
 
 	if (is_tiny_slice(slice_code)) {
@@ -147,6 +179,69 @@ inline optional<BaseExpressionRef> RulesVector<Entry>::apply(
 	}
 }
 
+template<typename Entry>
+template<typename Expression, typename Filter>
+inline optional<BaseExpressionRef> RulesVector<Entry>::apply_indexed(
+	const Expression *expr,
+	Filter &filter,
+	const Evaluation &evaluation) const {
+
+	const size_t n = expr->size();
+	const Symbols &symbols = evaluation.definitions.symbols();
+
+	RulesIndexCache::Candidates cached;
+	std::vector<size_t> computed;
+	expr->with_slice([this, expr, n, &symbols, &cached, &computed] (const auto &slice) {
+		const auto token = [&slice, &symbols] (size_t i) -> BaseExpressionPtr {
+			const auto leaf = slice[i];
+			if (leaf->is_expression()) {
+				const BaseExpressionPtr head = leaf->as_expression()->head();
+				return head->is_symbol() ? head : nullptr;
+			} else {
+				return leaf->head(symbols);
+			}
+		};
+
+		const SliceCode code = expr->slice_code();
+
+		if (is_tiny_slice(code)) {
+			BaseExpressionPtr heads[MaxTinySliceSize];
+			for (size_t i = 0; i < n; i++) {
+				heads[i] = token(i);
+			}
+
+			cached = m_index_cache.candidates(
+				code, slice.exact_type_mask(), heads,
+				[this, n, &heads] (std::vector<size_t> &result) {
+					m_index.candidates(n, [&heads] (size_t i) {
+						return heads[i];
+					}, result);
+				});
+		} else {
+			m_index.candidates(n, token, computed);
+		}
+	});
+
+	const std::vector<size_t> &candidates = cached ? *cached : computed;
+
+	// candidates are in the same order as in m_all_rules, and thus in m_rules.
+	for (const size_t i : candidates) {
+		const Entry &entry = m_all_rules[i];
+
+		if (!entry.size.contains(n) || !filter(entry)) {
+			continue;
+		}
+
+		const optional<BaseExpressionRef> result =
+			entry.try_apply(expr, evaluation);
+		if (result) {
+			return result;
+		}
+	}
+
+	return optional<BaseExpressionRef>();
+}
+
 template<typename Entry>
 template<typename Filter>
 inline optional<BaseExpressionRef> RulesVector<Entry>::apply(
@@ -172,9 +267,9 @@ inline optional<BaseExpressionRef> RulesVector<Entry>::apply(
 
 template<typename Entry>
 bool RulesVector<Entry>::has_rule_with_pattern(
-	std::vector<Entry> &entries,
+	const std::vector<Entry> &entries,
 	const BaseExpressionRef &pattern,
-	const Evaluation &evaluation) {
+	const Evaluation &evaluation) const {
 
 	SortKey key;
 	pattern->pattern_key(key, evaluation);
@@ -191,7 +286,7 @@ bool RulesVector<Entry>::has_rule_with_pattern(
 }
 
 template<typename Entry>
-void RulesVector<Entry>::insert_rule(
+size_t RulesVector<Entry>::insert_rule(
 	std::vector<Entry> &entries,
 	const Entry &entry,
 	const Evaluation &evaluation) {
@@ -206,11 +301,62 @@ void RulesVector<Entry>::insert_rule(
 			return entry.key().compare(key, evaluation) < 0;
 		});
 
+	const size_t position = i - entries.begin();
+
 	if (i != entries.end() && i->pattern()->same(entry.pattern())) {
 		Entry::merge(entries, i, entry);
 	} else {
 		entries.insert(i, entry);
 	}
+
+	return position;
+}
+
+template<typename Entry>
+void RulesVector<Entry>::update_index(size_t i, const Evaluation &evaluation) {
+	if (m_all_rules.size() < MinIndexedRules) {
+		return;
+	}
+
+	m_index_cache.clear();
+
+	const Symbols &symbols = evaluation.definitions.symbols();
+
+	if (m_all_rules.size() == MinIndexedRules) {
+		for (size_t j = 0; j < m_all_rules.size(); j++) {
+			m_index.add(m_all_rules[j].pattern(), j, symbols);
+		}
+	} else {
+		// loading n rules thus costs O(n) index insertions, instead of
+		// O(n^2) for rebuilding the whole index on each one.
+		m_index.insert(m_all_rules[i].pattern(), i, symbols);
+	}
+}
+
+template<typename Entry>
+std::vector<Entry> RulesVector<Entry>::sorted(
+	const Evaluation &evaluation) const {
+
+	const auto less = [&evaluation] (const Entry &x, const Entry &y) {
+		return x.key().compare(y.key(), evaluation) < 0;
+	};
+
+	std::vector<Entry> exact;
+	for (const auto &bucket : m_exact_rules) {
+		exact.insert(exact.end(), bucket.second.begin(), bucket.second.end());
+	}
+	std::stable_sort(exact.begin(), exact.end(), less);
+
+	// on equal keys, std::merge prefers the first range, i.e. the exact rules.
+	std::vector<Entry> entries;
+	entries.reserve(exact.size() + m_all_rules.size());
+	std::merge(
+		exact.begin(), exact.end(),
+		m_all_rules.begin(), m_all_rules.end(),
+		std::back_inserter(entries),
+		less);
+
+	return entries;
 }
 
 template<typename Entry>
@@ -227,11 +373,17 @@ void RulesVector<Entry>::set_governing_attributes(
 
     m_is_match_size_known = new_is_match_size_known;
 
+    // all_rules is already sorted, so we just need to distribute.
+    const std::vector<Entry> all_rules = sorted(evaluation);
+
     for (size_t code = 0; code < NumberOfSliceCodes; code++) {
         m_rules[code].clear();
-        for (const Entry &entry : m_all_rules) {
+        for (const Entry &entry : all_rules) {
+            if (is_indexed(entry)) {
+                continue;
+            }
             if (!m_is_match_size_known || entry.size.matches(SliceCode(code))) {
-                insert_rule(m_rules[code], entry, evaluation);
+                m_rules[code].push_back(entry);
             }
         }
     }
@@ -245,21 +397,50 @@ void RulesVector<Entry>::add(
 
 	const Entry entry(rule);
 
+	if (entry.hash) {
+		// O(1) independent of the number of existing exact rules. Entry::merge
+		// takes care of replacing an existing rule with the same pattern.
+		insert_rule(m_exact_rules[*entry.hash], entry, evaluation);
+		if (is_indexed(entry)) {
+			return;
+		}
+	}
+
 	for (size_t code = 0; code < NumberOfSliceCodes; code++) {
 		if (!m_is_match_size_known || entry.size.matches(SliceCode(code))) {
 			insert_rule(m_rules[code], entry, evaluation);
 		}
 	}
 
-	insert_rule(m_all_rules, entry, evaluation);
+	if (!entry.hash) {
+		const size_t n = m_all_rules.size();
+		const size_t i = insert_rule(m_all_rules, entry, evaluation);
+		if (m_all_rules.size() > n) {
+			// a merged rule keeps the pattern and thus the place in m_index.
+			update_index(i, evaluation);
+		}
+	}
 }
 
 template<typename Entry>
 bool RulesVector<Entry>::has_rule_with_pattern(
 	const BaseExpressionRef &lhs,
-	const Evaluation &evaluation) {
+	const Evaluation &evaluation) const {
 
-	return has_rule_with_pattern(m_all_rules, lhs, evaluation);
+	if (is_exact_pattern(lhs)) {
+		const auto i = m_exact_rules.find(lhs->hash());
+		if (i == m_exact_rules.end()) {
+			return false;
+		}
+		for (const Entry &entry : i->second) {
+			if (entry.pattern()->same(lhs)) {
+				return true;
+			}
+		}
+		return false;
+	} else {
+		return has_rule_with_pattern(m_all_rules, lhs, evaluation);
+	}
 }
 
 inline RuleEntry::RuleEntry(const RuleRef &rule) :
@@ -14,11 +14,13 @@
 #include "builtin/options.h"
 #include "builtin/patterns.h"
 #include "builtin/strings.h"
+#include "builtin/files.h"
 #include "builtin/structure.h"
 #include "builtin/numbertheory.h"
 #include "builtin/numeric.h"
 
 #include "concurrent/parallel.h"
+#include "hashcons.h"
 
 #if MAKE_UNIT_TEST
 const char *Builtin::docs = "";
@@ -94,6 +96,156 @@ public:
     }
 };
 
+class Share : public Builtin {
+public:
+    static constexpr const char *name = "Share";
+
+    static constexpr const char *docs = R"(
+    <dl>
+    <dt>'Share[$expr$]'
+        <dd>returns $expr$ with identical subexpressions stored only once.
+    <dt>'Share[]'
+        <dd>shares the values of all symbols and returns the approximate
+        number of bytes saved.
+    </dl>
+
+    >> Share[f[a ^ 2, a ^ 2, {1, 2}, {1, 2}]]
+     = f[a ^ 2, a ^ 2, {1, 2}, {1, 2}]
+
+    >> x = {a ^ 2, a ^ 2, g[a ^ 2]};
+    >> Share[] > 0
+     = True
+    >> x
+     = {a ^ 2, a ^ 2, g[a ^ 2]}
+    )";
+
+public:
+    using Builtin::Builtin;
+
+    void build(Runtime &runtime) {
+        builtin(&Share::apply_0);
+        builtin(&Share::apply_1);
+    }
+
+    inline BaseExpressionRef apply_0(
+        const EmptyExpression &,
+        const Evaluation &evaluation) {
+
+        HashConsTable &table = HashConsTable::instance();
+        size_t saved = 0;
+
+        evaluation.definitions.for_each_symbol([&table, &saved] (const SymbolRef &symbol) {
+            const BaseExpressionRef value = symbol->state().own_value();
+            if (value) {
+                const BaseExpressionRef shared = table.share(value, saved);
+                if (shared != value) {
+                    symbol->mutable_state().set_own_value(shared);
+                }
+            }
+        });
+
+        return from_primitive(machine_integer_t(saved));
+    }
+
+    inline BaseExpressionRef apply_1(
+        BaseExpressionPtr expr,
+        const Evaluation &evaluation) {
+
+        size_t saved = 0;
+        return HashConsTable::instance().share(expr, saved);
+    }
+};
+
+class DispatchCacheStatistics : public Builtin {
+public:
+    static constexpr const char *name = "DispatchCacheStatistics";
+
+    static constexpr const char *docs = R"(
+    <dl>
+    <dt>'DispatchCacheStatistics[$symbol$]'
+        <dd>gives the number of hits and misses of the cache that is used
+        to find candidate rules among the down values of $symbol$.
+    </dl>
+
+    >> h[x_Integer] := 1; h[x_Real] := 2; h[x_String] := 3; h[x_List] := 4;
+    >> h[x_Symbol] := 5; h[x_Rational] := 6; h[x_Complex] := 7; h[x_, y_] := 8;
+    >> {h[1], h[2], h[3]}
+     = {1, 1, 1}
+    >> First[DispatchCacheStatistics[h]] > 0
+     = True
+    )";
+
+    static constexpr auto attributes = Attributes::HoldAll;
+
+public:
+    using Builtin::Builtin;
+
+    void build(Runtime &runtime) {
+        builtin(&DispatchCacheStatistics::apply);
+    }
+
+    inline BaseExpressionRef apply(
+        BaseExpressionPtr symbol,
+        const Evaluation &evaluation) {
+
+        if (!symbol->is_symbol()) {
+            return BaseExpressionRef();
+        }
+
+        const Rules * const rules = symbol->as_symbol()->state().down_rules();
+        if (!rules) {
+            return expression(evaluation.List,
+                from_primitive(machine_integer_t(0)),
+                from_primitive(machine_integer_t(0)));
+        }
+
+        const RulesIndexCache &cache = rules->index_cache();
+        return expression(evaluation.List,
+            from_primitive(machine_integer_t(cache.hits())),
+            from_primitive(machine_integer_t(cache.misses())));
+    }
+};
+
+class PatternCacheStatistics : public Builtin {
+public:
+    static constexpr const char *name = "PatternCacheStatistics";
+
+    static constexpr const char *docs = R"(
+    <dl>
+    <dt>'PatternCacheStatistics[]'
+        <dd>gives the number of hits and misses of the global cache of
+        compiled patterns, and the number of seconds spent compiling.
+    </dl>
+
+    >> Cases[{1, a, 2}, _Integer]
+     = {1, 2}
+    >> Cases[{3, b, 4}, _Integer]
+     = {3, 4}
+    >> First[PatternCacheStatistics[]] > 0
+     = True
+    )";
+
+public:
+    using Builtin::Builtin;
+
+    void build(Runtime &runtime) {
+        builtin(&PatternCacheStatistics::apply_0);
+    }
+
+    inline BaseExpressionRef apply_0(
+        const EmptyExpression &,
+        const Evaluation &evaluation) {
+
+        const PatternCache::Statistics statistics =
+            PatternCache::instance().statistics();
+
+        return expression(evaluation.List,
+            from_primitive(machine_integer_t(statistics.hits)),
+            from_primitive(machine_integer_t(statistics.misses)),
+            from_primitive(statistics.compile_seconds));
+    }
+};
+
 class Experimental : public Unit {
 public:
     Experimental(Runtime &runtime) : Unit(runtime) {
@@ -101,6 +253,9 @@ public:
 
     void initialize() {
         add<N>();
+        add<Share>();
+        add<DispatchCacheStatistics>();
+        add<PatternCacheStatistics>();
 
         add("Expand",
             Attributes::None, {
@@ -153,6 +308,8 @@ Runtime *Runtime::s_instance = nullptr;
 
 void Runtime::init() {
     LegacyPool::init();
+    HashConsTable::init();
+    PatternCache::init();
     EvaluateDispatch::init();
     Parallel::init();
 }
@@ -191,11 +348,13 @@ Runtime::Runtime() :
     Builtins::Lists(*this).initialize();
 	Builtins::Logic(*this).initialize();
     Builtins::Strings(*this).initialize();
+    Builtins::Files(*this).initialize();
     Builtins::Structure(*this).initialize();
     Builtins::NumberTheory(*this).initialize();
 	Builtins::Numeric(*this).initialize();
 
     _definitions.freeze_as_builtin();
+	_definitions.printing.initialize(evaluation);
 
     assert(s_instance == nullptr);
     s_instance = this;
@@ -2,6 +2,9 @@
 // @formatter:off
 
 #include <thread>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
 
 template<typename T>
 class ConstSharedPtr;
@@ -9,73 +12,150 @@ class ConstSharedPtr;
 template<typename T>
 class UnsafeSharedPtr;
 
+// SharedPtr is a fully concurrent shared pointer, i.e. it may be read and written from
+// different threads at the same time. it's lock-free and uses split reference counts:
+
+// next to the pointer itself, m_state holds (1) the number of readers that are about
+// to acquire a reference to the object (see load()) and (2) a generation number that
+// changes with each store(). a writer that replaces an object hands over the pending
+// readers' references to the object's reference count before releasing its own, so
+// that the object stays alive until all pending readers hold a proper reference.
+
+// there can be no more pending readers than there are threads, so 8 bits suffice for
+// their count. the generation guards against a reader mistaking a newly stored pointer
+// for the one it started with (ABA). with 8 bits, it wraps after 256 store()s: a reader
+// that stalls between its fetch_add and its compare_exchange while exactly a multiple
+// of 256 stores happen, the last one storing its pointer again, would take the state
+// for its own and miscount references. this needs the reader to stall for hundreds of stores in a window of
+// a few instructions, which we accept in exchange for a single word of state.
+
+// the pointer needs to fit into 48 bits, as user space pointers on x86-64 and AArch64
+// with 4-level page tables do. this is checked on each store (also in builds without
+// asserts), and pointers that don't fit (e.g. with 5-level page tables or tagged
+// pointers) abort, as their top bits would otherwise silently get lost.
+
 template<typename T>
 class SharedPtr {
 protected:
-    mutable std::atomic_flag m_lock = ATOMIC_FLAG_INIT;
-	T *m_ptr;
+	static_assert(sizeof(uintptr_t) == 8, "SharedPtr needs 64 bit pointers");
+
+	static constexpr int PointerBits = 48;
+	static constexpr int GenerationBits = 8;
+
+	static constexpr uintptr_t PointerMask = (uintptr_t(1) << PointerBits) - 1;
+	static constexpr uintptr_t GenerationOne = uintptr_t(1) << PointerBits;
+	static constexpr uintptr_t GenerationMask = ((uintptr_t(1) << GenerationBits) - 1) << PointerBits;
+	static constexpr uintptr_t ReaderOne = uintptr_t(1) << (PointerBits + GenerationBits);
+	static constexpr uintptr_t ReaderMask = ~(PointerMask | GenerationMask);
+
+	mutable std::atomic<uintptr_t> m_state;
+
+	static inline T *pointer(uintptr_t state) {
+		return reinterpret_cast<T*>(state & PointerMask);
+	}
+
+	static inline size_t readers(uintptr_t state) {
+		return state >> (PointerBits + GenerationBits);
+	}
+
+	static inline uintptr_t checked_bits(T *ptr) {
+		const uintptr_t bits = uintptr_t(ptr);
+		if (__builtin_expect((bits & ~PointerMask) != 0, 0)) {
+			std::fprintf(stderr, "SharedPtr: pointer %p does not fit into %d bits\n",
+				static_cast<void*>(ptr), PointerBits);
+			std::abort();
+		}
+		return bits;
+	}
+
+	ConstSharedPtr<T> load() const {
+		const uintptr_t state = m_state.fetch_add(ReaderOne, std::memory_order_acquire);
+		T * const ptr = pointer(state);
+
+		const ConstSharedPtr<T> p(ptr); // must not throw
+
+		uintptr_t expected = state + ReaderOne;
+		while (true) {
+			if ((expected & ~ReaderMask) != (state & ~ReaderMask)) {
+				// a store() happened and handed our pending reference over to ptr's
+				// reference count; we already have our own, so drop that one.
+				if (ptr) {
+					intrusive_ptr_release(ptr);
+				}
+				break;
+			}
+			if (m_state.compare_exchange_weak(
+				expected, expected - ReaderOne, std::memory_order_relaxed)) {
+				break;
+			}
+		}
+
+		return p;
+	}
+
+	void store(T *ptr) {
+		const uintptr_t bits = checked_bits(ptr);
+
+		if (ptr) {
+			intrusive_ptr_add_ref(ptr);
+		}
+
+		uintptr_t old = m_state.load(std::memory_order_relaxed);
+		while (!m_state.compare_exchange_weak(
+			old,
+			bits | ((old + GenerationOne) & GenerationMask),
+			std::memory_order_acq_rel)) {
+		}
+
+		T * const old_ptr = pointer(old);
+		if (old_ptr) {
+			for (size_t i = readers(old); i > 0; i--) {
+				intrusive_ptr_add_ref(old_ptr);
+			}
+			intrusive_ptr_release(old_ptr);
+		}
+	}
 
 public:
-    SharedPtr() : m_ptr(nullptr) {
+    SharedPtr() : m_state(0) {
     }
 
-    SharedPtr(T *ptr) : m_ptr(ptr) {
+    SharedPtr(T *ptr) : m_state(checked_bits(ptr)) {
         if (ptr) {
             intrusive_ptr_add_ref(ptr);
         }
     }
 
-    SharedPtr(const SharedPtr &p) {
-        const ConstSharedPtr<T> const_p(p);
-        m_ptr = const_p.get();
-        if (m_ptr) {
-            intrusive_ptr_add_ref(m_ptr);
-        }
+    SharedPtr(const SharedPtr &p) : m_state(0) {
+        const ConstSharedPtr<T> const_p(p.load());
+        store(const_p.get());
     }
 
 	~SharedPtr() {
-		if (m_ptr) {
-			intrusive_ptr_release(m_ptr);
+		T * const ptr = pointer(m_state.load(std::memory_order_relaxed));
+		if (ptr) {
+			intrusive_ptr_release(ptr);
 		}
 	}
 
     operator ConstSharedPtr<T>() const {
-        while (true) {
-            if (m_lock.test_and_set(std::memory_order_acq_rel) == false) {
-                ConstSharedPtr<T> p(m_ptr); // must not throw
-                m_lock.clear(std::memory_order_release);
-                return p;
-            }
-        }
+        return load();
     }
 
     SharedPtr &operator=(T *ptr) {
-        if (ptr) {
-            intrusive_ptr_add_ref(ptr);
-        }
-        while (true) {
-            if (m_lock.test_and_set(std::memory_order_acq_rel) == false) {
-                T *old = m_ptr;
-                m_ptr = ptr;
-                m_lock.clear(std::memory_order_release);
-                if (old) {
-                    intrusive_ptr_release(old);
-                }
-                break;
-            }
-        }
+        store(ptr);
         return *this;
     }
 
     SharedPtr &operator=(const SharedPtr &p) {
-        const ConstSharedPtr<T> const_p(p);
-        *this = const_p.get();
+        const ConstSharedPtr<T> const_p(p.load());
+        store(const_p.get());
         return *this;
     }
 
     template<typename U>
     SharedPtr &operator=(const ConstSharedPtr<U> &p) {
-        *this = p.get();
+        store(p.get());
         return *this;
     }
 };
@@ -452,6 +532,8 @@ inline void intrusive_ptr_add_ref(const T *obj);
 template<typename T>
 inline void intrusive_ptr_release(const T *obj);
 
+class HashConsTable;
+
 class Shared { // similar to boost::intrusive_ref_counter
 protected:
     template<typename T>
@@ -460,8 +542,24 @@ protected:
     template<typename T>
     friend void ::intrusive_ptr_release(const T *obj);
 
+    friend class HashConsTable;
+
     mutable std::atomic<size_t> m_ref_count;
 
+    // increments the reference count, but only if the object is not already
+    // on its way to being destroyed, i.e. if the count is not 0. this allows
+    // tables with weak (i.e. non-counted) pointers to safely revive objects.
+    inline bool try_add_ref() const {
+        size_t count = m_ref_count.load(std::memory_order_relaxed);
+        while (count > 0) {
+            if (m_ref_count.compare_exchange_weak(
+                count, count + 1, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
 public:
     inline Shared() : m_ref_count(0) {
     }
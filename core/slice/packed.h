@@ -13,7 +13,7 @@ public:
     inline explicit PackExtent(const std::vector<U> &data) : m_data(data) {
     }
 
-    inline explicit PackExtent(std::vector<U> &&data) : m_data(data) {
+    inline explicit PackExtent(std::vector<U> &&data) : m_data(std::move(data)) {
     }
 
     inline const std::vector<U> &data() const {
@@ -78,11 +78,13 @@ public:
         assert(data.size() >= MinPackedSliceSize);
     }
 
+    // BaseSlice, as a base, is initialized first, i.e. takes the size before
+    // data is moved into the extent.
     inline PackedSlice(std::vector<U> &&data) :
-        _extent(PackExtent<U>::construct(data)),
+        _extent(PackExtent<U>::construct(std::move(data))),
         _begin(_extent->address()),
         BaseSlice(nullptr, data.size()) {
-        assert(data.size() >= MinPackedSliceSize);
+        assert(BaseSlice::m_size >= MinPackedSliceSize);
     }
 
     inline PackedSlice(const typename PackExtent<U>::Ref &extent, const U *begin, size_t size) :
@@ -141,6 +143,10 @@ public:
         return LeafCollection(_begin, size());
     }
 
+    inline const U *address() const {
+        return _begin;
+    }
+
     inline BaseExpressionRef operator[](size_t i) const;
 
     inline bool is_packed() const {
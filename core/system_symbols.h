@@ -45,6 +45,11 @@ SYMBOL(String)
 SYMBOL(Automatic)
 
 SYMBOL(LessEqual)
+SYMBOL(Less)
+SYMBOL(Greater)
+SYMBOL(GreaterEqual)
+SYMBOL(Equal)
+SYMBOL(Unequal)
 
 SYMBOL(Plus)
 SYMBOL(Times)
@@ -114,6 +119,9 @@ SYMBOL(LetterCharacter)
 SYMBOL(WordCharacter)
 SYMBOL(HexidecimalCharacter)
 
+SYMBOL(Number)
+SYMBOL(Word)
+
 SYMBOL(NumberForm)
 SYMBOL(NumberSigns)
 SYMBOL(ExponentStep)
@@ -153,6 +161,10 @@ SYMBOL(Positive)
 SYMBOL(NonPositive)
 SYMBOL(Negative)
 SYMBOL(NonNegative)
+SYMBOL(IntegerQ)
+SYMBOL(EvenQ)
+SYMBOL(OddQ)
+SYMBOL(MachineNumberQ)
 
 SYMBOL(Graphics)
 
@@ -160,4 +172,5 @@ SYMBOL(General)
 SYMBOL(MessageName)
 
 SYMBOL(StateLine)
-SYMBOL(StateModuleNumber)
\ No newline at end of file
+SYMBOL(StateModuleNumber)
+SYMBOL(StateFailed)
\ No newline at end of file
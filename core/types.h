@@ -7,6 +7,7 @@
 #include <stdint.h>
 #include <functional>
 #include <vector>
+#include <memory>
 #include <cstdlib>
 #include <cassert>
 
@@ -267,10 +268,18 @@ struct StyleBoxOptions {
     machine_real_t ImageSizeMultipliers[2];
 };
 
+void hash_cons_forget(const BaseExpression *expr);
+
 class BaseExpression : public virtual Shared {
 protected:
     const ExtendedType _extended_type;
 
+protected:
+	friend class HashConsTable;
+
+	// true if this instance is the canonical instance in the HashConsTable.
+	mutable std::atomic<bool> m_hash_consed;
+
 protected:
 	template<typename T>
 	friend inline SymbolicFormRef unsafe_symbolic_form(
@@ -304,12 +313,19 @@ public:
 		return m_symbolic_form; // might be active or passive or "no symbolic form"
 	}
 
-    inline BaseExpression(ExtendedType type) : _extended_type(type) {
+    inline BaseExpression(ExtendedType type) : _extended_type(type), m_hash_consed(false) {
     }
 
     virtual ~BaseExpression() {
+	    if (is_hash_consed()) {
+		    hash_cons_forget(this);
+	    }
     }
 
+	inline bool is_hash_consed() const {
+		return m_hash_consed.load(std::memory_order_relaxed);
+	}
+
     std::string debug(const Evaluation &evaluation) const;
 
 	virtual std::string debugform() const = 0;
@@ -457,6 +473,10 @@ public:
 		if (t == SymbolType) {
 			return false;
 		} else if (t == expr.type()) {
+			if (is_hash_consed() && expr.is_hash_consed()) {
+				// two different canonical instances are never the same.
+				return false;
+			}
 			return same_indeed(expr);
 		} else {
 			return false;
@@ -0,0 +1,178 @@
+// @formatter:off
+
+#include "../core/types.h"
+#include "../core/runtime.h"
+#include "../core/digits.h"
+#include "../tests/doctest.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+
+namespace {
+
+// the digits, exp and sign that real_to_s_exp takes from printf's text.
+std::string printf_reference(double x, int precision) {
+	char buffer[512];
+	if (precision >= 0) {
+		snprintf(buffer, sizeof(buffer), "%.*e", precision, x);
+	} else {
+		snprintf(buffer, sizeof(buffer), "%f", x);
+	}
+
+	std::string s(buffer);
+	const bool negative = s[0] == '-';
+	if (negative) {
+		s.erase(0, 1);
+	}
+
+	long exp;
+	std::string digits;
+	const size_t e = s.find('e');
+	if (e != std::string::npos) {
+		exp = std::stol(s.substr(e + 1));
+		digits = s.substr(0, 1) + (e > 1 ? s.substr(2, e - 2) : "");
+		while (digits.length() > 1 && digits.back() == '0') {
+			digits.pop_back();
+		}
+	} else {
+		const size_t point = s.find('.');
+		exp = long(point) - 1;
+		std::string fraction = s.substr(point + 1);
+		while (!fraction.empty() && fraction.back() == '0') {
+			fraction.pop_back();
+		}
+		digits = s.substr(0, point) + fraction;
+		size_t i = 0;
+		while (i < digits.length() && digits[i] == '0') {
+			i++;
+			exp--;
+		}
+		digits.erase(0, i);
+	}
+
+	return std::string(negative ? "-" : "") + digits + "e" + std::to_string(exp);
+}
+
+std::string digits_text(const RealDigits &d) {
+	return std::string(d.negative ? "-" : "") + std::string(d.digits, d.length) + "e" + std::to_string(d.exp);
+}
+
+std::vector<double> test_reals(size_t n) {
+	std::mt19937_64 random(11);
+	std::vector<double> values = {
+		0.0, -0.0, 1.0, -1.5, 0.1, 100.0, 1e23, 1e-7, 5e-7, 1.0000005, 0.0000015, 9.9999995,
+		123456.5, 8589934591.9999995, 5e-324, 2.2250738585072014e-308, 1.7976931348623157e308};
+
+	for (size_t i = 0; i < n; i++) {
+		double x;
+		const uint64_t bits = random();
+		std::memcpy(&x, &bits, sizeof(x));
+		values.push_back(x);
+
+		// decimals with few digits, and their neighbours, which round close to them.
+		const double y = double(random() % 10000000) * std::pow(10.0, int(random() % 30) - 15);
+		values.push_back(y);
+		values.push_back(std::nextafter(y, 0.0));
+		values.push_back(std::nextafter(y, HUGE_VAL));
+
+		values.push_back(double(i) / 3);
+	}
+
+	return values;
+}
+
+} // namespace
+
+TEST_CASE("integer text") {
+	std::mt19937_64 random(3);
+	char buffer[MaxIntegerDigits + 1];
+
+	const int64_t special[] = {0, 9, 10, -99, 100, std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max()};
+	for (const int64_t x : special) {
+		CHECK(std::string(buffer, integer_text(buffer, x)) == std::to_string(x));
+	}
+
+	for (int i = 0; i < 100000; i++) {
+		const int64_t x = int64_t(random()) >> (random() % 64);
+		CHECK(std::string(buffer, integer_text(buffer, x)) == std::to_string(x));
+	}
+}
+
+TEST_CASE("shortest digits") {
+	for (const double x : test_reals(20000)) {
+		if (x == 0 || !std::isfinite(x)) {
+			continue;
+		}
+
+		// the first number of digits that reads back as x.
+		char buffer[64];
+		int precision = 0;
+		for (; precision < 17; precision++) {
+			snprintf(buffer, sizeof(buffer), "%.*e", precision, x);
+			if (std::strtod(buffer, nullptr) == x) {
+				break;
+			}
+		}
+
+		RealDigits d;
+		shortest_digits(x, d);
+		CHECK(digits_text(d) == printf_reference(x, precision));
+	}
+}
+
+TEST_CASE("printf digits") {
+	size_t fallbacks = 0;
+	size_t checks = 0;
+
+	for (const double x : test_reals(20000)) {
+		for (int precision = -1; precision <= 15; precision++) {
+			RealDigits d;
+			checks++;
+			if (printf_digits(x, precision, d)) {
+				CHECK(digits_text(d) == printf_reference(x, precision));
+			} else {
+				fallbacks++;
+			}
+		}
+	}
+
+	CHECK(fallbacks < checks / 8);
+}
+
+TEST_CASE("print packed reals") {
+	Runtime * const runtime = Runtime::get();
+	const auto output = std::make_shared<TestOutput>();
+	Evaluation evaluation(output, runtime->definitions(), false);
+
+	const auto printed = [&evaluation] (const BaseExpressionRef &expr, PrintForm form) {
+		std::string text;
+		Printer printer(text, evaluation);
+		printer(expr.get(), form, StringCharacters::Shown);
+		return text;
+	};
+
+	const auto boxes = [&evaluation] (const BaseExpressionRef &expr, const BaseExpressionRef &form) {
+		return expression(evaluation.MakeBoxes, expr, form)->evaluate_or_copy(evaluation)->
+			boxes_to_text(StyleBoxOptions(), evaluation);
+	};
+
+	const ExpressionRef small = expression(evaluation.List, PackedSlice<machine_real_t>(test_reals(200)));
+
+	CHECK(printed(small, PrintForm::OutputForm) == boxes(small, BaseExpressionRef(evaluation.OutputForm)));
+	CHECK(printed(small, PrintForm::InputForm) == boxes(small, BaseExpressionRef(evaluation.InputForm)));
+	CHECK(printed(small, PrintForm::FullForm) == boxes(small, BaseExpressionRef(evaluation.FullForm)));
+
+	std::vector<machine_real_t> values(10000);
+	for (size_t i = 0; i < values.size(); i++) {
+		values[i] = machine_real_t(i) / 3;
+	}
+	const ExpressionRef large = expression(evaluation.List, PackedSlice<machine_real_t>(std::move(values)));
+
+	const std::string text = printed(large, PrintForm::OutputForm);
+
+	CHECK(text.compare(0, 23, "{0., 0.333333, 0.666667") == 0);
+	CHECK(text == boxes(large, BaseExpressionRef(evaluation.OutputForm)));
+}
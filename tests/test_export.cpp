@@ -0,0 +1,140 @@
+// @formatter:off
+
+#include "../core/types.h"
+#include "../core/runtime.h"
+#include "../core/import.h"
+#include "../core/export.h"
+#include "../tests/doctest.h"
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+namespace {
+
+std::string read_file(const char *path) {
+	const MappedFile file(path);
+	REQUIRE(file.is_open());
+	return std::string(file.data(), file.size());
+}
+
+} // namespace
+
+TEST_CASE("write full form") {
+	Runtime * const runtime = Runtime::get();
+	const auto output = std::make_shared<TestOutput>();
+	Evaluation evaluation(output, runtime->definitions(), false);
+
+	const char *path = "/tmp/cmathics_test_export.m";
+
+	{
+		FileWriter out(path);
+		REQUIRE(out.is_open());
+		std::string text;
+		Printer printer(text, evaluation, &out);
+		printer(runtime->parse("f[g[x][y, \"a\\\"b\"], {1, 2}]").get(), PrintForm::FullForm, StringCharacters::Escaped);
+		REQUIRE(out.close());
+	}
+	CHECK(read_file(path) == "f[g[x][y, \"a\\\"b\"], List[1, 2]]");
+
+	// deep nesting is written without recursion.
+
+	const size_t depth = 20000;
+	UnsafeBaseExpressionRef nested = MachineInteger::construct(0);
+	for (size_t i = 0; i < depth; i++) {
+		nested = expression(evaluation.List, BaseExpressionRef(nested));
+	}
+
+	{
+		FileWriter out(path);
+		std::string text;
+		Printer printer(text, evaluation, &out);
+		printer(nested.get(), PrintForm::FullForm, StringCharacters::Escaped);
+		REQUIRE(out.close());
+	}
+	const std::string text = read_file(path);
+	CHECK(text.size() == depth * 6 + 1);
+	CHECK(text.compare(0, 10, "List[List[") == 0);
+
+	std::remove(path);
+}
+
+TEST_CASE("write table") {
+	Runtime * const runtime = Runtime::get();
+	const auto output = std::make_shared<TestOutput>();
+	Evaluation evaluation(output, runtime->definitions(), false);
+
+	const char *path = "/tmp/cmathics_test_export.csv";
+
+	{
+		FileWriter out(path);
+		write_table(out, runtime->parse("{{1, \"a,b\"}, {\"say \\\"hi\\\"\", x}, 7}").get(), ',', evaluation);
+		REQUIRE(out.close());
+	}
+	CHECK(read_file(path) == "1,\"a,b\"\n\"say \"\"hi\"\"\",x\n7\n");
+
+	// a large packed matrix, written and parsed again.
+
+	const size_t rows = 2000;
+	std::mt19937_64 random(5);
+	std::vector<machine_integer_t> first(rows);
+	for (size_t i = 0; i < rows; i++) {
+		first[i] = machine_integer_t(random() >> 1) - (machine_integer_t(1) << 61);
+	}
+
+	const ExpressionRef matrix = expression(evaluation.List, sequential([&first, &evaluation] (auto &store) {
+		for (size_t i = 0; i < rows; i++) {
+			store(expression(evaluation.List, PackedSlice<machine_integer_t>(
+				std::vector<machine_integer_t>(MinPackedSliceSize, first[i]))));
+		}
+	}, rows));
+
+	{
+		FileWriter out(path);
+		write_table(out, matrix.get(), ',', evaluation);
+		REQUIRE(out.close());
+	}
+
+	const MappedFile file(path);
+	const Table table = parse_table(file.data(), file.size(), ',', evaluation);
+	REQUIRE(table.rows() == rows);
+	REQUIRE(table.columns.size() == MinPackedSliceSize);
+	CHECK(table.columns[0].integers == first);
+	CHECK(table.columns[MinPackedSliceSize - 1].integers == first);
+
+	std::remove(path);
+}
+
+TEST_CASE("write binary") {
+	const char *path = "/tmp/cmathics_test_export.bin";
+
+	std::vector<machine_real_t> values(1 << 20);
+	for (size_t i = 0; i < values.size(); i++) {
+		values[i] = machine_real_t(i) / 3;
+	}
+	const std::vector<machine_real_t> copy(values);
+
+	const ExpressionRef list = expression(
+		Runtime::get()->evaluation().List, PackedSlice<machine_real_t>(std::move(values)));
+
+	BaseExpressionRef failed;
+	{
+		FileWriter out(path);
+		REQUIRE(write_binary(out, list.get(), "Real64", failed));
+		REQUIRE(out.close());
+	}
+	{
+		const MappedFile file(path);
+		REQUIRE(file.size() == copy.size() * sizeof(machine_real_t));
+		CHECK(std::memcmp(file.data(), copy.data(), file.size()) == 0);
+	}
+
+	{
+		FileWriter out(path);
+		CHECK(!write_binary(out, list.get(), "Integer32", failed)); // reals are not integers
+		CHECK(failed->is_machine_real());
+		CHECK(!write_binary(out, list.get(), "Real128", failed));
+	}
+
+	std::remove(path);
+}
@@ -0,0 +1,82 @@
+// @formatter:off
+
+#include "../core/types.h"
+#include "../core/runtime.h"
+#include "../tests/doctest.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+// measures how well hash() spreads structurally similar keys, as they typically
+// occur in rule tables (f[1], f[2], ...) and Tally-like workloads (many similar
+// strings or big integers). we look at both full 64-bit collisions and at the
+// maximum load of a power-of-two table that only uses the lowest bits.
+
+template<typename Generate>
+void check_distribution(const Generate &generate) {
+	constexpr size_t n = 1 << 16;
+
+	std::vector<BaseExpressionRef> items;
+	items.reserve(n);
+	for (size_t i = 0; i < n; i++) {
+		items.emplace_back(generate(i));
+	}
+
+	std::vector<hash_t> hashes;
+	hashes.reserve(n);
+	for (const auto &item : items) {
+		hashes.push_back(item->hash());
+	}
+
+	std::unordered_set<hash_t> distinct(hashes.begin(), hashes.end());
+
+	std::vector<size_t> buckets(n);
+	for (const hash_t h : hashes) {
+		buckets[h & (n - 1)]++;
+	}
+	const size_t max_load = *std::max_element(buckets.begin(), buckets.end());
+
+	CHECK(distinct.size() == n);
+	CHECK(max_load <= 16); // about 8 is expected for a random function
+}
+
+TEST_CASE("hash distribution") {
+	Runtime * const runtime = Runtime::get();
+	auto &definitions = runtime->definitions();
+
+	const SymbolRef f = definitions.lookup("Global`f");
+	const SymbolRef g = definitions.lookup("Global`g");
+
+	// f[i]
+	check_distribution([&f] (size_t i) {
+		return expression(f, MachineInteger::construct(machine_integer_t(i)));
+	});
+
+	// f[g[i / 256], i % 256]
+	check_distribution([&f, &g] (size_t i) {
+		return expression(f,
+			expression(g, MachineInteger::construct(machine_integer_t(i / 256))),
+			MachineInteger::construct(machine_integer_t(i % 256)));
+	});
+
+	// strings
+	check_distribution([] (size_t i) {
+		return String::construct(std::string("x") + std::to_string(i));
+	});
+
+	// long strings
+	check_distribution([] (size_t i) {
+		return String::construct(std::string(100, 'a') + std::to_string(i));
+	});
+
+	// big integers
+	check_distribution([] (size_t i) {
+		mpz_class value(1);
+		value <<= 200;
+		value += i / 2;
+		if (i % 2) {
+			value = -value;
+		}
+		return BigInteger::construct(value);
+	});
+}
@@ -0,0 +1,140 @@
+// @formatter:off
+
+#include "../core/types.h"
+#include "../core/runtime.h"
+#include "../core/import.h"
+#include "../tests/doctest.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+
+TEST_CASE("scan numbers") {
+	const auto integer = [] (const char *s, machine_integer_t &x) {
+		return scan_integer(s, s + strlen(s), x);
+	};
+
+	machine_integer_t x;
+	CHECK(integer(" -12 ", x));
+	CHECK(x == -12);
+	CHECK(integer("9223372036854775807", x));
+	CHECK(x == 9223372036854775807LL);
+	CHECK(integer("-9223372036854775808", x));
+	CHECK(!integer("9223372036854775808", x));
+	CHECK(!integer("1.0", x));
+	CHECK(!integer("-", x));
+	CHECK(!integer("", x));
+
+	// scan_real() needs to round exactly like strtod().
+
+	std::mt19937_64 random(7);
+	for (int i = 0; i < 100000; i++) {
+		char text[64];
+		double y;
+		const uint64_t bits = random();
+		std::memcpy(&y, &bits, sizeof(y));
+		if (!std::isfinite(y)) {
+			continue;
+		}
+		snprintf(text, sizeof(text), "%.*g", int(random() % 17) + 1, y);
+
+		machine_real_t z;
+		REQUIRE(scan_real(text, text + strlen(text), z));
+		CHECK(z == std::strtod(text, nullptr));
+	}
+
+	machine_real_t z;
+	const char *bad[] = {".", "1e", "e5", "1.2.3", "--1", "nan"};
+	for (const char *s : bad) {
+		CHECK(!scan_real(s, s + strlen(s), z));
+	}
+}
+
+TEST_CASE("split chunks") {
+	std::string text;
+	for (int i = 0; i < 100000; i++) {
+		text.append(std::to_string(i));
+		text.append(i % 10 == 9 ? "\n" : ",");
+	}
+
+	const auto bounds = split_chunks(text.data(), text.size(), 4096, "\n");
+	CHECK(bounds.front() == 0);
+	CHECK(bounds.back() == text.size());
+	CHECK(bounds.size() > 100);
+	for (size_t i = 1; i + 1 < bounds.size(); i++) {
+		CHECK(text[bounds[i] - 1] == '\n');
+	}
+}
+
+TEST_CASE("parse table") {
+	auto &definitions = Runtime::get()->definitions();
+	const auto output = std::make_shared<TestOutput>();
+	Evaluation evaluation(output, definitions, false);
+
+	const auto table = [&evaluation] (const char *text, char separator) {
+		return parse_table(text, strlen(text), separator, evaluation);
+	};
+
+	const Table numbers = table("1,2.5\n3,4\r\n\n5,6", ',');
+	REQUIRE(numbers.rows() == 3);
+	REQUIRE(numbers.columns.size() == 2);
+	CHECK(numbers.columns[0].type == TableColumn::Integer);
+	CHECK((numbers.columns[0].integers == std::vector<machine_integer_t>{1, 3, 5}));
+	CHECK(numbers.columns[1].type == TableColumn::Real);
+	CHECK((numbers.columns[1].reals == std::vector<machine_real_t>{2.5, 4, 6}));
+
+	const Table quoted = table("a,\"b,\"\"c\"\"\nd\"\n1,2,3\n", ',');
+	REQUIRE(quoted.rows() == 2);
+	REQUIRE(quoted.columns.size() == 3);
+	CHECK((quoted.widths == std::vector<uint32_t>{2, 3}));
+	CHECK(quoted.columns[1].text == "b,\"c\"\nd2");
+	CHECK(quoted.columns[2].type == TableColumn::General); // missing in the first row
+
+	const Table blanks = table("  1 2\t3\n4   5 6 \n", ' ');
+	REQUIRE(blanks.columns.size() == 3);
+	CHECK((blanks.columns[2].integers == std::vector<machine_integer_t>{3, 6}));
+
+	// a file of several chunks (of at least 1 MB each), in which a single field
+	// far from the start turns a column General, so that all chunks before need
+	// to read that column again.
+
+	const char *path = "/tmp/cmathics_test_import.csv";
+	size_t rows = 0;
+	{
+		std::ofstream file(path);
+		std::mt19937 random(3);
+		size_t size = 0;
+		while (size < (4 << 20)) {
+			std::string line = std::to_string(rows) + "," +
+				std::to_string(random() % 100000) + "." + std::to_string(random() % 100) + "," +
+				(rows == 100000 ? std::string("n/a") : std::to_string(random() % 1000)) + "\n";
+			file << line;
+			size += line.size();
+			rows++;
+		}
+	}
+
+	const MappedFile file(path);
+	REQUIRE(file.is_open());
+	const Table large = parse_table(file.data(), file.size(), ',', evaluation);
+
+	REQUIRE(large.rows() == rows);
+	REQUIRE(large.columns.size() == 3);
+	CHECK(large.columns[0].type == TableColumn::Integer);
+	CHECK(large.columns[1].type == TableColumn::Real);
+	CHECK(large.columns[2].type == TableColumn::General);
+	for (size_t i = 0; i < rows; i++) {
+		if (large.columns[0].integers[i] != machine_integer_t(i)) {
+			CHECK(large.columns[0].integers[i] == machine_integer_t(i));
+			break;
+		}
+	}
+
+	const TableColumn &general = large.columns[2];
+	const size_t begin = general.ends[99999];
+	CHECK(general.text.substr(begin, general.ends[100000] - begin) == "n/a");
+
+	std::remove(path);
+}
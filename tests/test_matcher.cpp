@@ -4,6 +4,9 @@
 #include "../core/runtime.h"
 #include "../tests/doctest.h"
 
+#include <functional>
+#include <sstream>
+
 TEST_CASE("match nested") {
     Runtime * const runtime = Runtime::get();
 
@@ -32,3 +35,298 @@ TEST_CASE("match nested") {
     auto z_expected = runtime->parse("Sequence[9, 10]");
     CHECK((*z_ptr)->same(z_expected));
 }
+
+TEST_CASE("match hash") {
+	Runtime * const runtime = Runtime::get();
+
+	// for non-patterns, match_hash() must agree with the (cached) hash().
+	for (const char *s : {"f[g[1, 2.5], \"x\", {1, 2, 3}]", "a + b^2", "f[f[f[]]]"}) {
+		const auto item = runtime->parse(s);
+		const hash_t h = item->hash();
+		CHECK(item->hash() == h);
+		const auto match_hash = item->match_hash();
+		CHECK(bool(match_hash) == true);
+		CHECK(*match_hash == h);
+	}
+
+	for (const char *s : {"f[x_]", "f[g[1, 2], x__]", "f[1 | 2]"}) {
+		const auto pattern = runtime->parse(s);
+		CHECK(bool(pattern->match_hash()) == false);
+		CHECK(bool(pattern->match_hash()) == false);
+	}
+}
+
+TEST_CASE("pathological patterns") {
+	Runtime * const runtime = Runtime::get();
+
+	const auto no_output = std::make_shared<NoOutput>();
+	Evaluation evaluation(no_output, runtime->definitions(), false);
+
+	// without memoizing failed states in SequenceMatcher, these take time
+	// O(n^3) or worse, as every split of the subject is tried.
+
+	const std::tuple<const char*, const char*, bool> cases[] = {
+		std::make_tuple("{a___, x_, b___, x_, c___}", "", false),
+		std::make_tuple("{a___, x_, b___, x_, c___}", ", 7", true),
+		std::make_tuple("{a___, b___, c___, d___, 0}", "", false),
+		std::make_tuple("{a___, b__, c___, d__, e___, 0}", "", false),
+		std::make_tuple("{a___, b___, c___, d___, 0}", ", 0", true)
+	};
+
+	for (const size_t n : {50, 100}) {
+		std::ostringstream s;
+		s << "{";
+		for (size_t i = 1; i <= n; i++) {
+			if (i > 1) {
+				s << ", ";
+			}
+			s << i;
+		}
+
+		for (const auto &c : cases) {
+			const auto pattern = runtime->parse(std::get<0>(c));
+			const auto item = runtime->parse(s.str() + std::get<1>(c) + "}");
+
+			const Matcher matcher(pattern, runtime->evaluation());
+			CHECK(bool(matcher(item, evaluation)) == std::get<2>(c));
+		}
+	}
+}
+
+TEST_CASE("memoized flat patterns") {
+	Runtime * const runtime = Runtime::get();
+
+	const auto no_output = std::make_shared<NoOutput>();
+	Evaluation evaluation(no_output, runtime->definitions(), false);
+
+	runtime->parse("SetAttributes[memoflat, Flat]")->evaluate_or_copy(evaluation);
+
+	// for each split, the inner memoflat is matched against a temporary
+	// memoflat[...] of the leaves in between. a temporary that contains the 0
+	// might get the address of an earlier one of the same size that did not,
+	// which must not make the memo report a failure.
+
+	std::ostringstream s;
+	s << "memoflat[";
+	for (size_t i = 0; i < 40; i++) {
+		s << "1, ";
+	}
+	s << "0]";
+
+	const auto pattern = runtime->parse("memoflat[a___, memoflat[x___, 0, y___], b___] /; Length[{a}] >= 3");
+	const auto item = runtime->parse(s.str());
+
+	const Matcher matcher(pattern, runtime->evaluation());
+	CHECK(bool(matcher(item, evaluation)) == true);
+}
+
+TEST_CASE("attributes set after compiling") {
+	Runtime * const runtime = Runtime::get();
+
+	const auto no_output = std::make_shared<NoOutput>();
+	Evaluation evaluation(no_output, runtime->definitions(), false);
+
+	runtime->parse("SetAttributes[laterouter, Orderless]")->evaluate_or_copy(evaluation);
+
+	// compiled matchers are cached and reused, so making laterinner Orderless
+	// must be seen by a matcher that was compiled before.
+
+	const auto pattern = runtime->parse("laterouter[x_, laterinner[a, b]]");
+	const Matcher matcher(pattern, runtime->evaluation());
+
+	CHECK(bool(matcher(runtime->parse("laterouter[laterinner[a, b], 1]"), evaluation)) == true);
+	CHECK(bool(matcher(runtime->parse("laterouter[laterinner[b, a], 1]"), evaluation)) == false);
+
+	runtime->parse("SetAttributes[laterinner, Orderless]")->evaluate_or_copy(evaluation);
+
+	CHECK(bool(matcher(runtime->parse("laterouter[laterinner[b, a], 1]"), evaluation)) == true);
+}
+
+TEST_CASE("native predicates") {
+	Runtime * const runtime = Runtime::get();
+
+	const auto no_output = std::make_shared<NoOutput>();
+	Evaluation evaluation(no_output, runtime->definitions(), false);
+
+	// the results must be the same whether NativePredicate decides them or
+	// whether they need an evaluation (e.g. Pi > 3 or 2. == 2).
+
+	const std::tuple<const char*, const char*, bool> cases[] = {
+		std::make_tuple("x_ /; x > 0", "5", true),
+		std::make_tuple("x_ /; x > 0", "-5", false),
+		std::make_tuple("x_ /; x > 0", "a", false),
+		std::make_tuple("x_ /; 0 < x", "1.5", true),
+		std::make_tuple("x_ /; x == 2", "2", true),
+		std::make_tuple("x_ /; x == 2", "2.", true),
+		std::make_tuple("x_ /; EvenQ[x]", "7", false),
+		std::make_tuple("_?(# > 3 &)", "4", true),
+		std::make_tuple("_?(3 >= # &)", "4", false),
+		std::make_tuple("_?(# > 3 &)", "Pi", true),
+		std::make_tuple("_?OddQ", "1000000000000000000000000000001", true),
+		std::make_tuple("_?IntegerQ", "1.", false),
+		std::make_tuple("_?MachineNumberQ", "1.5", true),
+		std::make_tuple("_?MachineNumberQ", "1", false),
+		std::make_tuple("x_ /; x > 9007199254740992.", "9007199254740993", false), // rounded to 2^53
+		std::make_tuple("x_ /; x < 9223372036854775807.", "9223372036854775807", false),
+		std::make_tuple("x_ /; 9223372036854775807 >= x", "9223372036854775807.", true)
+	};
+
+	for (const auto &c : cases) {
+		const auto pattern = runtime->parse(std::get<0>(c));
+		const auto item = runtime->parse(std::get<1>(c));
+
+		const Matcher matcher(pattern, runtime->evaluation());
+		const MatchRef m = matcher(item, evaluation);
+
+		CHECK(bool(m) == std::get<2>(c));
+	}
+}
+
+TEST_CASE("packed matching") {
+	Runtime * const runtime = Runtime::get();
+
+	const auto no_output = std::make_shared<NoOutput>();
+	Evaluation evaluation(no_output, runtime->definitions(), false);
+
+	const auto run = [runtime, &evaluation] (const std::string &s) {
+		return runtime->parse(s.c_str())->evaluate_or_copy(evaluation);
+	};
+
+	constexpr machine_integer_t n = 1000;
+	run("packedrange = Range[-1000, 1000];");
+
+	const std::tuple<const char*, std::function<bool(machine_integer_t)>> cases[] = {
+		std::make_tuple("_Integer", [] (machine_integer_t x) { return true; }),
+		std::make_tuple("_Real", [] (machine_integer_t x) { return false; }),
+		std::make_tuple("_?Positive", [] (machine_integer_t x) { return x > 0; }),
+		std::make_tuple("5", [] (machine_integer_t x) { return x == 5; }),
+		std::make_tuple("5.", [] (machine_integer_t x) { return false; }),
+		std::make_tuple("_?(# > 3 &)", [] (machine_integer_t x) { return x > 3; }),
+		std::make_tuple("x_ /; x < -7", [] (machine_integer_t x) { return x < -7; }),
+		std::make_tuple("_Integer?OddQ", [] (machine_integer_t x) { return (x & 1) != 0; })
+	};
+
+	for (const auto &c : cases) {
+		const auto result = run(std::string("Cases[packedrange, ") + std::get<0>(c) + "]");
+
+		std::vector<machine_integer_t> expected;
+		for (machine_integer_t x = -n; x <= n; x++) {
+			if (std::get<1>(c)(x)) {
+				expected.push_back(x);
+			}
+		}
+
+		REQUIRE(result->is_expression());
+		const Expression * const list = result->as_expression();
+		REQUIRE(list->size() == expected.size());
+		for (size_t i = 0; i < expected.size(); i++) {
+			CHECK(list->leaf(i)->same(*MachineInteger::construct(expected[i])));
+		}
+	}
+
+	CHECK(run("Length[Select[packedrange, # > 3 &]]")->same(*MachineInteger::construct(n - 3)));
+	CHECK(run("MatchQ[packedrange, {__Integer}]")->is_true());
+	CHECK(!run("MatchQ[packedrange, {__Real}]")->is_true());
+}
+
+TEST_CASE("string automaton") {
+	Runtime * const runtime = Runtime::get();
+
+	const auto no_output = std::make_shared<NoOutput>();
+	Evaluation evaluation(no_output, runtime->definitions(), false);
+
+	const auto run = [runtime, &evaluation] (const std::string &s) {
+		return runtime->parse(s.c_str())->evaluate_or_copy(evaluation);
+	};
+
+	const std::tuple<const char*, const char*> cases[] = {
+		std::make_tuple("StringCases[\"a1b22c333\", DigitCharacter..]", "{\"1\", \"22\", \"333\"}"),
+		std::make_tuple("StringCases[\"x=1, y=22\", v:LetterCharacter ~~ \"=\" ~~ DigitCharacter.. :> v]", "{\"x\", \"y\"}"),
+		std::make_tuple("StringCases[\"aabaaab\", Shortest[\"a\" ~~ __ ~~ \"b\"]]", "{\"aab\", \"aaab\"}"),
+		std::make_tuple("StringCases[\"aabaaab\", \"a\" ~~ __ ~~ \"b\"]", "{\"aabaaab\"}"),
+		std::make_tuple("StringReplace[\"GET /a PUT /b POST /c\", (\"GET\" | \"PUT\") ~~ \" \" -> \"\"]", "\"/a /b POST /c\""),
+		std::make_tuple("StringMatchQ[\"a  b\", \"a\" ~~ Whitespace ~~ \"b\"]", "True"),
+		std::make_tuple("StringMatchQ[\"aba\", \"a\" ~~ __ ~~ \"a\"]", "True"),
+		std::make_tuple("StringMatchQ[\"ab\", \"a\" ~~ __ ~~ \"a\"]", "False"),
+		std::make_tuple("StringMatchQ[\"ABC\", \"abc\", IgnoreCase -> True]", "True")
+	};
+
+	for (const auto &c : cases) {
+		const auto result = run(std::get<0>(c));
+		CHECK(result->same(*runtime->parse(std::get<1>(c))));
+	}
+
+	// a scaled down version of log parsing, i.e. extracting the message of
+	// every error line.
+
+	constexpr size_t n_lines = 1000;
+	std::ostringstream log;
+	for (size_t i = 0; i < n_lines; i++) {
+		log << "2016-03-01 12:00:" << (i % 60) << (i % 10 == 0 ? " ERROR: " : " INFO: ") <<
+			"request " << i << " done\n";
+	}
+
+	const auto cases_function = runtime->parse(
+		"StringCases[#, \"ERROR: \" ~~ Shortest[message__] ~~ \"\\n\" :> message]&");
+
+	const auto messages = expression(cases_function, String::construct(log.str()))->evaluate_or_copy(evaluation);
+
+	REQUIRE(messages->is_expression());
+	REQUIRE(messages->as_expression()->size() == n_lines / 10);
+	CHECK(messages->as_expression()->leaf(1)->same(*String::construct("request 10 done")));
+}
+
+TEST_CASE("literal string replace") {
+	Runtime * const runtime = Runtime::get();
+
+	const auto no_output = std::make_shared<NoOutput>();
+	Evaluation evaluation(no_output, runtime->definitions(), false);
+
+	// a normalization table of a few hundred literals, some of them being
+	// prefixes or suffixes of others.
+
+	std::vector<std::tuple<std::string, std::string>> rules;
+	for (int i = 0; i < 300; i++) {
+		rules.push_back(std::make_tuple(std::string("w") + std::to_string(i * 7 % 300), std::to_string(i)));
+	}
+	rules.push_back(std::make_tuple("9 w", "_"));
+
+	std::ostringstream list;
+	list << "{";
+	for (size_t i = 0; i < rules.size(); i++) {
+		if (i > 0) {
+			list << ", ";
+		}
+		list << "\"" << std::get<0>(rules[i]) << "\" -> \"" << std::get<1>(rules[i]) << "\"";
+	}
+	list << "}";
+
+	std::ostringstream text;
+	for (int i = 0; i < 2000; i++) {
+		text << "w" << (i * 31 % 1000) << " ";
+	}
+
+	// replace at each position with the first rule that matches there.
+	const std::string s = text.str();
+	std::string expected;
+	for (size_t i = 0; i < s.size(); ) {
+		bool replaced = false;
+		for (const auto &rule : rules) {
+			const std::string &key = std::get<0>(rule);
+			if (s.compare(i, key.size(), key) == 0) {
+				expected.append(std::get<1>(rule));
+				i += key.size();
+				replaced = true;
+				break;
+			}
+		}
+		if (!replaced) {
+			expected.push_back(s[i++]);
+		}
+	}
+
+	const auto replace = runtime->parse((std::string("StringReplace[#, ") + list.str() + "]&").c_str());
+
+	const auto result = expression(replace, String::construct(s))->evaluate_or_copy(evaluation);
+	CHECK(result->same(*String::construct(expected)));
+}
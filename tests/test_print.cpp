@@ -0,0 +1,87 @@
+// @formatter:off
+
+#include "../core/types.h"
+#include "../core/runtime.h"
+#include "../tests/doctest.h"
+
+namespace {
+
+std::string boxes_text(const BaseExpressionRef &expr, const Evaluation &evaluation) {
+	return expr->make_boxes(evaluation.OutputForm, evaluation)->boxes_to_text(StyleBoxOptions(), evaluation);
+}
+
+std::string printed_text(const BaseExpressionRef &expr, const Evaluation &evaluation) {
+	std::string text;
+	Printer printer(text, evaluation);
+	printer.output(expr.get());
+	return text;
+}
+
+} // namespace
+
+TEST_CASE("print as boxes") {
+	Runtime * const runtime = Runtime::get();
+	const auto output = std::make_shared<TestOutput>();
+	Evaluation evaluation(output, runtime->definitions(), false);
+
+	const char *inputs[] = {
+		"f[x, {1, 2.5, -3, \"s\"}, g[h][y], {}]",
+		"{a == b, a -> b + c, {x -> 1, y :> 2}, a | b | c, a <> b}",
+		"Infix[{a, b}, \"~\", 100, None] == c",
+		"f[HoldForm[Infix[{a, b}, \"~\", 1000, None]] -> c]",
+		"FullForm[f[a + b * c, {1, \"s\"}]]",
+		"InputForm[{1 / 2, \"s\", x ^ 2, 1.5}]",
+		"InputForm[\"s\"]",
+		"Row[{\"a\", 1, {x, \"b\"}}]",
+		"f[HoldForm[1 + 1], NumberForm[2.5, 10], FullForm[\"s\"], InputForm[{\"t\"}]]",
+		"f[x_, y__, z___, _Integer]",
+		"{2 / 3, 2 + 3 I, 1.5, 10^20, 1.5 * 10^30, -x}",
+		"Rule[a] + Rule[a, b, c] + Equal[a] + Equal[]",
+		"f[a][b][c, {d}]",
+		"\"a\\\"b\""
+	};
+
+	for (const char *input : inputs) {
+		const BaseExpressionRef parsed = runtime->parse(input);
+		CHECK(printed_text(parsed, evaluation) == boxes_text(parsed, evaluation));
+
+		const BaseExpressionRef evaluated = parsed->evaluate_or_copy(evaluation);
+		CHECK(printed_text(evaluated, evaluation) == boxes_text(evaluated, evaluation));
+	}
+
+	std::string text;
+	Printer printer(text, evaluation);
+	printer(runtime->parse("f[{1, \"a\\\"b\"}, x -> 2]").get(), PrintForm::FullForm, StringCharacters::Escaped);
+	CHECK(text == "f[List[1, \"a\\\"b\"], Rule[x, 2]]");
+}
+
+TEST_CASE("print large lists") {
+	Runtime * const runtime = Runtime::get();
+	const auto output = std::make_shared<TestOutput>();
+	Evaluation evaluation(output, runtime->definitions(), false);
+
+	const auto mixed = [&evaluation] (size_t n) {
+		return expression(evaluation.List, sequential([n, &evaluation] (auto &store) {
+			for (size_t i = 0; i < n; i++) {
+				switch (i % 3) {
+					case 0:
+						store(MachineInteger::construct(i));
+						break;
+					case 1:
+						store(expression(evaluation.Rule, evaluation.True, String::construct("s")));
+						break;
+					default:
+						store(BaseExpressionRef(evaluation.Null));
+						break;
+				}
+			}
+		}, n));
+	};
+
+	const ExpressionRef list = mixed(10000);
+	const std::string text = printed_text(list, evaluation);
+
+	CHECK(text == boxes_text(list, evaluation));
+	CHECK(text.compare(0, 16, "{0, True -> s, N") == 0);
+	CHECK(text.back() == '}');
+}
@@ -0,0 +1,167 @@
+// @formatter:off
+
+#include "../core/types.h"
+#include "../core/runtime.h"
+#include "../tests/doctest.h"
+
+#include <sstream>
+
+// memoized recursion leaves one exact rule (like memo[123] = 123) per call;
+// looking these up should not depend on how many there are.
+
+TEST_CASE("memo table") {
+	Runtime * const runtime = Runtime::get();
+	const auto output = std::make_shared<TestOutput>();
+	Evaluation evaluation(output, runtime->definitions(), false);
+
+	const auto run = [runtime, &evaluation] (const std::string &s) {
+		return runtime->parse(s.c_str())->evaluate_or_copy(evaluation);
+	};
+
+	size_t k = 0;
+	for (const size_t n : {100, 1000}) {
+		const std::string f = "memo" + std::to_string(k++);
+		const std::string table = "Table[" + f + "[i], {i, 1, " + std::to_string(n) + "}]";
+
+		run(f + "[0] = 0");
+		run(f + "[n_] := " + f + "[n] = " + f + "[n - 1] + 1");
+
+		run(table);
+		const BaseExpressionRef result = run(table);
+
+		CHECK(result->is_expression());
+		CHECK(result->as_expression()->size() == n);
+		CHECK(result->as_expression()->leaf(n - 1)->same(*MachineInteger::construct(machine_integer_t(n))));
+	}
+
+	// a left hand side without patterns still matches more than same()
+	// expressions if it contains Orderless or Flat heads.
+	run("SetAttributes[memoheld, HoldAll]");
+	run("SetAttributes[memoorderless, Orderless]");
+	run("memoheld[memoorderless[b, a]] = 1");
+	CHECK(run("memoheld[memoorderless[a, b]]")->same(*MachineInteger::construct(1)));
+	CHECK(run("memoheld[memoorderless[b, a]]")->same(*MachineInteger::construct(1)));
+}
+
+// loading a fact table with keys in descending order used to be the worst
+// case for sorted inserts, as each new rule went to the front.
+
+TEST_CASE("fact table") {
+	Runtime * const runtime = Runtime::get();
+	const auto output = std::make_shared<TestOutput>();
+	Evaluation evaluation(output, runtime->definitions(), false);
+
+	const auto run = [runtime, &evaluation] (const std::string &s) {
+		return runtime->parse(s.c_str())->evaluate_or_copy(evaluation);
+	};
+
+	size_t k = 0;
+	for (const size_t n : {1000, 10000}) {
+		const std::string f = "fact" + std::to_string(k++);
+		const std::string size = std::to_string(n);
+
+		run("Table[" + f + "[" + size + " - i] = i, {i, 1, " + size + "}]");
+
+		CHECK(run(f + "[0]")->same(*MachineInteger::construct(machine_integer_t(n))));
+		CHECK(run(f + "[" + std::to_string(n - 1) + "]")->same(*MachineInteger::construct(1)));
+	}
+}
+
+// a symbol with many pattern rules that differ in the heads of their leaves,
+// like the rules of a rule-based integrator. most rules can be ruled out by
+// looking at the leaves' heads, without running their matchers.
+
+TEST_CASE("pattern rules") {
+	Runtime * const runtime = Runtime::get();
+	const auto output = std::make_shared<TestOutput>();
+	Evaluation evaluation(output, runtime->definitions(), false);
+
+	const auto run = [runtime, &evaluation] (const std::string &s) {
+		return runtime->parse(s.c_str())->evaluate_or_copy(evaluation);
+	};
+
+	constexpr size_t n_rules = 500;
+
+	for (size_t k = 1; k <= n_rules; k++) {
+		const std::string g = "ruleshead" + std::to_string(k);
+		switch (k % 4) {
+			case 0:
+				run("integ[" + g + "[x_], x_Symbol] := " + std::to_string(k));
+				break;
+			case 1:
+				run("integ[" + g + "[x_]^n_., x_Symbol] := " + std::to_string(k));
+				break;
+			case 2:
+				run("integ[" + g + "[x_, y_Integer], x_] := " + std::to_string(k));
+				break;
+			case 3:
+				run("integ[a_ " + g + "[x_], x_Symbol] := " + std::to_string(k));
+				break;
+		}
+	}
+	run("integ[x_, y__] := 0");
+
+	CHECK(run("integ[ruleshead4[z], z]")->same(*MachineInteger::construct(4)));
+	CHECK(run("integ[ruleshead5[z]^2, z]")->same(*MachineInteger::construct(5)));
+	CHECK(run("integ[ruleshead6[z, 3], z]")->same(*MachineInteger::construct(6)));
+	CHECK(run("integ[2 ruleshead7[z], z]")->same(*MachineInteger::construct(7)));
+	CHECK(run("integ[ruleshead8[z], 1, 2]")->same(*MachineInteger::construct(0)));
+
+	CHECK(run(
+		"{integ[ruleshead400[z], z], integ[ruleshead401[z]^3, z], "
+		"integ[ruleshead402[z, 1], z], integ[3 ruleshead403[z], z], "
+		"integ[ruleshead400[z], 1], integ[z, z]}")->same(*run("{400, 401, 402, 403, 0, 0}")));
+
+	// a rule inserted between the existing ones moves all later ones up in the index.
+	run("integ[ruleshead400[0], x_Symbol] := -1");
+	CHECK(run("integ[ruleshead400[0], z]")->same(*MachineInteger::construct(-1)));
+	CHECK(run("integ[ruleshead400[z], z]")->same(*MachineInteger::construct(400)));
+	CHECK(run("integ[ruleshead401[z]^3, z]")->same(*MachineInteger::construct(401)));
+	CHECK(run("integ[2 ruleshead403[z], z]")->same(*MachineInteger::construct(403)));
+}
+
+// rules over sums and products with many terms, as in simplification rule
+// sets. literal terms and head-constrained terms are found without trying
+// all assignments of terms to the pattern's arguments.
+
+TEST_CASE("commutative rules") {
+	Runtime * const runtime = Runtime::get();
+	const auto output = std::make_shared<TestOutput>();
+	Evaluation evaluation(output, runtime->definitions(), false);
+
+	const auto run = [runtime, &evaluation] (const std::string &s) {
+		return runtime->parse(s.c_str())->evaluate_or_copy(evaluation);
+	};
+
+	run("simp[c[7] + c[13] + r_] := {1, r}");
+	run("simp[p_Power + q_Power + r_] := {2, p, q}");
+	run("simp[n_Integer + r_] := {3, n}");
+	run("simp[c[5] c[9] r_] := {4, r}");
+	run("simp[x_] := 0");
+
+	for (const size_t n : {20, 50}) {
+		std::ostringstream sum;
+		std::ostringstream powers;
+		std::ostringstream product;
+		for (size_t i = 1; i <= n; i++) {
+			if (i > 1) {
+				sum << " + ";
+				powers << " + ";
+				product << " * ";
+			}
+			sum << "c[" << i << "]";
+			powers << (i % 10 == 0 ? "c[" : "d[") << i << (i % 10 == 0 ? "]^2" : "]");
+			product << "c[" << i << "]";
+		}
+
+		const auto head = [&run] (const std::string &s) {
+			const BaseExpressionRef result = run("simp[" + s + "]");
+			return result->is_list() ? result->as_expression()->leaf(0) : result;
+		};
+
+		CHECK(head(sum.str())->same(*MachineInteger::construct(1)));
+		CHECK(head(powers.str())->same(*MachineInteger::construct(2)));
+		CHECK(head(product.str())->same(*MachineInteger::construct(4)));
+		CHECK(head("d[1] + d[2] + d[3]")->same(*MachineInteger::construct(0)));
+	}
+}
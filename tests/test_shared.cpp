@@ -0,0 +1,45 @@
+// @formatter:off
+
+#include "../core/types.h"
+#include "../core/runtime.h"
+#include "../tests/doctest.h"
+#include "../concurrent/parallel.h"
+
+// readers hammer a SharedPtr (think of a symbol's own value being read by
+// Parallelize workers) while one writer occasionally replaces its value.
+
+TEST_CASE("SharedPtr contention") {
+	auto &definitions = Runtime::get()->definitions();
+	const auto output = std::make_shared<TestOutput>();
+	Evaluation evaluation(output, definitions, false);
+
+	constexpr size_t n_reads = 100000;
+	constexpr size_t n_writes = 1000;
+
+	for (const size_t n_readers : {8, 16, 32, 64}) {
+		MutableBaseExpressionRef value(MachineInteger::construct(0).get());
+		std::atomic<size_t> n_errors(0);
+
+		parallelize([&value, &n_errors] (size_t i) {
+			if (i == 0) {
+				for (size_t j = 1; j <= n_writes; j++) {
+					value = MachineInteger::construct(machine_integer_t(j));
+					std::this_thread::yield();
+				}
+			} else {
+				for (size_t j = 0; j < n_reads; j++) {
+					const BaseExpressionRef x = value;
+					if (!x->is_machine_integer() ||
+						static_cast<const MachineInteger*>(x.get())->value > machine_integer_t(n_writes)) {
+						n_errors.fetch_add(1);
+					}
+				}
+			}
+		}, n_readers + 1, evaluation);
+
+		CHECK(n_errors.load() == 0);
+
+		const BaseExpressionRef last = value;
+		CHECK(static_cast<const MachineInteger*>(last.get())->value == machine_integer_t(n_writes));
+	}
+}
@@ -24,4 +24,192 @@ TEST(String, String_set) {
     String p("abcde");
     EXPECT_STREQ(p.value.c_str(), "abcde");
 }
-*/
\ No newline at end of file
+*/
+// @formatter:off
+
+#include "../core/types.h"
+#include "../core/runtime.h"
+#include "../tests/doctest.h"
+
+#include "unicode/normalizer2.h"
+
+#include <sstream>
+
+// constructs String extents through ICU only, i.e. as make_string_extent()
+// did before it learned to classify and transcode simple text by itself.
+static StringExtentRef make_string_extent_icu(const std::string &utf8) {
+	UErrorCode status = U_ZERO_ERROR;
+	const Normalizer2 *norm = Normalizer2::getNFCInstance(status);
+	UnicodeString normalized = norm->normalize(UnicodeString::fromUTF8(StringPiece(utf8)), status);
+	return string_extent_from_normalized(std::move(normalized));
+}
+
+TEST_CASE("string extents") {
+	const char *samples[] = {
+		"plain ascii text\n",
+		"Grüße aus Köln, naïve café",
+		"Съешь же ещё этих мягких французских булок",
+		"Ξεσκεπάζω την ψυχοφθόρα βδελυγμία",
+		"我能吞下玻璃而不伤身体。",
+		"いろはにほへと ちりぬるを カタカナ",
+		"다람쥐 헌 쳇바퀴에 타고파",
+		"e\xcc\x81 combining acute", // NFC composes this to é
+		"क्षत्रिय", // Devanagari with virama, complex
+		"thumbs up \xf0\x9f\x91\x8d", // outside the BMP, complex
+		"line\r\nbreak ü", // CR LF is one character
+		"bad \xc3 utf-8 \xe2\x82", // invalid sequences
+		"overlong \xc0\xaf"
+	};
+
+	for (const char *sample : samples) {
+		const StringRef fast = String::construct(std::string(sample));
+		const StringRef icu = String::construct(make_string_extent_icu(sample));
+
+		CHECK(fast->extent_type() == icu->extent_type());
+		CHECK(fast->length() == icu->length());
+		CHECK(fast->utf8() == icu->utf8());
+		CHECK(fast->same(*icu));
+		CHECK(fast->unicode() == icu->unicode());
+	}
+
+	// a mixed-language corpus, one language per line.
+
+	std::string corpus;
+	while (corpus.size() < (64 << 10)) {
+		for (size_t i = 0; i < 7; i++) {
+			corpus.append(samples[i]);
+			corpus.append("\n");
+		}
+	}
+
+	const StringRef fast = String::construct(std::string(corpus));
+	const StringRef icu = String::construct(make_string_extent_icu(corpus));
+
+	CHECK(fast->extent_type() == StringExtent::simple);
+	CHECK(fast->same(*icu));
+
+	const std::string ascii(64 << 10, 'a');
+	const StringRef ascii_string = String::construct(std::string(ascii));
+	const UnicodeString widened = ascii_string->unicode();
+
+	CHECK(widened.length() == int32_t(ascii.size()));
+}
+
+TEST_CASE("ignore case") {
+	const char *pairs[][2] = {
+		{"Hello World", "hELLO wORLD"}, // ascii, ascii
+		{"\xe2\x84\xaa" "elvin", "KELVIN"}, // Kelvin sign, simple and ascii
+		{"Grüße aus Köln", "GRÜßE AUS KÖLN"}, // simple, simple
+		{"\xe1\xba\x9e" "E", "ße"}, // capital sharp s folds to ß
+		{"Ξεσκεπάζω", "ΞΕΣΚΕΠΆΖΩ"},
+		{"thumbs UP \xf0\x9f\x91\x8d", "Thumbs up \xf0\x9f\x91\x8d"}, // complex, complex
+		{"e\xcc\x81tude \xf0\x9f\x91\x8d", "ÉTUDE \xf0\x9f\x91\x8d"},
+		{"Deseret \xf0\x90\x90\x80", "dESERET \xf0\x90\x90\xa8"} // U+10400 folds to U+10428
+	};
+
+	for (const auto &pair : pairs) {
+		const StringRef a = String::construct(std::string(pair[0]));
+		const StringRef b = String::construct(std::string(pair[1]));
+
+		REQUIRE(a->length() == b->length());
+		CHECK(a->same_n(b.get(), 0, b->length(), true));
+		CHECK(b->same_n(a.get(), 0, a->length(), true));
+		CHECK(!a->same_n(b.get(), 0, b->length(), false));
+	}
+
+	const StringRef simple = String::construct(std::string("Grüße"));
+	const StringRef ascii = String::construct(std::string("GRUSSE"));
+	CHECK(!simple->same_n(ascii.get(), 0, simple->length(), true)); // no full case folding
+
+	// searching a text under IgnoreCase compares against the folded
+	// shadow of the text, which is built once.
+
+	std::string corpus;
+	while (corpus.size() < (64 << 10)) {
+		corpus.append("Grüße aus Köln, naïve café. ");
+	}
+	const StringRef text = String::construct(std::string(corpus));
+	const StringRef word = String::construct(std::string("KÖLN"));
+	const size_t n = word->length();
+
+	const auto count = [&text, &word, n] (bool ignore_case) {
+		size_t found = 0;
+		for (size_t i = 0; i + n <= text->length(); i++) {
+			found += word->same_n(text.get(), i, n, ignore_case);
+		}
+		return found;
+	};
+
+	CHECK(count(false) == 0);
+	CHECK(count(true) == text->length() / 28);
+}
+
+TEST_CASE("rope strings") {
+	Runtime * const runtime = Runtime::get();
+	auto &definitions = runtime->definitions();
+
+	const auto no_output = std::make_shared<NoOutput>();
+	Evaluation evaluation(no_output, definitions, false);
+
+	const SymbolRef string_join = definitions.lookup("System`StringJoin");
+
+	// s = s <> "chunk" for n chunks, which is linear in the total length only
+	// if StringJoin does not copy s every time.
+
+	constexpr size_t n = 2000;
+	const BaseExpressionRef chunk = String::construct(std::string("chunk"));
+
+	BaseExpressionRef s = String::construct(std::string(""));
+	std::string expected;
+
+	for (size_t i = 0; i < n; i++) {
+		s = expression(string_join, s, chunk)->evaluate_or_copy(evaluation);
+		expected.append("chunk");
+	}
+
+	REQUIRE(s->is_string());
+	const String * const rope = s->as_string();
+	const StringRef flat = String::construct(expected);
+
+	CHECK(rope->length() == expected.size());
+	CHECK(rope->hash() == flat->hash());
+	CHECK(rope->same(*flat));
+	CHECK(flat->same(*rope));
+	CHECK(rope->substr(7, 1007)->hash() == flat->substr(7, 1007)->hash());
+	CHECK(rope->utf8() == expected);
+	CHECK(std::string(rope->ascii(), rope->length()) == expected);
+}
+
+TEST_CASE("string split views") {
+	Runtime * const runtime = Runtime::get();
+
+	const auto no_output = std::make_shared<NoOutput>();
+	Evaluation evaluation(no_output, runtime->definitions(), false);
+
+	constexpr size_t n_lines = 2000;
+	std::ostringstream text;
+	for (size_t i = 0; i < n_lines; i++) {
+		text << "line " << i << "\n";
+	}
+
+	const StringRef file = String::construct(text.str());
+	const auto split = runtime->parse("StringSplit[#, \"\\n\"]&");
+
+	const auto lines = expression(split, file)->evaluate_or_copy(evaluation);
+
+	REQUIRE(lines->is_expression());
+	REQUIRE(lines->as_expression()->size() == n_lines);
+
+	// each line points into the characters of the original string.
+	const char *p = file->ascii();
+	lines->as_expression()->with_slice([&p] (const auto &slice) {
+		for (size_t i = 0; i < slice.size(); i++) {
+			const String * const line = slice[i]->as_string();
+			CHECK(line->ascii() == p);
+			p += line->length() + 1;
+		}
+	});
+
+	CHECK(expression(runtime->parse("StringCount[#, \"\\n\"]&"), file)->evaluate_or_copy(evaluation)->same(
+		*MachineInteger::construct(n_lines)));
+}